@@ -0,0 +1,198 @@
+/**
+ * @file config_store.h
+ * @brief Versioned, RAM-cached device configuration kept in NVS (Preferences).
+ *
+ * Replaces the fixed-offset EEPROM string slots. The whole configuration is a
+ * single typed struct that is loaded once at boot and then served from RAM, so
+ * hot paths (HTTP basic auth on every admin request, dashboard JSON, ...) never
+ * touch flash. Changes are applied to the RAM copy through setters that only
+ * mark the store dirty when a value actually differs; commit() then writes the
+ * struct as one NVS blob. NVS keeps the previous blob until the new one is
+ * fully written, so a power cut during commit leaves the old config intact.
+ *
+ * The blob carries a schema version and a CRC32. If it is missing or corrupt
+ * the store falls back to the legacy EEPROM layout (first boot after the
+ * firmware update), then to defaults, and writes the result back to NVS.
+ *
+ * Not thread-safe: setters/commit are expected to run from the network task
+ * only, which is also the only reader.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <EEPROM.h>
+
+#define CONFIG_NVS_NAMESPACE   "attcfg"
+#define CONFIG_NVS_KEY         "cfg"
+#define CONFIG_SCHEMA_VERSION  1
+
+// Legacy EEPROM layout (read-only, used for the one-time migration)
+#define LEGACY_EEPROM_SIZE             512
+#define LEGACY_EEPROM_WIFI_SSID_ADDR     0
+#define LEGACY_EEPROM_WIFI_PASS_ADDR    60
+#define LEGACY_EEPROM_ADMIN_USER_ADDR  120
+#define LEGACY_EEPROM_ADMIN_PASS_ADDR  180
+#define LEGACY_EEPROM_ADD_USER_USER_ADDR 240
+#define LEGACY_EEPROM_ADD_USER_PASS_ADDR 300
+
+#define CONFIG_DEFAULT_ADMIN_USER     "admin"
+#define CONFIG_DEFAULT_ADD_USER_USER  "user"
+
+struct DeviceConfig {
+  uint16_t schema;
+  uint16_t size;
+  char wifiSsid[33];
+  char wifiPass[64];
+  char adminUser[61];
+  char adminPass[61];
+  char addUserUser[61];
+  char addUserPass[61];
+  uint32_t crc;             // CRC32 over everything above
+};
+
+enum ConfigSource { CONFIG_FROM_NVS, CONFIG_FROM_EEPROM, CONFIG_FROM_DEFAULTS };
+
+class ConfigStore {
+public:
+  // Loads the config into RAM. Call once from setup(), before any task reads it.
+  ConfigSource begin() {
+    if (loadFromNvs()) {
+      _source = CONFIG_FROM_NVS;
+    } else if (loadFromLegacyEeprom()) {
+      _source = CONFIG_FROM_EEPROM;
+      _dirty = true;
+    } else {
+      resetToDefaults();
+      _source = CONFIG_FROM_DEFAULTS;
+      _dirty = true;
+    }
+    applyDefaults();
+    commit();
+    return _source;
+  }
+
+  const DeviceConfig& get() const { return _cfg; }
+  ConfigSource source() const { return _source; }
+  bool isDirty() const { return _dirty; }
+  uint32_t commitCount() const { return _commits; }
+
+  void setWifiSsid(const String& v)    { assign(_cfg.wifiSsid, sizeof(_cfg.wifiSsid), v); }
+  void setWifiPass(const String& v)    { assign(_cfg.wifiPass, sizeof(_cfg.wifiPass), v); }
+  void setAdminUser(const String& v)   { assign(_cfg.adminUser, sizeof(_cfg.adminUser), v); }
+  void setAdminPass(const String& v)   { assign(_cfg.adminPass, sizeof(_cfg.adminPass), v); }
+  void setAddUserUser(const String& v) { assign(_cfg.addUserUser, sizeof(_cfg.addUserUser), v); }
+  void setAddUserPass(const String& v) { assign(_cfg.addUserPass, sizeof(_cfg.addUserPass), v); }
+
+  // Writes all pending changes as one blob. No flash write if nothing changed.
+  bool commit() {
+    if (!_dirty) return true;
+    _cfg.schema = CONFIG_SCHEMA_VERSION;
+    _cfg.size = sizeof(DeviceConfig);
+    _cfg.crc = crc32((const uint8_t*)&_cfg, offsetof(DeviceConfig, crc));
+
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+      Serial.println("[Config] ERROR: NVS namespace could not be opened!");
+      return false;
+    }
+    size_t written = prefs.putBytes(CONFIG_NVS_KEY, &_cfg, sizeof(_cfg));
+    prefs.end();
+    if (written != sizeof(_cfg)) {
+      Serial.println("[Config] ERROR: NVS commit failed!");
+      return false;
+    }
+    _dirty = false;
+    _commits++;
+    Serial.printf("[Config] Committed %u bytes to NVS (commit #%u).\n", (unsigned)written, (unsigned)_commits);
+    return true;
+  }
+
+private:
+  DeviceConfig _cfg;
+  ConfigSource _source = CONFIG_FROM_DEFAULTS;
+  bool _dirty = false;
+  uint32_t _commits = 0;
+
+  void assign(char* dst, size_t cap, const String& v) {
+    char tmp[64];
+    size_t n = v.length() < cap - 1 ? v.length() : cap - 1;
+    memcpy(tmp, v.c_str(), n);
+    tmp[n] = '\0';
+    if (strcmp(dst, tmp) == 0) return;
+    memcpy(dst, tmp, n + 1);
+    _dirty = true;
+  }
+
+  void resetToDefaults() {
+    memset(&_cfg, 0, sizeof(_cfg));
+  }
+
+  // Empty user names fall back to the defaults, same as the old loader did.
+  void applyDefaults() {
+    if (_cfg.adminUser[0] == '\0') assign(_cfg.adminUser, sizeof(_cfg.adminUser), CONFIG_DEFAULT_ADMIN_USER);
+    if (_cfg.addUserUser[0] == '\0') assign(_cfg.addUserUser, sizeof(_cfg.addUserUser), CONFIG_DEFAULT_ADD_USER_USER);
+  }
+
+  bool loadFromNvs() {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, true)) return false; // namespace does not exist yet
+    size_t len = prefs.getBytesLength(CONFIG_NVS_KEY);
+    bool ok = false;
+    if (len == sizeof(DeviceConfig)) {
+      prefs.getBytes(CONFIG_NVS_KEY, &_cfg, sizeof(_cfg));
+      uint32_t crc = crc32((const uint8_t*)&_cfg, offsetof(DeviceConfig, crc));
+      if (_cfg.schema != CONFIG_SCHEMA_VERSION || _cfg.size != sizeof(DeviceConfig)) {
+        // Future schema bumps migrate field-by-field here.
+        Serial.printf("[Config] Unknown schema %u in NVS, ignoring.\n", _cfg.schema);
+      } else if (crc != _cfg.crc) {
+        Serial.println("[Config] NVS config CRC mismatch, ignoring.");
+      } else {
+        ok = true;
+      }
+    } else if (len > 0) {
+      Serial.printf("[Config] NVS config has unexpected size %u, ignoring.\n", (unsigned)len);
+    }
+    prefs.end();
+    if (!ok) resetToDefaults();
+    return ok;
+  }
+
+  // Reads the old fixed-offset string slots once. The EEPROM area is left
+  // untouched so an older firmware can still boot with it.
+  bool loadFromLegacyEeprom() {
+    resetToDefaults();
+    if (!EEPROM.begin(LEGACY_EEPROM_SIZE)) return false;
+    readLegacyString(LEGACY_EEPROM_WIFI_SSID_ADDR, _cfg.wifiSsid, 32);
+    readLegacyString(LEGACY_EEPROM_WIFI_PASS_ADDR, _cfg.wifiPass, 63);
+    readLegacyString(LEGACY_EEPROM_ADMIN_USER_ADDR, _cfg.adminUser, 60);
+    readLegacyString(LEGACY_EEPROM_ADMIN_PASS_ADDR, _cfg.adminPass, 60);
+    readLegacyString(LEGACY_EEPROM_ADD_USER_USER_ADDR, _cfg.addUserUser, 60);
+    readLegacyString(LEGACY_EEPROM_ADD_USER_PASS_ADDR, _cfg.addUserPass, 60);
+    EEPROM.end();
+
+    bool found = _cfg.wifiSsid[0] || _cfg.adminUser[0] || _cfg.adminPass[0] ||
+                 _cfg.addUserUser[0] || _cfg.addUserPass[0];
+    if (found) Serial.println("[Config] Migrated settings from legacy EEPROM layout.");
+    return found;
+  }
+
+  static void readLegacyString(int addr, char* dst, int maxLen) {
+    int len = 0;
+    while (len < maxLen) {
+      uint8_t c = EEPROM.read(addr + len);
+      if (c == '\0' || c == 0xFF) break;
+      dst[len++] = (char)c;
+    }
+    dst[len] = '\0';
+  }
+
+  static uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+      crc ^= data[i];
+      for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+  }
+};
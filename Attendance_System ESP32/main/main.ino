@@ -13,9 +13,11 @@
 #include <WiFiClientSecure.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <EEPROM.h>
 #include <Update.h>
-#include <UniversalTelegramBot.h>
+#include "config_store.h"
+#include "wifi_link.h"
+#include "telegram_link.h"
+#include "sd_download.h"
 
 //=========================================================
 // TASK & SEMAPHORE HANDLES
@@ -32,7 +34,8 @@ SemaphoreHandle_t sdMutex;
 #define CARD_COOLDOWN_SECONDS 5
 #define EVENT_TIMEOUT_MS 3000
 #define MESSAGE_DISPLAY_MS 5000
-#define WIFI_RECONNECT_TIMEOUT_MS 60000 // 1 dakika boyunca yeniden bağlanmayı dene
+#define WIFI_RECONNECT_TIMEOUT_MS 60000 // 1 dakika bağlantı yoksa AP portalını aç (STA denemeleri sürer)
+#define WIFI_STATS_INTERVAL_MS 600000   // WiFi bağlantı sürelerini 10 dakikada bir yazdır
 
 #define RST_PIN         22
 #define SS_PIN          15
@@ -55,7 +58,7 @@ const int I2C_SCL_PIN = 14;
 const char* GOOGLE_SCRIPT_ID = "https://script.google.com/macros/s/AKfycby1vGdWeMxtKsf0mf4i98NEv_NmrrHkRSRZ5-IMXtgSmRvFoyPZToPoie28pv-td8SnkQ/exec";
 
 //=========================================================
-// FILE, API & EEPROM SETTINGS
+// FILE & API SETTINGS
 //=========================================================
 #define USER_DATABASE_FILE    "/users.csv"
 #define LOGS_DIRECTORY        "/logs"
@@ -65,24 +68,12 @@ const char* GOOGLE_SCRIPT_ID = "https://script.google.com/macros/s/AKfycby1vGdWe
 #define TEMP_USER_FILE        "/temp_users.csv"
 #define UPLOAD_INTERVAL_MS 60000
 #define USER_SYNC_INTERVAL_MS 60000
-#define EEPROM_SIZE 512
-
-#define EEPROM_WIFI_SSID_ADDR         0
-#define EEPROM_WIFI_PASS_ADDR        60
-#define EEPROM_ADMIN_USER_ADDR       120
-#define EEPROM_ADMIN_PASS_ADDR       180
-#define EEPROM_ADD_USER_USER_ADDR    240
-#define EEPROM_ADD_USER_PASS_ADDR    300
 
 //=========================================================
 // WIFI & AUTHENTICATION SETTINGS
 //=========================================================
-String wifi_ssid;
-String wifi_pass;
-String admin_user;
-String admin_pass;
-String add_user_user;
-String add_user_pass;
+ConfigStore config; // Loaded once at boot, all reads are served from RAM
+WifiLink wifiLink;   // STA link with cached BSSID/channel, driven from Task_Network
 
 const char* ap_ssid = "RFID-Config-Portal";
 
@@ -113,10 +104,8 @@ enum DisplayState { SHOWING_MESSAGE, SHOWING_TIME };
 DisplayState currentDisplayState = SHOWING_TIME;
 unsigned long lastCardActivityTime = 0;
 
-WiFiClientSecure client;
-UniversalTelegramBot bot(BOT_TOKEN, client);
-unsigned long lastBotCheckTime = 0;
-const int botRequestDelay = 2000;
+WiFiClientSecure client;   // Google Sheets
+TelegramLink telegram;     // Telegram has its own task and TLS session
 
 enum NetworkState {
   STATE_WIFI_CONNECTING,
@@ -125,7 +114,7 @@ enum NetworkState {
   STATE_AP_MODE
 };
 NetworkState currentNetworkState;
-unsigned long lastReconnectAttempt = 0;
+unsigned long disconnectedSince = 0;
 
 
 //=========================================================
@@ -261,8 +250,6 @@ setInterval(getLastUID, 1000); window.onload = getLastUID;
 //=========================================================
 // FUNCTION PROTOTYPES
 //=========================================================
-void writeStringToEEPROM(int addr, const String& str);
-String readStringFromEEPROM(int addr, int maxLen);
 void loadUsersFromSd();
 void playBuzzer(int status);
 String getFormattedTime(time_t timestamp);
@@ -286,6 +273,7 @@ void Task_RFID(void *pvParameters);
 void handleRoot();
 void handleCSS();
 void handleData();
+void handleWifiStats();
 void handleAdmin();
 void handleDeleteUser();
 void handleAddUser();
@@ -301,6 +289,7 @@ void handleUpdateUpload();
 void handleTelegramBot();
 void sendTelegramLog(String message);
 void handleFileDownload();
+void handleExport();
 void startAPMode();
 
 
@@ -309,7 +298,7 @@ void startAPMode();
 //=========================================================
 void setup() {
   Serial.begin(115200);
-  client.setInsecure(); // For Telegram and Google Sheets
+  client.setInsecure(); // For Google Sheets
   delay(1000);
   pinMode(BUZZER_PIN, OUTPUT);
   Serial.println("\n-- RFID Access System with WiFi Manager --");
@@ -345,6 +334,8 @@ void setup() {
 
   xTaskCreatePinnedToCore(Task_Network, "Network_Task", 10000, NULL, 1, &Task_Network_Handle, 1);
   xTaskCreatePinnedToCore(Task_RFID, "RFID_Task", 5000, NULL, 1, &Task_RFID_Handle, 0);
+  // nullptr: /status stays available to every chat, as before
+  telegram.begin(BOT_TOKEN, nullptr, nullptr, 0);
 
   Serial.println("Tasks created. System starting...");
 }
@@ -354,55 +345,57 @@ void setup() {
 //=========================================================
 void Task_Network(void *pvParameters) {
   Serial.println("[Network Task] Started on Core 1.");
-  
-  if (wifi_ssid.length() == 0) {
+  bool hasCredentials = config.get().wifiSsid[0] != '\0';
+  bool dashboardStarted = false;
+
+  if (!hasCredentials) {
     currentNetworkState = STATE_AP_MODE;
     startAPMode();
   } else {
+    Serial.print("[Network Task] Attempting to connect to WiFi: ");
+    Serial.println(config.get().wifiSsid);
+    updateDisplayMessage("Connecting to:", config.get().wifiSsid);
+    wifiLink.begin(config.get().wifiSsid, config.get().wifiPass);
+    disconnectedSince = millis();
     currentNetworkState = STATE_WIFI_CONNECTING;
   }
 
   unsigned long lastUploadTime = 0;
   unsigned long lastUserFileSyncTime = 0;
+  unsigned long lastWifiStatsTime = 0;
   
   for (;;) {
-    switch (currentNetworkState) {
-      case STATE_WIFI_CONNECTING: {
-        Serial.print("[Network Task] Attempting to connect to WiFi: ");
-        Serial.println(wifi_ssid);
-        updateDisplayMessage("Connecting to:", wifi_ssid);
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(wifi_ssid.c_str(), wifi_pass.c_str());
-        int connection_attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && connection_attempts < 30) {
-          vTaskDelay(500 / portTICK_PERIOD_MS);
-          Serial.print(".");
-          connection_attempts++;
-        }
+    if (hasCredentials) wifiLink.loop(); // never blocks, handles backoff and roaming
 
-        if (WiFi.status() == WL_CONNECTED) {
+    switch (currentNetworkState) {
+      case STATE_WIFI_CONNECTING:
+      case STATE_WIFI_DISCONNECTED_RECONNECTING:
+        server.handleClient();
+        if (wifiLink.isOnline()) {
           Serial.println("\n[Network Task] WiFi Connected!");
           Serial.print("[Network Task] IP Address: http://"); Serial.println(WiFi.localIP());
-          updateDisplayMessage("WiFi Connected", WiFi.localIP().toString());
-          setupTime();
-          setupDashboardServer();
-          server.begin();
-          Serial.println("[Network Task] Dashboard Web Server started.");
+          updateDisplayMessage(currentNetworkState == STATE_WIFI_CONNECTING ? "WiFi Connected" : "Reconnected!", WiFi.localIP().toString());
+          if (!dashboardStarted) {
+            setupTime();
+            setupDashboardServer();
+            server.begin();
+            Serial.println("[Network Task] Dashboard Web Server started.");
+            dashboardStarted = true;
+          }
           syncUserListToSheets();
           currentNetworkState = STATE_WIFI_CONNECTED;
-        } else {
-          Serial.println("\n[Network Task] Could not connect. Starting AP Mode.");
+        } else if (millis() - disconnectedSince > WIFI_RECONNECT_TIMEOUT_MS) {
+          Serial.println("[Network Task] WiFi still unreachable. Starting AP mode, STA retries continue.");
           currentNetworkState = STATE_AP_MODE;
           startAPMode();
         }
         break;
-      }
 
       case STATE_WIFI_CONNECTED:
-        if (WiFi.status() != WL_CONNECTED) {
-          Serial.println("[Network Task] Connection Lost! Attempting to reconnect...");
+        if (!wifiLink.isOnline()) {
+          Serial.println("[Network Task] Connection Lost! Reconnecting in background...");
           updateDisplayMessage("Connection Lost", "Reconnecting...");
-          lastReconnectAttempt = millis();
+          disconnectedSince = millis();
           currentNetworkState = STATE_WIFI_DISCONNECTED_RECONNECTING;
           break;
         }
@@ -434,40 +427,24 @@ void Task_Network(void *pvParameters) {
           lastUserFileSyncTime = millis();
         }
 
-        if (millis() - lastBotCheckTime > botRequestDelay) {
-          handleTelegramBot();
-          lastBotCheckTime = millis();
-        }
-        break;
-
-      case STATE_WIFI_DISCONNECTED_RECONNECTING:
-        if (millis() - lastReconnectAttempt > 5000) { // Her 5 saniyede bir dene
-            Serial.println("[Network Task] Re-attempting WiFi connection...");
-            WiFi.reconnect();
-            lastReconnectAttempt = millis();
-            int attempts = 0;
-            while (WiFi.status() != WL_CONNECTED && attempts < 10) {
-                vTaskDelay(500 / portTICK_PERIOD_MS);
-                attempts++;
-            }
-            if(WiFi.status() == WL_CONNECTED){
-                Serial.println("[Network Task] Reconnected to WiFi!");
-                updateDisplayMessage("Reconnected!", WiFi.localIP().toString());
-                currentNetworkState = STATE_WIFI_CONNECTED;
-            }
-        }
-        
-        if (millis() > lastReconnectAttempt + WIFI_RECONNECT_TIMEOUT_MS && WiFi.status() != WL_CONNECTED) {
-            Serial.println("[Network Task] Reconnection failed. Switching to AP mode.");
-            currentNetworkState = STATE_AP_MODE;
-            startAPMode();
-        }
+        handleTelegramBot();
         break;
 
       case STATE_AP_MODE:
         server.handleClient();
+        // Saved network is back: restart into dashboard mode (fast path via the RTC cache)
+        if (hasCredentials && wifiLink.isOnline()) {
+          Serial.println("[Network Task] Saved WiFi is reachable again. Leaving AP mode.");
+          vTaskDelay(500 / portTICK_PERIOD_MS);
+          ESP.restart();
+        }
         break;
     }
+
+    if (hasCredentials && millis() - lastWifiStatsTime > WIFI_STATS_INTERVAL_MS) {
+      wifiLink.printStats();
+      lastWifiStatsTime = millis();
+    }
     vTaskDelay(10 / portTICK_PERIOD_MS);
   }
 }
@@ -570,28 +547,21 @@ void loop() {
 // WIFI & WEB SERVER FUNCTIONS
 //=========================================================
 void loadCredentials() {
-  EEPROM.begin(EEPROM_SIZE);
-  Serial.println("[Config] Loading all settings from EEPROM...");
-  wifi_ssid       = readStringFromEEPROM(EEPROM_WIFI_SSID_ADDR, 32);
-  wifi_pass       = readStringFromEEPROM(EEPROM_WIFI_PASS_ADDR, 63);
-  admin_user      = readStringFromEEPROM(EEPROM_ADMIN_USER_ADDR, 60);
-  admin_pass      = readStringFromEEPROM(EEPROM_ADMIN_PASS_ADDR, 60);
-  add_user_user   = readStringFromEEPROM(EEPROM_ADD_USER_USER_ADDR, 60);
-  add_user_pass   = readStringFromEEPROM(EEPROM_ADD_USER_PASS_ADDR, 60);
-
-  if (admin_user.length() == 0) admin_user = "admin";
-  if (add_user_user.length() == 0) add_user_user = "user";
-  
+  Serial.println("[Config] Loading settings from NVS...");
+  unsigned long t0 = micros();
+  ConfigSource src = config.begin();
+
   Serial.println("--- Configuration Loaded ---");
-  Serial.printf("WiFi SSID:  '%s'\n", wifi_ssid.c_str());
-  Serial.printf("Admin User: '%s'\n", admin_user.c_str());
+  Serial.printf("Source:     %s (%lu us)\n", src == CONFIG_FROM_NVS ? "NVS" : (src == CONFIG_FROM_EEPROM ? "legacy EEPROM" : "defaults"), micros() - t0);
+  Serial.printf("WiFi SSID:  '%s'\n", config.get().wifiSsid);
+  Serial.printf("Admin User: '%s'\n", config.get().adminUser);
   Serial.println("--------------------------");
-  EEPROM.end();
 }
 
 void setupDashboardServer() {
   server.on("/", HTTP_GET, handleRoot);
   server.on("/data", HTTP_GET, handleData);
+  server.on("/wifistats", HTTP_GET, handleWifiStats);
   server.on("/admin", HTTP_GET, handleAdmin);
   server.on("/adduserpage", HTTP_GET, handleAddUserPage);
   server.on("/getlastuid", HTTP_GET, handleGetLastUID);
@@ -602,6 +572,8 @@ void setupDashboardServer() {
   server.on("/changepass", HTTP_POST, handleChangePassword);
   server.on("/changeadduserpass", HTTP_POST, handleChangeAddUserPassword);
   server.on("/download", HTTP_GET, handleFileDownload);
+  server.on("/export", HTTP_GET, handleExport);
+  server.collectHeaders(DOWNLOAD_REQUEST_HEADERS, DOWNLOAD_REQUEST_HEADER_COUNT);
 
   server.on("/update", HTTP_POST, []() {
     server.sendHeader("Connection", "close");
@@ -614,8 +586,14 @@ void setupDashboardServer() {
 
 void startAPMode() {
   Serial.println("[Network Task] Starting Access Point mode.");
-  WiFi.disconnect(true);
-  WiFi.mode(WIFI_AP);
+  if (config.get().wifiSsid[0] != '\0') {
+    // Keep the STA side up so WifiLink can keep retrying behind the portal
+    WiFi.mode(WIFI_AP_STA);
+    wifiLink.setPortalActive(true);
+  } else {
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_AP);
+  }
   WiFi.softAP(ap_ssid);
   IPAddress apIP = WiFi.softAPIP();
   Serial.print("[Network Task] AP Mode enabled. Connect to '");
@@ -630,14 +608,10 @@ void startAPMode() {
 void setupAPServer() {
     server.on("/", HTTP_GET, [](){ server.send_P(200, "text/html", PAGE_WIFI_SETUP); });
     server.on("/save", HTTP_POST, [](){
-        wifi_ssid = server.arg("ssid");
-        wifi_pass = server.arg("pass");
-        Serial.printf("[AP Mode] New WiFi credentials received: SSID = %s\n", wifi_ssid.c_str());
-        
-        EEPROM.begin(EEPROM_SIZE);
-        writeStringToEEPROM(EEPROM_WIFI_SSID_ADDR, wifi_ssid);
-        writeStringToEEPROM(EEPROM_WIFI_PASS_ADDR, wifi_pass);
-        EEPROM.end();
+        config.setWifiSsid(server.arg("ssid"));
+        config.setWifiPass(server.arg("pass"));
+        Serial.printf("[AP Mode] New WiFi credentials received: SSID = %s\n", config.get().wifiSsid);
+        config.commit();
         
         server.send(200, "text/html", "<h2>Settings Saved!</h2><p>Device will restart with new settings in 5 seconds.</p>");
         delay(5000);
@@ -666,16 +640,37 @@ void handleData() {
   doc["uid"] = lastEventUID;
   doc["name"] = lastEventName;
   doc["action"] = lastEventAction;
-  doc["ssid"] = (WiFi.status() == WL_CONNECTED) ? wifi_ssid : "Disconnected";
+  doc["ssid"] = (WiFi.status() == WL_CONNECTED) ? config.get().wifiSsid : "Disconnected";
   doc["uptime"] = formatUptime();
   String json;
   serializeJson(doc, json);
   server.send(200, "application/json", json);
 }
 
+void handleWifiStats() {
+  const WifiLinkStats& st = wifiLink.stats();
+  StaticJsonDocument<384> doc;
+  doc["rssi"] = WiFi.RSSI();
+  doc["channel"] = WiFi.channel();
+  doc["bssid"] = WiFi.BSSIDstr();
+  doc["attempts"] = st.attempts;
+  doc["fastConnects"] = st.fastConnects;
+  doc["fullConnects"] = st.fullConnects;
+  doc["roams"] = st.roams;
+  doc["outages"] = st.outages;
+  doc["bootToOnlineMs"] = st.bootToOnlineMs;
+  doc["lastOutageMs"] = st.lastOutageMs;
+  doc["maxOutageMs"] = st.maxOutageMs;
+  doc["totalOutageMs"] = st.totalOutageMs;
+  doc["lastAttemptMs"] = st.lastAttemptMs;
+  String json;
+  serializeJson(doc, json);
+  server.send(200, "application/json", json);
+}
+
 void handleAddUserPage() {
-  if (add_user_pass.length() > 0) {
-    if (!server.authenticate(add_user_user.c_str(), add_user_pass.c_str())) { 
+  if (config.get().addUserPass[0] != '\0') {
+    if (!server.authenticate(config.get().addUserUser, config.get().addUserPass)) { 
       return server.requestAuthentication(); 
     }
   }
@@ -688,8 +683,8 @@ void handleGetLastUID() {
 }
 
 void handleAdmin() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { 
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { 
       return server.requestAuthentication(); 
     }
   }
@@ -697,9 +692,9 @@ void handleAdmin() {
  html += "<h1>Admin Panel</h1><a href='/' class='home-link'>&larr; Back to Dashboard</a>";
  html += "<h2>Security Settings</h2>";
  html += "<h3>Admin Access</h3>";
- html += "<form action='/changepass' method='post'>Admin Username: <input type='text' name='admin_user' value='" + admin_user + "'><br>New Admin Password: <input type='password' name='admin_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save Admin Settings'></form>";
+ html += "<form action='/changepass' method='post'>Admin Username: <input type='text' name='admin_user' value='" + String(config.get().adminUser) + "'><br>New Admin Password: <input type='password' name='admin_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save Admin Settings'></form>";
  html += "<h3>'Add User' Page Access</h3>";
- html += "<form action='/changeadduserpass' method='post'>'Add User' Username: <input type='text' name='add_user_user' value='" + add_user_user + "'><br>New 'Add User' Password: <input type='password' name='add_user_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save User Settings'></form>";
+ html += "<form action='/changeadduserpass' method='post'>'Add User' Username: <input type='text' name='add_user_user' value='" + String(config.get().addUserUser) + "'><br>New 'Add User' Password: <input type='password' name='add_user_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save User Settings'></form>";
  html += "<h2>User Management</h2>";
  html += "<table><tr><th>UID</th><th>Name</th><th>Current Status</th><th>Action</th></tr>";
  for (auto const& [uid, name] : userDatabase) {
@@ -722,6 +717,7 @@ void handleAdmin() {
 
  // 3. Gömülü Dosya Yöneticisi
  html += "<h3>File Manager</h3>";
+ html += "<form action='/export' method='get'><input type='month' name='month' style='width:auto;'> <input type='submit' value='Export Logs (.tar.gz)'></form>";
  html += "<table><tr><th>File Path</th><th>Size (Bytes)</th><th>Action</th></tr>";
  xSemaphoreTake(sdMutex, portMAX_DELAY);
  File root = SD.open("/");
@@ -737,8 +733,8 @@ void handleAdmin() {
 }
 
 void handleDeleteUser() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   if (server.hasArg("uid")) {
     String uidToDelete = server.arg("uid");
@@ -765,8 +761,8 @@ void handleDeleteUser() {
 }
 
 void handleAddUser() {
-  if (add_user_pass.length() > 0) {
-    if (!server.authenticate(add_user_user.c_str(), add_user_pass.c_str())) return;
+  if (config.get().addUserPass[0] != '\0') {
+    if (!server.authenticate(config.get().addUserUser, config.get().addUserPass)) return;
   }
   if (server.hasArg("uid") && server.hasArg("name")) {
     String uid = server.arg("uid"); String name = server.arg("name");
@@ -787,8 +783,8 @@ void handleAddUser() {
 }
 
 void handleReboot() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   server.send(200, "text/plain", "Rebooting in 3 seconds...");
   delay(3000);
@@ -796,39 +792,23 @@ void handleReboot() {
 }
 
 void handleChangePassword() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
-  EEPROM.begin(EEPROM_SIZE);
-  if (server.hasArg("admin_user")) {
-    admin_user = server.arg("admin_user");
-    writeStringToEEPROM(EEPROM_ADMIN_USER_ADDR, admin_user);
-  }
-  if (server.hasArg("admin_pass")) {
-    admin_pass = server.arg("admin_pass");
-    writeStringToEEPROM(EEPROM_ADMIN_PASS_ADDR, admin_pass);
-  }
-  EEPROM.commit();
-  EEPROM.end();
+  if (server.hasArg("admin_user")) config.setAdminUser(server.arg("admin_user"));
+  if (server.hasArg("admin_pass")) config.setAdminPass(server.arg("admin_pass"));
+  config.commit();
   server.sendHeader("Location", "/admin", true);
   server.send(302, "text/plain", "");
 }
 
 void handleChangeAddUserPassword() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
-  }
-  EEPROM.begin(EEPROM_SIZE);
-  if (server.hasArg("add_user_user")) {
-    add_user_user = server.arg("add_user_user");
-    writeStringToEEPROM(EEPROM_ADD_USER_USER_ADDR, add_user_user);
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
-  if (server.hasArg("add_user_pass")) {
-    add_user_pass = server.arg("add_user_pass");
-    writeStringToEEPROM(EEPROM_ADD_USER_PASS_ADDR, add_user_pass);
-  }
-  EEPROM.commit();
-  EEPROM.end();
+  if (server.hasArg("add_user_user")) config.setAddUserUser(server.arg("add_user_user"));
+  if (server.hasArg("add_user_pass")) config.setAddUserPass(server.arg("add_user_pass"));
+  config.commit();
   server.sendHeader("Location", "/admin", true);
   server.send(302, "text/plain", "");
 }
@@ -862,63 +842,49 @@ void handleNotFound() { server.send(404, "text/plain", "404: Not Found"); }
 //=========================================================
 // HELPER FUNCTIONS
 //=========================================================
-void writeStringToEEPROM(int addr, const String& str) {
-  int len = str.length();
-  for (int i = 0; i < len; i++) {
-    EEPROM.write(addr + i, str[i]);
+// sdMutex artık dosyanın tamamı için değil, 1 KB'lık her parça için alınıyor (sd_download.h)
+void handleFileDownload() {
+  if (server.hasArg("path")) {
+    serveSdFile(server, server.arg("path"), sdMutex);
   }
-  EEPROM.write(addr + len, '\0');
 }
 
-String readStringFromEEPROM(int addr, int maxLen) {
-  char data[maxLen + 1];
-  int len = 0;
-  byte c = EEPROM.read(addr + len);
-  while (c != '\0' && c != 0xFF && len < maxLen) {
-    data[len] = (char)c;
-    len++;
-    c = EEPROM.read(addr + len);
+// /export?month=YYYY-MM -> kullanıcılar, geçersiz kayıtlar ve o ayın günlük logları tek .tar.gz
+void handleExport() {
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return server.requestAuthentication();
   }
-  data[len] = '\0';
-  return String(data);
-}
-
-void handleFileDownload() {
-  if (server.hasArg("path")) {
-    String path = server.arg("path");
-    if (path == "" || !SD.exists(path)) {
-      server.send(404, "text/plain", "File Not Found");
+  String month = server.arg("month");
+  for (size_t i = 0; i < month.length(); i++) {
+    if (!isDigit(month[i]) && month[i] != '-') {
+      server.send(400, "text/plain", "Bad Request: month must look like 2025-06.");
       return;
     }
-    xSemaphoreTake(sdMutex, portMAX_DELAY);
-    File download = SD.open(path);
-    if (download) {
-      server.streamFile(download, "application/octet-stream");
-      download.close();
-    } else {
-      server.send(404, "text/plain", "File Not Found");
-    }
-    xSemaphoreGive(sdMutex);
   }
+  // Günlük loglar /logs/YYYY/MM/DD.csv altında: 2025-06 -> "2025/06/" alt dizini
+  String prefix = month;
+  prefix.replace("-", "/");
+  if (prefix.length()) prefix += "/";
+  const char* extraFiles[] = { USER_DATABASE_FILE, INVALID_LOGS_FILE };
+  String archiveName = "logs-" + (month.length() ? month : String("all")) + ".tar.gz";
+  serveSdArchive(server, LOGS_DIRECTORY, prefix, extraFiles, 2, archiveName, sdMutex);
 }
 
+// Drains commands queued by the Telegram task; never blocks the network task.
 void handleTelegramBot() {
-    int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    for (int i=0; i<numNewMessages; i++) {
-        String chat_id = String(bot.messages[i].chat_id);
-        String text = bot.messages[i].text;
-        if (text == "/status") {
-            String status_msg = "Device Online\nSSID: " + wifi_ssid + "\nUptime: " + formatUptime();
-            bot.sendMessage(chat_id, status_msg, "");
+    TelegramCommand cmd;
+    while (telegram.nextCommand(cmd)) {
+        if (String(cmd.text) == "/status") {
+            String status_msg = "Device Online\nSSID: " + String(config.get().wifiSsid) + "\nUptime: " + formatUptime();
+            telegram.reply(cmd, status_msg, "");
         }
     }
 }
 
+// Safe from any task: the message is queued and sent by the Telegram task.
 void sendTelegramLog(String message) {
-    if (WiFi.status() == WL_CONNECTED) {
-        bot.sendMessage(CHAT_ID, message, "Markdown");
-    } else {
-        Serial.println("[Telegram] WiFi disconnected. Cannot send message.");
+    if (!telegram.send(CHAT_ID, message, "Markdown")) {
+        Serial.println("[Telegram] Send queue full. Message dropped.");
     }
 }
 
@@ -0,0 +1,627 @@
+/**
+ * @file sd_download.h
+ * @brief Streaming SD card downloads: on-the-fly gzip, HTTP Range and
+ *        If-Modified-Since, and tar.gz export of several files.
+ *
+ * GzipStream is a small deflate encoder: LZ77 over a DEFLATE_WINDOW byte
+ * window plus fixed Huffman codes. It needs about 10 KB of heap, allocated per
+ * request, whatever the file size. Log CSVs repeat dates, names and ENTER/EXIT
+ * on every line, so fixed codes are enough to shrink them several times.
+ *
+ * serveSdFile():
+ *  - Sends gzip (Content-Encoding) when the client accepts it.
+ *  - Serves "Range: bytes=..." requests uncompressed with 206. Only an
+ *    uncompressed download can be resumed: the gzip response says
+ *    "Accept-Ranges: none" and has its own ETag, and If-Range must match the
+ *    uncompressed ETag, so no client can splice raw bytes into a .gz.
+ *  - Answers If-Modified-Since with 304 when the file's FAT timestamp allows.
+ *
+ * serveSdArchive() streams the selected files as one .tar.gz.
+ *
+ * The SD mutex is only held for each DOWNLOAD_READ_CHUNK read, not for the
+ * whole transfer, so RFID logging keeps running during a long download.
+ * Every transfer logs its size, ratio, time and peak heap use to Serial.
+ * Those "[Download]" lines have not been collected on a board yet; the
+ * 10 KB and ratio figures here come from host runs of the encoder.
+ *
+ * Needs server.collectHeaders(DOWNLOAD_REQUEST_HEADERS, DOWNLOAD_REQUEST_HEADER_COUNT)
+ * before server.begin().
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <SD.h>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+
+#define DEFLATE_WINDOW        2048      // LZ77 history, power of two
+#define DEFLATE_HASH_BITS     10
+#define DEFLATE_HASH_SIZE     (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MAX_CHAIN     16        // match candidates tried per position
+#define DEFLATE_MIN_MATCH     3
+#define DEFLATE_MAX_MATCH     258
+#define DEFLATE_OUT_BUF       1436      // one TCP segment
+#define DOWNLOAD_READ_CHUNK   1024
+#define DOWNLOAD_ARCHIVE_MAX_DEPTH 3    // /logs/YYYY/MM/DD.csv
+
+static const char* DOWNLOAD_REQUEST_HEADERS[] = { "Range", "If-Range", "If-Modified-Since", "Accept-Encoding" };
+#define DOWNLOAD_REQUEST_HEADER_COUNT 4
+
+//=========================================================
+// GZIP / DEFLATE ENCODER
+//=========================================================
+class GzipStream {
+public:
+  explicit GzipStream(Print& out) : _out(out) {}
+  ~GzipStream() { release(); }
+
+  // Allocates the window; false if the heap is too tight (caller falls back to identity).
+  bool begin(uint32_t mtime = 0) {
+    _buf = (uint8_t*)malloc(2 * DEFLATE_WINDOW);
+    _head = (uint16_t*)malloc(DEFLATE_HASH_SIZE * sizeof(uint16_t));
+    _prev = (uint16_t*)malloc(DEFLATE_WINDOW * sizeof(uint16_t));
+    _obuf = (uint8_t*)malloc(DEFLATE_OUT_BUF);
+    if (!_buf || !_head || !_prev || !_obuf) {
+      release();
+      return false;
+    }
+    memset(_head, 0xFF, DEFLATE_HASH_SIZE * sizeof(uint16_t));
+    _pos = _end = 0;
+    _olen = 0;
+    _bitBuf = _bitCount = 0;
+    _crc = 0xFFFFFFFF;
+    _bytesIn = _bytesOut = 0;
+
+    const uint8_t header[10] = { 0x1F, 0x8B, 8, 0,
+                                 (uint8_t)mtime, (uint8_t)(mtime >> 8), (uint8_t)(mtime >> 16), (uint8_t)(mtime >> 24),
+                                 0, 255 };
+    for (uint8_t b : header) putByte(b);
+    putBits(0, 1);      // BFINAL = 0
+    putBits(1, 2);      // BTYPE = 01, fixed Huffman
+    return true;
+  }
+
+  void write(const uint8_t* data, size_t len) {
+    _crc = crc32Update(_crc, data, len);
+    _bytesIn += len;
+    while (len > 0) {
+      if (_end == 2 * DEFLATE_WINDOW) {
+        compress(false);
+        slide();
+      }
+      size_t n = 2 * DEFLATE_WINDOW - _end;
+      if (n > len) n = len;
+      memcpy(_buf + _end, data, n);
+      _end += n;
+      data += n;
+      len -= n;
+    }
+  }
+
+  void finish() {
+    compress(true);
+    putHuffman(0, 7);   // end of block
+    putBits(1, 1);      // empty final block
+    putBits(1, 2);
+    putHuffman(0, 7);
+    if (_bitCount) putBits(0, 8 - _bitCount);
+    uint32_t crc = ~_crc;
+    for (int i = 0; i < 4; i++) putByte(crc >> (8 * i));
+    for (int i = 0; i < 4; i++) putByte(_bytesIn >> (8 * i));
+    flushOut();
+    release();
+  }
+
+  uint32_t bytesIn() const { return _bytesIn; }
+  uint32_t bytesOut() const { return _bytesOut; }
+
+private:
+  static const uint16_t NIL = 0xFFFF;
+  Print& _out;
+  uint8_t* _buf = nullptr;    // 2 windows: history + lookahead
+  uint16_t* _head = nullptr;
+  uint16_t* _prev = nullptr;
+  uint8_t* _obuf = nullptr;
+  size_t _pos = 0, _end = 0, _olen = 0;
+  uint32_t _bitBuf = 0, _bitCount = 0;
+  uint32_t _crc = 0xFFFFFFFF;
+  uint32_t _bytesIn = 0, _bytesOut = 0;
+
+  void release() {
+    free(_buf); free(_head); free(_prev); free(_obuf);
+    _buf = _obuf = nullptr;
+    _head = _prev = nullptr;
+  }
+
+  static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+    while (len--) {
+      crc ^= *data++;
+      crc = (crc >> 4) ^ table[crc & 15];
+      crc = (crc >> 4) ^ table[crc & 15];
+    }
+    return crc;
+  }
+
+  void flushOut() {
+    if (_olen) {
+      _out.write(_obuf, _olen);
+      _olen = 0;
+    }
+  }
+
+  void putByte(uint8_t b) {
+    _obuf[_olen++] = b;
+    _bytesOut++;
+    if (_olen == DEFLATE_OUT_BUF) flushOut();
+  }
+
+  void putBits(uint32_t value, uint32_t n) {
+    _bitBuf |= value << _bitCount;
+    _bitCount += n;
+    while (_bitCount >= 8) {
+      putByte(_bitBuf & 0xFF);
+      _bitBuf >>= 8;
+      _bitCount -= 8;
+    }
+  }
+
+  // Huffman codes are stored MSB first
+  void putHuffman(uint32_t code, uint32_t len) {
+    uint32_t rev = 0;
+    for (uint32_t i = 0; i < len; i++) rev |= ((code >> i) & 1) << (len - 1 - i);
+    putBits(rev, len);
+  }
+
+  void putLiteral(uint32_t v) {
+    if (v < 144) putHuffman(0x30 + v, 8);
+    else if (v < 256) putHuffman(0x190 + v - 144, 9);
+    else if (v < 280) putHuffman(v - 256, 7);
+    else putHuffman(0xC0 + v - 280, 8);
+  }
+
+  void putMatch(uint32_t len, uint32_t dist) {
+    static const uint16_t lenBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    static const uint8_t lenExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    static const uint16_t distBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    static const uint8_t distExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+    int l = 28;
+    while (lenBase[l] > len) l--;
+    putLiteral(257 + l);
+    if (lenExtra[l]) putBits(len - lenBase[l], lenExtra[l]);
+    int d = 29;
+    while (distBase[d] > dist) d--;
+    putHuffman(d, 5);
+    if (distExtra[d]) putBits(dist - distBase[d], distExtra[d]);
+  }
+
+  uint32_t hashAt(size_t p) const {
+    uint32_t v = (_buf[p] << 16) | (_buf[p + 1] << 8) | _buf[p + 2];
+    return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+  }
+
+  void insert(size_t p) {
+    uint32_t h = hashAt(p);
+    _prev[p & (DEFLATE_WINDOW - 1)] = _head[h];
+    _head[h] = p;
+  }
+
+  // Encodes buffered input; keeps DEFLATE_MAX_MATCH bytes of lookahead unless flushing.
+  void compress(bool flush) {
+    size_t limit = flush ? _end : (_end > DEFLATE_MAX_MATCH ? _end - DEFLATE_MAX_MATCH : 0);
+    while (_pos < limit) {
+      size_t maxLen = _end - _pos;
+      if (maxLen > DEFLATE_MAX_MATCH) maxLen = DEFLATE_MAX_MATCH;
+      size_t bestLen = 0, bestDist = 0;
+
+      if (maxLen >= DEFLATE_MIN_MATCH) {
+        uint16_t cand = _head[hashAt(_pos)];
+        int chain = DEFLATE_MAX_CHAIN;
+        while (cand != NIL && chain-- > 0) {
+          size_t dist = _pos - cand;
+          if (cand >= _pos || dist > DEFLATE_WINDOW) break;
+          if (_buf[cand + bestLen] == _buf[_pos + bestLen]) {
+            size_t len = 0;
+            while (len < maxLen && _buf[cand + len] == _buf[_pos + len]) len++;
+            if (len > bestLen) {
+              bestLen = len;
+              bestDist = dist;
+              if (len == maxLen) break;
+            }
+          }
+          uint16_t next = _prev[cand & (DEFLATE_WINDOW - 1)];
+          if (next >= cand) break;
+          cand = next;
+        }
+        insert(_pos);
+      }
+
+      if (bestLen >= DEFLATE_MIN_MATCH) {
+        putMatch(bestLen, bestDist);
+        for (size_t k = 1; k < bestLen; k++) {
+          if (_pos + k + DEFLATE_MIN_MATCH <= _end) insert(_pos + k);
+        }
+        _pos += bestLen;
+      } else {
+        putLiteral(_buf[_pos]);
+        _pos++;
+      }
+    }
+  }
+
+  // Drops the oldest window once both halves are full.
+  void slide() {
+    memmove(_buf, _buf + DEFLATE_WINDOW, DEFLATE_WINDOW);
+    _pos -= DEFLATE_WINDOW;
+    _end -= DEFLATE_WINDOW;
+    for (size_t i = 0; i < DEFLATE_HASH_SIZE; i++) {
+      _head[i] = (_head[i] != NIL && _head[i] >= DEFLATE_WINDOW) ? _head[i] - DEFLATE_WINDOW : NIL;
+    }
+    for (size_t i = 0; i < DEFLATE_WINDOW; i++) {
+      _prev[i] = (_prev[i] != NIL && _prev[i] >= DEFLATE_WINDOW) ? _prev[i] - DEFLATE_WINDOW : NIL;
+    }
+  }
+};
+
+//=========================================================
+// HTTP HELPERS
+//=========================================================
+// Chunked response body for WebServer (after setContentLength(CONTENT_LENGTH_UNKNOWN))
+class ChunkedResponse : public Print {
+public:
+  explicit ChunkedResponse(WebServer& server) : _server(server) {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override {
+    _server.sendContent((const char*)data, len);
+    return len;
+  }
+private:
+  WebServer& _server;
+};
+
+struct DownloadReport {
+  const char* what;
+  const char* encoding;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  unsigned long startMs;
+  uint32_t heapStart;
+  uint32_t heapMin;
+};
+
+inline void sampleHeap(DownloadReport& r) {
+  uint32_t h = ESP.getFreeHeap();
+  if (h < r.heapMin) r.heapMin = h;
+}
+
+inline void printDownloadReport(const DownloadReport& r) {
+  unsigned long ms = millis() - r.startMs;
+  Serial.printf("[Download] %s (%s): %u -> %u bytes (%u%%) in %lu ms, %lu KB/s, peak heap use %u bytes (min free %u)\n",
+                r.what, r.encoding, r.bytesIn, r.bytesOut,
+                r.bytesIn ? (unsigned)((uint64_t)r.bytesOut * 100 / r.bytesIn) : 100,
+                ms, ms ? (unsigned long)(r.bytesOut / ms) : 0UL,
+                r.heapStart - r.heapMin, r.heapMin);
+}
+
+inline String httpDate(time_t t) {
+  char buf[40];
+  struct tm tmv;
+  gmtime_r(&t, &tmv);
+  strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+  return String(buf);
+}
+
+// "Sun, 06 Nov 1994 08:49:37 GMT" -> unix time, 0 if unparsable
+inline time_t parseHttpDate(const String& s) {
+  char mon[4] = {0};
+  int d, y, hh, mm, ss;
+  int comma = s.indexOf(',');
+  if (comma < 0 || sscanf(s.c_str() + comma + 1, " %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) return 0;
+  static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  const char* m = strstr(months, mon);
+  if (!m || strlen(mon) != 3) return 0;
+  int month = (m - months) / 3 + 1;
+  // days from civil (proleptic Gregorian), no timegm() in newlib
+  y -= month <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = era * 146097 + doe - 719468;
+  return (time_t)(days * 86400L + hh * 3600L + mm * 60L + ss);
+}
+
+// Empty or all digits
+inline bool isDecimal(const String& s) {
+  for (size_t i = 0; i < s.length(); i++) {
+    if (s[i] < '0' || s[i] > '9') return false;
+  }
+  return true;
+}
+
+// Strong validator per representation: same file, different tag for gzip.
+inline String sdFileEtag(time_t mtime, size_t size, bool gzip) {
+  char tag[32];
+  snprintf(tag, sizeof(tag), "\"%lx-%x%s\"", (unsigned long)mtime, (unsigned)size, gzip ? "-gz" : "");
+  return String(tag);
+}
+
+inline bool clientAcceptsGzip(WebServer& server) {
+  return server.hasHeader("Accept-Encoding") && server.header("Accept-Encoding").indexOf("gzip") >= 0;
+}
+
+// Reads up to len bytes with the SD mutex held only for this read.
+inline int readSdChunk(File& file, uint8_t* buf, size_t len, SemaphoreHandle_t sdMutex) {
+  xSemaphoreTake(sdMutex, portMAX_DELAY);
+  int n = file.read(buf, len);
+  xSemaphoreGive(sdMutex);
+  return n;
+}
+
+//=========================================================
+// SINGLE FILE
+//=========================================================
+inline void serveSdFile(WebServer& server, const String& path, SemaphoreHandle_t sdMutex) {
+  if (path.length() == 0 || path.indexOf("..") != -1) {
+    server.send(400, "text/plain", "Bad Request: Invalid file path.");
+    return;
+  }
+  xSemaphoreTake(sdMutex, portMAX_DELAY);
+  File file = SD.open(path, FILE_READ);
+  bool isFile = file && !file.isDirectory();
+  size_t size = isFile ? file.size() : 0;
+  time_t mtime = isFile ? file.getLastWrite() : 0;
+  if (file && !isFile) file.close();
+  xSemaphoreGive(sdMutex);
+  if (!isFile) {
+    server.send(404, "text/plain", "File Not Found");
+    return;
+  }
+
+  bool validTime = mtime > 1600000000;   // FAT timestamp written with NTP time
+  if (validTime && server.hasHeader("If-Modified-Since")) {
+    time_t since = parseHttpDate(server.header("If-Modified-Since"));
+    if (since && mtime <= since) {
+      xSemaphoreTake(sdMutex, portMAX_DELAY);
+      file.close();
+      xSemaphoreGive(sdMutex);
+      server.sendHeader("Last-Modified", httpDate(mtime));
+      server.send(304, "text/plain", "");
+      return;
+    }
+  }
+
+  // Range (single range only). Ignored when If-Range is not the uncompressed
+  // ETag; a date could come from a gzip response and is not accepted.
+  size_t first = 0, last = size ? size - 1 : 0;
+  bool ranged = false;
+  if (server.hasHeader("Range") && size > 0) {
+    bool rangeApplies = !server.hasHeader("If-Range") ||
+                        (validTime && server.header("If-Range") == sdFileEtag(mtime, size, false));
+    String range = server.header("Range");
+    String spec = range.substring(6);
+    int dash = spec.indexOf('-');
+    String firstStr = dash >= 0 ? spec.substring(0, dash) : "";
+    String lastStr = dash >= 0 ? spec.substring(dash + 1) : "";
+    // Malformed or multi-range headers are ignored and the whole file is sent.
+    // "last < first" is invalid syntax too (RFC 9110 14.1.1), not a 416.
+    bool valid = range.startsWith("bytes=") && range.indexOf(',') < 0 && dash >= 0 &&
+                 isDecimal(firstStr) && isDecimal(lastStr) && (firstStr.length() || lastStr.length()) &&
+                 !(firstStr.length() && lastStr.length() && lastStr.toInt() < firstStr.toInt());
+    if (rangeApplies && valid) {
+      bool ok;
+      if (dash == 0) {                              // bytes=-N (last N bytes)
+        long n = lastStr.toInt();
+        ok = n > 0;
+        if (ok) first = (size_t)n >= size ? 0 : size - n;
+      } else {
+        first = firstStr.toInt();
+        if (lastStr.length()) {
+          size_t end = lastStr.toInt();
+          if (end < last) last = end;
+        }
+        ok = first < size;
+      }
+      if (!ok) {
+        xSemaphoreTake(sdMutex, portMAX_DELAY);
+        file.close();
+        xSemaphoreGive(sdMutex);
+        server.sendHeader("Content-Range", "bytes */" + String(size));
+        server.send(416, "text/plain", "Range Not Satisfiable");
+        return;
+      }
+      ranged = true;
+    }
+  }
+
+  String fileName = path.substring(path.lastIndexOf('/') + 1);
+  server.sendHeader("Content-Disposition", "attachment; filename=" + fileName);
+  if (validTime) server.sendHeader("Last-Modified", httpDate(mtime));
+
+  DownloadReport report = { path.c_str(), "identity", 0, 0, millis(), ESP.getFreeHeap(), ESP.getFreeHeap() };
+  uint8_t buf[DOWNLOAD_READ_CHUNK];
+
+  ChunkedResponse chunked(server);
+  GzipStream gz(chunked);
+  if (!ranged && size > 0 && clientAcceptsGzip(server) && gz.begin((uint32_t)(validTime ? mtime : 0))) {
+    report.encoding = "gzip";
+    sampleHeap(report);
+    server.sendHeader("Content-Encoding", "gzip");
+    server.sendHeader("Vary", "Accept-Encoding");
+    server.sendHeader("Accept-Ranges", "none");
+    if (validTime) server.sendHeader("ETag", sdFileEtag(mtime, size, true));
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+    int n;
+    while ((n = readSdChunk(file, buf, sizeof(buf), sdMutex)) > 0 && server.client().connected()) {
+      gz.write(buf, n);
+      sampleHeap(report);
+    }
+    gz.finish();
+    server.sendContent("");
+    report.bytesIn = gz.bytesIn();
+    report.bytesOut = gz.bytesOut();
+  } else {
+    size_t remaining = size ? last - first + 1 : 0;
+    server.sendHeader("Accept-Ranges", "bytes");
+    if (validTime) server.sendHeader("ETag", sdFileEtag(mtime, size, false));
+    if (ranged) {
+      server.sendHeader("Content-Range", "bytes " + String(first) + "-" + String(last) + "/" + String(size));
+      xSemaphoreTake(sdMutex, portMAX_DELAY);
+      file.seek(first);
+      xSemaphoreGive(sdMutex);
+    }
+    server.setContentLength(remaining);
+    server.send(ranged ? 206 : 200, "application/octet-stream", "");
+    while (remaining > 0 && server.client().connected()) {
+      int n = readSdChunk(file, buf, remaining < sizeof(buf) ? remaining : sizeof(buf), sdMutex);
+      if (n <= 0) break;
+      server.client().write(buf, n);
+      remaining -= n;
+      report.bytesIn += n;
+      sampleHeap(report);
+    }
+    report.bytesOut = report.bytesIn;
+    if (ranged) report.encoding = "range";
+  }
+
+  xSemaphoreTake(sdMutex, portMAX_DELAY);
+  file.close();
+  xSemaphoreGive(sdMutex);
+  printDownloadReport(report);
+}
+
+//=========================================================
+// MULTI-FILE ARCHIVE (.tar.gz)
+//=========================================================
+inline void tarOctal(char* field, size_t width, uint32_t value) {
+  snprintf(field, width, "%0*lo", (int)width - 1, (unsigned long)value);
+}
+
+inline void writeTarHeader(GzipStream& gz, const String& name, uint32_t size, uint32_t mtime) {
+  uint8_t h[512];
+  memset(h, 0, sizeof(h));
+  strncpy((char*)h, name.c_str(), 99);
+  tarOctal((char*)h + 100, 8, 0644);
+  tarOctal((char*)h + 108, 8, 0);
+  tarOctal((char*)h + 116, 8, 0);
+  tarOctal((char*)h + 124, 12, size);
+  tarOctal((char*)h + 136, 12, mtime);
+  memset(h + 148, ' ', 8);
+  h[156] = '0';
+  memcpy(h + 257, "ustar", 6);
+  memcpy(h + 263, "00", 2);
+  uint32_t sum = 0;
+  for (uint8_t b : h) sum += b;
+  snprintf((char*)h + 148, 8, "%06lo", (unsigned long)sum);
+  gz.write(h, sizeof(h));
+}
+
+// Collects every file below dirPath (up to DOWNLOAD_ARCHIVE_MAX_DEPTH levels)
+// whose path relative to root starts with prefix. Caller holds the SD mutex.
+inline void listSdFiles(const String& root, const String& dirPath, const String& prefix,
+                        std::vector<String>& out, int depth = 0) {
+  File dir = SD.open(dirPath);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return;
+  }
+  while (true) {
+    File entry = dir.openNextFile();
+    if (!entry) break;
+    String name = entry.name();
+    String path = dirPath + "/" + name.substring(name.lastIndexOf('/') + 1);
+    bool isDir = entry.isDirectory();
+    entry.close();
+    String rel = path.substring(root.length() + 1);
+    if (isDir) {
+      // Only descend where a match is still possible ("2025/06/" vs "2025")
+      bool mayMatch = rel.startsWith(prefix) || prefix.startsWith(rel + "/");
+      if (mayMatch && depth < DOWNLOAD_ARCHIVE_MAX_DEPTH) listSdFiles(root, path, prefix, out, depth + 1);
+    } else if (rel.startsWith(prefix)) {
+      out.push_back(path);
+    }
+  }
+  dir.close();
+}
+
+// Streams extraFiles plus every file below dirPath whose path relative to
+// dirPath starts with prefix as one .tar.gz: "2025-06" for flat /logs/2025-06-01.csv
+// logs, "2025/06/" for /logs/2025/06/01.csv. Member names keep the full SD path.
+// Files are read in order with the mutex taken per chunk.
+inline void serveSdArchive(WebServer& server, const char* dirPath, const String& prefix,
+                           const char* const* extraFiles, size_t extraCount,
+                           const String& archiveName, SemaphoreHandle_t sdMutex) {
+  std::vector<String> paths;
+  xSemaphoreTake(sdMutex, portMAX_DELAY);
+  for (size_t i = 0; i < extraCount; i++) {
+    if (SD.exists(extraFiles[i])) paths.push_back(extraFiles[i]);
+  }
+  std::vector<String> logs;
+  listSdFiles(dirPath, dirPath, prefix, logs);
+  xSemaphoreGive(sdMutex);
+  std::sort(logs.begin(), logs.end(), [](const String& a, const String& b) { return a.compareTo(b) < 0; });
+  paths.insert(paths.end(), logs.begin(), logs.end());
+
+  if (paths.empty()) {
+    server.send(404, "text/plain", "No matching files.");
+    return;
+  }
+
+  DownloadReport report = { archiveName.c_str(), "tar.gz", 0, 0, millis(), ESP.getFreeHeap(), ESP.getFreeHeap() };
+  ChunkedResponse chunked(server);
+  GzipStream gz(chunked);
+  if (!gz.begin((uint32_t)time(nullptr))) {
+    server.send(503, "text/plain", "Not enough memory for compression.");
+    return;
+  }
+  sampleHeap(report);
+  server.sendHeader("Content-Disposition", "attachment; filename=" + archiveName);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/gzip", "");
+
+  uint8_t buf[DOWNLOAD_READ_CHUNK];
+  for (const String& path : paths) {
+    if (!server.client().connected()) break;
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    File file = SD.open(path, FILE_READ);
+    uint32_t size = file ? file.size() : 0;       // fixed now; today's log may still grow
+    uint32_t mtime = file ? (uint32_t)file.getLastWrite() : 0;
+    xSemaphoreGive(sdMutex);
+    if (!file) continue;
+
+    writeTarHeader(gz, path.substring(1), size, mtime);
+    uint32_t remaining = size;
+    while (remaining > 0) {
+      int n = readSdChunk(file, buf, remaining < sizeof(buf) ? remaining : sizeof(buf), sdMutex);
+      if (n <= 0) break;
+      gz.write(buf, n);
+      remaining -= n;
+      sampleHeap(report);
+    }
+    memset(buf, 0, sizeof(buf));
+    while (remaining > 0) {                        // file shrank: keep the tar consistent
+      uint32_t n = remaining < sizeof(buf) ? remaining : sizeof(buf);
+      gz.write(buf, n);
+      remaining -= n;
+    }
+    if (size % 512) gz.write(buf, 512 - size % 512);
+
+    xSemaphoreTake(sdMutex, portMAX_DELAY);
+    file.close();
+    xSemaphoreGive(sdMutex);
+  }
+  memset(buf, 0, sizeof(buf));
+  gz.write(buf, 1024);                             // end-of-archive marker
+  gz.finish();
+  server.sendContent("");
+
+  report.bytesIn = gz.bytesIn();
+  report.bytesOut = gz.bytesOut();
+  Serial.printf("[Download] Archive with %u files.\n", (unsigned)paths.size());
+  printDownloadReport(report);
+}
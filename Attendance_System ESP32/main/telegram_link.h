@@ -0,0 +1,520 @@
+/**
+ * @file telegram_link.h
+ * @brief Long-polling Telegram Bot API channel on one persistent TLS session.
+ *
+ * A background FreeRTOS task owns a single keep-alive HTTPS connection to the
+ * Bot API. It long-polls getUpdates (timeout=TELEGRAM_LONG_POLL_S) with offset
+ * tracking. Each message from the allowed chat is pushed as a TelegramCommand
+ * onto a queue; the sketch drains that queue with nextCommand(). Replies and
+ * alerts go onto an outgoing queue (reply()/send(), callable from any task) and
+ * are written by the same task on the same session: right after a poll
+ * returns, and before the next poll starts. sendLatest() is for repeating
+ * status messages: it keeps only the newest one and waits for the poll.
+ *
+ * Compared to calling UniversalTelegramBot::getUpdates() every second, a
+ * command arrives as soon as Telegram has it (no poll interval) and there is
+ * no TLS handshake per request. The wait for data sleeps (vTaskDelay) instead
+ * of spinning, so a pending long poll costs no CPU.
+ *
+ * A message queued while a long poll is still unanswered ends that poll: the
+ * session is closed and the message goes out right away on a new one. Nothing
+ * is lost, the offset only moves past updates that were read. The price is one
+ * handshake per interrupted poll (interrupted= in printStats()).
+ *
+ * Per poll the task measures active CPU time (wall time minus sleeping), heap
+ * and handshakes. Per reply it measures command -> reply latency. See
+ * printStats().
+ *
+ * For testing without Telegram, esp32_Telegram_Bot/bench/telegram_standin.py
+ * serves getUpdates/sendMessage over plain HTTP. Define these above the
+ * #include (the host must be a string literal, it also goes into Host:):
+ *
+ *   #define TELEGRAM_API_HOST "192.168.1.50"
+ *   #define TELEGRAM_API_PORT 8081
+ *   #define TELEGRAM_API_TLS  0
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <ArduinoJson.h>
+#include <time.h>
+
+#ifndef TELEGRAM_API_HOST
+#define TELEGRAM_API_HOST       "api.telegram.org"
+#endif
+#ifndef TELEGRAM_API_PORT
+#define TELEGRAM_API_PORT       443
+#endif
+#ifndef TELEGRAM_API_TLS
+#define TELEGRAM_API_TLS        1
+#endif
+#ifndef TELEGRAM_LONG_POLL_S
+#define TELEGRAM_LONG_POLL_S    25      // server-side wait of getUpdates
+#endif
+
+#define TELEGRAM_TEXT_MAX           128     // incoming command text
+#define TELEGRAM_REPLY_MAX          512     // outgoing message text
+#define TELEGRAM_COMMAND_QUEUE_LEN  8
+#define TELEGRAM_REPLY_QUEUE_LEN    8
+#define TELEGRAM_POLL_LIMIT         3       // updates per getUpdates
+#define TELEGRAM_MAX_BODY           16384
+#define TELEGRAM_SEND_TIMEOUT_MS    8000
+#define TELEGRAM_REPLY_WINDOW_MS    300     // after commands arrive, wait this long for replies before re-polling
+#define TELEGRAM_RETRY_MS           2000
+#define TELEGRAM_STATS_INTERVAL_MS  300000
+#define TELEGRAM_POLL_INTERRUPTED   -2      // request() result: long poll given up for an outgoing message
+#define TELEGRAM_TASK_STACK         10000
+
+struct TelegramCommand {
+  char chatId[24];
+  char fromName[33];
+  char text[TELEGRAM_TEXT_MAX];
+  uint32_t updateId;
+  uint32_t receivedMs;          // millis() when the poll returned it
+  uint32_t sentAt;              // Telegram message date (unix seconds)
+};
+
+struct TelegramOutgoing {
+  char chatId[24];
+  char parseMode[12];
+  char text[TELEGRAM_REPLY_MAX];
+  uint32_t commandReceivedMs;   // 0 for unsolicited messages
+  uint32_t commandSentAt;
+};
+
+struct TelegramLinkStats {
+  uint32_t polls;
+  uint32_t emptyPolls;
+  uint32_t pollErrors;
+  uint32_t pollsInterrupted;    // ended early because a message was queued
+  uint32_t updates;
+  uint32_t commandsDropped;     // command queue full
+  uint32_t unauthorized;
+  uint32_t sent;
+  uint32_t sendErrors;
+  uint32_t sendDropped;         // outgoing queue full
+  uint32_t handshakes;
+  uint32_t lastHandshakeMs;
+  uint32_t maxHandshakeMs;
+  uint32_t lastPollCpuUs;       // active time of the last poll (excludes sleeping on the socket)
+  uint32_t maxPollCpuUs;
+  uint64_t totalPollCpuUs;
+  uint32_t latencySamples;
+  uint32_t lastReplyMs;         // command received -> reply delivered
+  uint32_t maxReplyMs;
+  uint64_t totalReplyMs;
+  int32_t lastEndToEndS;        // Telegram message date -> reply delivered, -1 if clock not set
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  int32_t lastPollHeapDelta;
+  uint32_t stackHighWater;
+};
+
+class TelegramLink {
+public:
+  // rootCA == nullptr -> certificate is not verified (setInsecure).
+  bool begin(const char* token, const char* allowedChatId, const char* rootCA = nullptr,
+             BaseType_t core = 0, UBaseType_t priority = 1) {
+    _token = token;
+    _allowedChatId = allowedChatId;
+#if TELEGRAM_API_TLS
+    if (rootCA) _tls.setCACert(rootCA); else _tls.setInsecure();
+    _client = &_tls;
+#else
+    (void)rootCA;
+    _client = &_plain;
+#endif
+    _commands = xQueueCreate(TELEGRAM_COMMAND_QUEUE_LEN, sizeof(TelegramCommand));
+    _outgoing = xQueueCreate(TELEGRAM_REPLY_QUEUE_LEN, sizeof(TelegramOutgoing));
+    _latest = xQueueCreate(1, sizeof(TelegramOutgoing));
+    if (!_commands || !_outgoing || !_latest) {
+      Serial.println("[Telegram] ERROR: queues could not be created.");
+      return false;
+    }
+    return xTaskCreatePinnedToCore(taskEntry, "Telegram_Task", TELEGRAM_TASK_STACK, this, priority, &_task, core) == pdPASS;
+  }
+
+  // Called by the sketch's main logic; wait = 0 returns immediately.
+  bool nextCommand(TelegramCommand& out, TickType_t wait = 0) {
+    return _commands && xQueueReceive(_commands, &out, wait) == pdTRUE;
+  }
+
+  bool reply(const TelegramCommand& cmd, const String& text, const char* parseMode = "") {
+    return enqueue(cmd.chatId, text, parseMode, cmd.receivedMs, cmd.sentAt);
+  }
+
+  bool send(const char* chatId, const String& text, const char* parseMode = "") {
+    return enqueue(chatId, text, parseMode, 0, 0);
+  }
+
+  // One slot, overwritten by each call: a series of status messages cannot
+  // fill the outgoing queue or arrive as a burst of stale ones. Does not end
+  // a pending long poll; goes out before send() messages when it returns.
+  bool sendLatest(const char* chatId, const String& text, const char* parseMode = "") {
+    if (!_latest) return false;
+    TelegramOutgoing m = makeOutgoing(chatId, text, parseMode, 0, 0);
+    xQueueOverwrite(_latest, &m);
+    return true;
+  }
+
+  TelegramLinkStats stats() {
+    portENTER_CRITICAL(&_statsMux);
+    TelegramLinkStats copy = _stats;
+    portEXIT_CRITICAL(&_statsMux);
+    return copy;
+  }
+
+  void printStats() {
+    TelegramLinkStats s = stats();
+    uint32_t activePolls = s.polls ? s.polls : 1;
+    uint32_t samples = s.latencySamples ? s.latencySamples : 1;
+    Serial.printf("[Telegram] polls=%u empty=%u err=%u interrupted=%u updates=%u dropped=%u | sent=%u err=%u | handshakes=%u (last %u ms, max %u ms)\n",
+                  s.polls, s.emptyPolls, s.pollErrors, s.pollsInterrupted, s.updates, s.commandsDropped, s.sent, s.sendErrors,
+                  s.handshakes, s.lastHandshakeMs, s.maxHandshakeMs);
+    Serial.printf("[Telegram] cpu/poll avg=%u us max=%u us | reply latency last=%u ms avg=%u ms max=%u ms e2e=%d s | heap free=%u min=%u delta=%d | stack free=%u\n",
+                  (uint32_t)(s.totalPollCpuUs / activePolls), s.maxPollCpuUs,
+                  s.lastReplyMs, (uint32_t)(s.totalReplyMs / samples), s.maxReplyMs, (int)s.lastEndToEndS,
+                  s.freeHeap, s.minFreeHeap, (int)s.lastPollHeapDelta, s.stackHighWater);
+  }
+
+private:
+  const char* _token = nullptr;
+  const char* _allowedChatId = nullptr;
+  WiFiClientSecure _tls;
+  WiFiClient _plain;
+  Client* _client = nullptr;
+  QueueHandle_t _commands = nullptr;
+  QueueHandle_t _outgoing = nullptr;
+  QueueHandle_t _latest = nullptr;      // sendLatest() slot
+  TaskHandle_t _task = nullptr;
+  uint32_t _offset = 0;
+  uint32_t _sleepUs = 0;        // time spent sleeping on the socket during the current request
+  TelegramLinkStats _stats = {};
+  portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+  static void taskEntry(void* arg) { static_cast<TelegramLink*>(arg)->run(); }
+
+  static TelegramOutgoing makeOutgoing(const char* chatId, const String& text, const char* parseMode,
+                                       uint32_t receivedMs, uint32_t sentAt) {
+    TelegramOutgoing m = {};
+    strncpy(m.chatId, chatId, sizeof(m.chatId) - 1);
+    strncpy(m.parseMode, parseMode ? parseMode : "", sizeof(m.parseMode) - 1);
+    strncpy(m.text, text.c_str(), sizeof(m.text) - 1);
+    m.commandReceivedMs = receivedMs;
+    m.commandSentAt = sentAt;
+    return m;
+  }
+
+  bool enqueue(const char* chatId, const String& text, const char* parseMode, uint32_t receivedMs, uint32_t sentAt) {
+    if (!_outgoing) return false;
+    TelegramOutgoing m = makeOutgoing(chatId, text, parseMode, receivedMs, sentAt);
+    if (xQueueSend(_outgoing, &m, 0) != pdTRUE) {
+      portENTER_CRITICAL(&_statsMux);
+      _stats.sendDropped++;
+      portEXIT_CRITICAL(&_statsMux);
+      return false;
+    }
+    return true;
+  }
+
+  void run() {
+    Serial.printf("[Telegram] Task started on Core %d (long poll %d s).\n", xPortGetCoreID(), TELEGRAM_LONG_POLL_S);
+    unsigned long lastStats = millis();
+    for (;;) {
+      if (WiFi.status() != WL_CONNECTED) {
+        vTaskDelay(500 / portTICK_PERIOD_MS);
+        continue;
+      }
+
+      flushOutgoing(0);
+      int got = poll();
+      if (got < 0) {
+        vTaskDelay(TELEGRAM_RETRY_MS / portTICK_PERIOD_MS);
+      } else if (got > 0) {
+        // Give the consumer a moment to answer so the replies go out before
+        // the session is tied up by the next long poll.
+        flushOutgoing(TELEGRAM_REPLY_WINDOW_MS);
+      }
+
+      if (millis() - lastStats > TELEGRAM_STATS_INTERVAL_MS) {
+        printStats();
+        lastStats = millis();
+      }
+    }
+  }
+
+  // One getUpdates round trip. Returns number of updates, -1 on error.
+  int poll() {
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t t0 = micros();
+    _sleepUs = 0;
+
+    String path = "/bot";
+    path += _token;
+    path += "/getUpdates?offset=";
+    path += _offset;
+    path += "&limit=" + String(TELEGRAM_POLL_LIMIT);
+    path += "&timeout=" + String(TELEGRAM_LONG_POLL_S);
+    path += "&allowed_updates=%5B%22message%22%5D";
+
+    String body;
+    int status = request("GET", path, "", (TELEGRAM_LONG_POLL_S + 10) * 1000UL, body, true);
+    int count = -1;
+    if (status == 200) count = parseUpdates(body);
+    else if (status == TELEGRAM_POLL_INTERRUPTED) count = 0;
+    else Serial.printf("[Telegram] getUpdates failed (HTTP %d)\n", status);
+
+    uint32_t wall = micros() - t0;
+    uint32_t active = wall > _sleepUs ? wall - _sleepUs : 0;
+    uint32_t heapAfter = ESP.getFreeHeap();
+
+    portENTER_CRITICAL(&_statsMux);
+    _stats.polls++;
+    if (status == TELEGRAM_POLL_INTERRUPTED) _stats.pollsInterrupted++;
+    else if (count < 0) _stats.pollErrors++;
+    else if (count == 0) _stats.emptyPolls++;
+    else _stats.updates += count;
+    _stats.lastPollCpuUs = active;
+    if (active > _stats.maxPollCpuUs) _stats.maxPollCpuUs = active;
+    _stats.totalPollCpuUs += active;
+    _stats.freeHeap = heapAfter;
+    _stats.minFreeHeap = ESP.getMinFreeHeap();
+    _stats.lastPollHeapDelta = (int32_t)heapAfter - (int32_t)heapBefore;
+    _stats.stackHighWater = uxTaskGetStackHighWaterMark(NULL);
+    portEXIT_CRITICAL(&_statsMux);
+    return count;
+  }
+
+  int parseUpdates(const String& body) {
+    StaticJsonDocument<256> filter;
+    filter["ok"] = true;
+    JsonObject f = filter["result"].createNestedObject();
+    f["update_id"] = true;
+    f["message"]["text"] = true;
+    f["message"]["date"] = true;
+    f["message"]["chat"]["id"] = true;
+    f["message"]["from"]["first_name"] = true;
+
+    DynamicJsonDocument doc(body.length() + 1024);
+    DeserializationError err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+    if (err || !doc["ok"].as<bool>()) {
+      Serial.printf("[Telegram] Bad getUpdates response: %s\n", err ? err.c_str() : "ok=false");
+      skipFirstUpdate(body);
+      return -1;
+    }
+
+    int count = 0;
+    uint32_t now = millis();
+    for (JsonObject u : doc["result"].as<JsonArray>()) {
+      uint32_t id = u["update_id"].as<uint32_t>();
+      _offset = id + 1;   // confirms this update on the next poll
+      count++;
+
+      JsonObject msg = u["message"];
+      const char* text = msg["text"] | (const char*)nullptr;
+      if (!text) continue;  // stickers, photos, ...
+
+      TelegramCommand cmd = {};
+      snprintf(cmd.chatId, sizeof(cmd.chatId), "%lld", msg["chat"]["id"].as<long long>());
+      strncpy(cmd.fromName, msg["from"]["first_name"] | "", sizeof(cmd.fromName) - 1);
+      strncpy(cmd.text, text, sizeof(cmd.text) - 1);
+      cmd.updateId = id;
+      cmd.receivedMs = now;
+      cmd.sentAt = msg["date"].as<uint32_t>();
+
+      if (_allowedChatId && strcmp(cmd.chatId, _allowedChatId) != 0) {
+        portENTER_CRITICAL(&_statsMux);
+        _stats.unauthorized++;
+        portEXIT_CRITICAL(&_statsMux);
+        enqueue(cmd.chatId, "Unauthorized user", "", 0, 0);
+        continue;
+      }
+      if (xQueueSend(_commands, &cmd, 0) != pdTRUE) {
+        portENTER_CRITICAL(&_statsMux);
+        _stats.commandsDropped++;
+        portEXIT_CRITICAL(&_statsMux);
+      }
+    }
+    return count;
+  }
+
+  // An update we cannot parse (e.g. longer than TELEGRAM_MAX_BODY) would be
+  // delivered again on every poll. Confirm it so the link does not get stuck.
+  void skipFirstUpdate(const String& body) {
+    int at = body.indexOf("\"update_id\":");
+    if (at < 0) return;
+    uint32_t id = strtoul(body.c_str() + at + 12, nullptr, 10);
+    if (id + 1 > _offset) {
+      _offset = id + 1;
+      Serial.printf("[Telegram] Skipping unreadable update %u.\n", id);
+    }
+  }
+
+  // Sends everything queued; keeps waiting up to windowMs for more.
+  void flushOutgoing(uint32_t windowMs) {
+    TelegramOutgoing m;
+    if (xQueueReceive(_latest, &m, 0) == pdTRUE) sendMessage(m);
+    uint32_t deadline = millis() + windowMs;
+    for (;;) {
+      int32_t left = (int32_t)(deadline - millis());
+      TickType_t wait = left > 0 ? pdMS_TO_TICKS(left) : 0;
+      if (xQueueReceive(_outgoing, &m, wait) != pdTRUE) return;
+      sendMessage(m);
+    }
+  }
+
+  void sendMessage(const TelegramOutgoing& m) {
+    StaticJsonDocument<256> doc;
+    doc["chat_id"] = (const char*)m.chatId;
+    doc["text"] = (const char*)m.text;
+    if (m.parseMode[0]) doc["parse_mode"] = (const char*)m.parseMode;
+    String payload;
+    serializeJson(doc, payload);
+
+    String path = "/bot";
+    path += _token;
+    path += "/sendMessage";
+    String body;
+    int status = request("POST", path, payload, TELEGRAM_SEND_TIMEOUT_MS, body);
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_statsMux);
+    if (status == 200) {
+      _stats.sent++;
+      if (m.commandReceivedMs) {
+        uint32_t lat = now - m.commandReceivedMs;
+        _stats.lastReplyMs = lat;
+        if (lat > _stats.maxReplyMs) _stats.maxReplyMs = lat;
+        _stats.totalReplyMs += lat;
+        _stats.latencySamples++;
+        time_t wallNow = time(nullptr);
+        _stats.lastEndToEndS = (wallNow > 1600000000 && m.commandSentAt) ? (int32_t)(wallNow - m.commandSentAt) : -1;
+      }
+    } else {
+      _stats.sendErrors++;
+    }
+    portEXIT_CRITICAL(&_statsMux);
+    if (status != 200) Serial.printf("[Telegram] sendMessage failed (HTTP %d)\n", status);
+  }
+
+  bool ensureConnected() {
+    if (_client->connected()) return true;
+    uint32_t t0 = millis();
+    if (!_client->connect(TELEGRAM_API_HOST, TELEGRAM_API_PORT)) {
+      Serial.println("[Telegram] Connection to API host failed.");
+      return false;
+    }
+    uint32_t took = millis() - t0;
+    portENTER_CRITICAL(&_statsMux);
+    _stats.handshakes++;
+    _stats.lastHandshakeMs = took;
+    if (took > _stats.maxHandshakeMs) _stats.maxHandshakeMs = took;
+    portEXIT_CRITICAL(&_statsMux);
+    Serial.printf("[Telegram] Session opened in %u ms.\n", took);
+    return true;
+  }
+
+  // One HTTP/1.1 keep-alive request. Retries once on a fresh connection if the
+  // server had closed the idle session. Returns HTTP status or -1, or
+  // TELEGRAM_POLL_INTERRUPTED if yieldToOutgoing gave up the wait.
+  int request(const char* method, const String& path, const String& payload, uint32_t timeoutMs, String& body,
+              bool yieldToOutgoing = false) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (!ensureConnected()) return -1;
+      _client->print(method);
+      _client->print(" ");
+      _client->print(path);
+      _client->print(" HTTP/1.1\r\nHost: " TELEGRAM_API_HOST "\r\nConnection: keep-alive\r\nAccept: application/json\r\n");
+      if (payload.length()) {
+        _client->print("Content-Type: application/json\r\nContent-Length: ");
+        _client->print(payload.length());
+        _client->print("\r\n\r\n");
+        _client->print(payload);
+      } else {
+        _client->print("\r\n");
+      }
+      int status = readResponse(body, millis() + timeoutMs, yieldToOutgoing);
+      if (status > 0 || status == TELEGRAM_POLL_INTERRUPTED) return status;
+      _client->stop();  // broken session, reconnect once
+    }
+    return -1;
+  }
+
+  bool waitData(uint32_t deadline, bool yieldToOutgoing = false) {
+    while (!_client->available()) {
+      if (!_client->connected() || (int32_t)(millis() - deadline) > 0) return false;
+      if (yieldToOutgoing && uxQueueMessagesWaiting(_outgoing)) return false;
+      uint32_t t = micros();
+      vTaskDelay(5 / portTICK_PERIOD_MS);
+      _sleepUs += micros() - t;
+    }
+    return true;
+  }
+
+  bool readLine(String& line, uint32_t deadline) {
+    line = "";
+    for (;;) {
+      if (!waitData(deadline)) return false;
+      int c = _client->read();
+      if (c == '\n') return true;
+      if (c >= 0 && c != '\r' && line.length() < 256) line += (char)c;
+    }
+  }
+
+  bool readBytes(String& body, size_t n, uint32_t deadline) {
+    uint8_t buf[256];
+    while (n > 0) {
+      if (!waitData(deadline)) return false;
+      int r = _client->read(buf, n < sizeof(buf) ? n : sizeof(buf));
+      if (r <= 0) continue;
+      if (body.length() + r <= TELEGRAM_MAX_BODY) body.concat((const char*)buf, r);
+      n -= r;
+    }
+    return true;
+  }
+
+  int readResponse(String& body, uint32_t deadline, bool yieldToOutgoing = false) {
+    body = "";
+    // Only before the first byte: once the server answers, the reply is read in full.
+    if (yieldToOutgoing && !waitData(deadline, true)) {
+      _client->stop();
+      return uxQueueMessagesWaiting(_outgoing) ? TELEGRAM_POLL_INTERRUPTED : -1;
+    }
+    String line;
+    if (!readLine(line, deadline) || !line.startsWith("HTTP/1.")) return -1;
+    int status = line.substring(9, 12).toInt();
+
+    long contentLength = -1;
+    bool chunked = false, closeAfter = false, headersDone = false;
+    while (readLine(line, deadline)) {
+      if (line.length() == 0) { headersDone = true; break; }
+      line.toLowerCase();
+      if (line.startsWith("content-length:")) contentLength = line.substring(15).toInt();
+      else if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") > 0) chunked = true;
+      else if (line.startsWith("connection:") && line.indexOf("close") > 0) closeAfter = true;
+    }
+    if (!headersDone) {   // cut off mid-headers: whatever followed would be a truncated body
+      _client->stop();
+      return -1;
+    }
+
+    bool ok = true;
+    if (chunked) {
+      for (;;) {
+        if (!readLine(line, deadline)) { ok = false; break; }
+        long size = strtol(line.c_str(), nullptr, 16);
+        if (size <= 0) { readLine(line, deadline); break; }
+        if (!readBytes(body, size, deadline) || !readLine(line, deadline)) { ok = false; break; }
+      }
+    } else if (contentLength >= 0) {
+      ok = readBytes(body, contentLength, deadline);
+    } else {
+      closeAfter = true;
+      while (waitData(deadline)) readBytes(body, _client->available(), deadline);
+    }
+    if (closeAfter || !ok) _client->stop();
+    return ok ? status : -1;
+  }
+};
@@ -0,0 +1,343 @@
+/**
+ * @file wifi_link.h
+ * @brief Non-blocking STA link manager with cached BSSID/channel and roaming.
+ *
+ * Replaces the "WiFi.begin() + 10 s wait loop" connect path. loop() is called
+ * from the network task every few ms and never blocks, so the web server and
+ * the rest of the firmware keep running while the link is down.
+ *
+ * - The last good BSSID + channel are kept in RTC memory (survives software
+ *   resets) and in NVS (survives power cycles). A connect with a known BSSID
+ *   and channel skips the full scan. If that fails twice in a row the cache
+ *   is ignored and a normal scan-and-associate is done instead.
+ * - The DHCP lease is kept in RTC too. It is only reused as a static config
+ *   when WIFI_LINK_REUSE_LEASE is 1. Enable that only if the router reserves
+ *   the address for this MAC, otherwise the lease can expire while in use.
+ * - Failed attempts back off exponentially (with jitter) up to a cap. While
+ *   the AP config portal is open, retries keep going at a slower pace so the
+ *   AP channel does not hop under the portal client.
+ * - While online with a weak signal, an async scan runs in the background. If
+ *   another BSSID of the same SSID is clearly stronger, the link roams to it.
+ *
+ * Boot-to-online and outage-to-online times are measured, see printStats().
+ * Single user: call everything from the network task only.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_attr.h>
+
+#define WIFI_LINK_NVS_NAMESPACE     "wifilink"
+#define WIFI_LINK_MAGIC             0x57464C31  // "WFL1"
+
+#define WIFI_LINK_FAST_TIMEOUT_MS   3000    // attempt with cached BSSID/channel
+#define WIFI_LINK_FULL_TIMEOUT_MS   12000   // attempt with full scan
+#define WIFI_LINK_BACKOFF_MIN_MS    500
+#define WIFI_LINK_BACKOFF_MAX_MS    60000
+#define WIFI_LINK_PORTAL_RETRY_MS   30000   // minimum gap between retries while the AP portal is open
+#define WIFI_LINK_FAST_MAX_FAILS    2
+
+#define WIFI_LINK_ROAM_CHECK_MS     60000
+#define WIFI_LINK_ROAM_RSSI         -70     // only look for a better AP below this
+#define WIFI_LINK_ROAM_HYSTERESIS   8       // dB the candidate must be better by
+
+#ifndef WIFI_LINK_REUSE_LEASE
+#define WIFI_LINK_REUSE_LEASE       0
+#endif
+
+struct WifiLinkCache {
+  uint32_t magic;
+  char ssid[33];
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t hasLease;
+  uint32_t ip, gateway, subnet, dns;
+  uint32_t crc;
+};
+
+// Not cleared by a software reset, garbage after power-on (CRC catches that).
+RTC_NOINIT_ATTR static WifiLinkCache rtcWifiLinkCache;
+
+struct WifiLinkStats {
+  uint32_t attempts;
+  uint32_t fastConnects;        // online via cached BSSID/channel
+  uint32_t fullConnects;        // online via full scan
+  uint32_t outages;
+  uint32_t roams;
+  uint32_t bootToOnlineMs;      // 0 until the first time online
+  uint32_t lastOutageMs;        // link lost -> online again
+  uint32_t maxOutageMs;
+  uint32_t totalOutageMs;
+  uint32_t lastAttemptMs;       // WiFi.begin() -> WL_CONNECTED of the last good attempt
+};
+
+enum WifiLinkState { LINK_IDLE, LINK_CONNECTING, LINK_ONLINE, LINK_BACKOFF };
+
+class WifiLink {
+public:
+  void begin(const char* ssid, const char* pass) {
+    _ssid = ssid;
+    _pass = pass;
+    WiFi.persistent(false);          // credentials live in our own config store
+    WiFi.setAutoReconnect(false);    // reconnects are driven from loop()
+    if (!(WiFi.getMode() & WIFI_MODE_STA)) WiFi.mode(WIFI_STA);
+    loadCache();
+    startAttempt();
+  }
+
+  void loop() {
+    if (_state == LINK_IDLE) return;
+    unsigned long now = millis();
+    wl_status_t st = WiFi.status();
+
+    switch (_state) {
+      case LINK_CONNECTING:
+        // WiFi.disconnect() is async: right after a roam starts, the old AP can
+        // still report WL_CONNECTED. Only the roam target counts.
+        if (st == WL_CONNECTED && (!_roaming || onRoamTarget())) {
+          onOnline(now);
+        } else if (((st == WL_CONNECT_FAILED || st == WL_NO_SSID_AVAIL) && now - _attemptStart > 250) ||  // skip stale status from the previous try
+                   now - _attemptStart > (_attemptFast ? WIFI_LINK_FAST_TIMEOUT_MS : WIFI_LINK_FULL_TIMEOUT_MS)) {
+          onAttemptFailed(now);
+        }
+        break;
+
+      case LINK_ONLINE:
+        if (st != WL_CONNECTED) {
+          _stats.outages++;
+          _outageStart = now;
+          _failures = 0;
+          if (_scanRunning) { WiFi.scanDelete(); _scanRunning = false; }
+          Serial.println("[WiFi] Link lost, reconnecting in background.");
+          startAttempt();
+          break;
+        }
+        pollRoaming(now);
+        break;
+
+      case LINK_BACKOFF:
+        if (now - _backoffStart >= _backoffMs) startAttempt();
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  bool isOnline() const { return _state == LINK_ONLINE; }
+  WifiLinkState state() const { return _state; }
+  const WifiLinkStats& stats() const { return _stats; }
+
+  // With the AP portal open, retries are spaced out so the shared radio
+  // spends most of its time on the AP channel.
+  void setPortalActive(bool active) { _portalActive = active; }
+
+  void printStats() const {
+    Serial.printf("[WiFi] attempts=%u fast=%u full=%u roams=%u outages=%u | boot->online=%u ms | outage->online last=%u ms max=%u ms total=%u ms\n",
+                  _stats.attempts, _stats.fastConnects, _stats.fullConnects, _stats.roams, _stats.outages,
+                  _stats.bootToOnlineMs, _stats.lastOutageMs, _stats.maxOutageMs, _stats.totalOutageMs);
+  }
+
+private:
+  const char* _ssid = nullptr;
+  const char* _pass = nullptr;
+  WifiLinkState _state = LINK_IDLE;
+  WifiLinkCache _cache = {};
+  bool _cacheValid = false;
+  bool _attemptFast = false;
+  bool _portalActive = false;
+  bool _roaming = false;
+  bool _scanRunning = false;
+  uint8_t _fastFailures = 0;
+  uint8_t _failures = 0;
+  uint8_t _roamBssid[6];
+  int32_t _roamChannel = 0;
+  unsigned long _attemptStart = 0;
+  unsigned long _backoffStart = 0;
+  unsigned long _backoffMs = 0;
+  unsigned long _outageStart = 0;
+  unsigned long _lastRoamCheck = 0;
+  WifiLinkStats _stats = {};
+
+  void startAttempt() {
+    _stats.attempts++;
+    _attemptStart = millis();
+    _attemptFast = _roaming || (_cacheValid && _fastFailures < WIFI_LINK_FAST_MAX_FAILS);
+
+    if (_roaming) {
+      Serial.printf("[WiFi] Roaming to %02X:%02X:%02X:%02X:%02X:%02X (ch %d)\n",
+                    _roamBssid[0], _roamBssid[1], _roamBssid[2], _roamBssid[3], _roamBssid[4], _roamBssid[5], (int)_roamChannel);
+      WiFi.disconnect();
+      WiFi.begin(_ssid, _pass, _roamChannel, _roamBssid);
+    } else if (_attemptFast) {
+#if WIFI_LINK_REUSE_LEASE
+      if (_cache.hasLease) {
+        WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+      }
+#endif
+      Serial.printf("[WiFi] Fast connect to '%s' (ch %u, cached BSSID)\n", _ssid, _cache.channel);
+      WiFi.begin(_ssid, _pass, _cache.channel, _cache.bssid);
+    } else {
+      WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // back to DHCP
+      Serial.printf("[WiFi] Full connect to '%s' (scan)\n", _ssid);
+      WiFi.begin(_ssid, _pass);
+    }
+    _state = LINK_CONNECTING;
+  }
+
+  bool onRoamTarget() {
+    uint8_t* bssid = WiFi.BSSID();
+    return bssid && memcmp(bssid, _roamBssid, 6) == 0;
+  }
+
+  void onOnline(unsigned long now) {
+    _stats.lastAttemptMs = now - _attemptStart;
+    if (_attemptFast) _stats.fastConnects++; else _stats.fullConnects++;
+    if (_roaming) _stats.roams++;
+
+    if (_stats.bootToOnlineMs == 0) {
+      _stats.bootToOnlineMs = now;
+      Serial.printf("[WiFi] Online %u ms after boot (%s, attempt took %u ms)\n",
+                    _stats.bootToOnlineMs, _attemptFast ? "fast" : "full scan", _stats.lastAttemptMs);
+    } else if (_outageStart != 0) {
+      _stats.lastOutageMs = now - _outageStart;
+      _stats.totalOutageMs += _stats.lastOutageMs;
+      if (_stats.lastOutageMs > _stats.maxOutageMs) _stats.maxOutageMs = _stats.lastOutageMs;
+      Serial.printf("[WiFi] Online again after %u ms outage (%s)\n", _stats.lastOutageMs, _attemptFast ? "fast" : "full scan");
+    }
+    Serial.printf("[WiFi] IP %s, BSSID %s, ch %d, RSSI %d dBm\n",
+                  WiFi.localIP().toString().c_str(), WiFi.BSSIDstr().c_str(), (int)WiFi.channel(), (int)WiFi.RSSI());
+
+    _outageStart = 0;
+    _failures = 0;
+    _fastFailures = 0;
+    _roaming = false;
+    _lastRoamCheck = now;
+    _state = LINK_ONLINE;
+    saveCache();
+  }
+
+  void onAttemptFailed(unsigned long now) {
+    WiFi.disconnect();
+    if (_roaming) {
+      Serial.println("[WiFi] Roam target did not answer, falling back.");
+      _roaming = false;
+    } else if (_attemptFast) {
+      _fastFailures++;
+    }
+
+    unsigned long backoff = WIFI_LINK_BACKOFF_MIN_MS << (_failures < 7 ? _failures : 7);
+    if (backoff > WIFI_LINK_BACKOFF_MAX_MS) backoff = WIFI_LINK_BACKOFF_MAX_MS;
+    if (_portalActive && backoff < WIFI_LINK_PORTAL_RETRY_MS) backoff = WIFI_LINK_PORTAL_RETRY_MS;
+    backoff += random(0, backoff / 4 + 1);  // jitter, avoids retry storms after a router reboot
+    _failures++;
+
+    Serial.printf("[WiFi] Attempt failed (status %d after %lu ms), next try in %lu ms\n",
+                  (int)WiFi.status(), now - _attemptStart, backoff);
+    _backoffMs = backoff;
+    _backoffStart = now;
+    _state = LINK_BACKOFF;
+  }
+
+  void pollRoaming(unsigned long now) {
+    if (_scanRunning) {
+      int16_t n = WiFi.scanComplete();
+      if (n == WIFI_SCAN_RUNNING) return;
+      _scanRunning = false;
+      if (n > 0) pickRoamTarget(n);
+      WiFi.scanDelete();
+      if (_roaming) {
+        _outageStart = now;  // roam gap counts as a (short) outage
+        startAttempt();
+      }
+      return;
+    }
+    if (now - _lastRoamCheck < WIFI_LINK_ROAM_CHECK_MS) return;
+    _lastRoamCheck = now;
+    if (WiFi.RSSI() >= WIFI_LINK_ROAM_RSSI) return;
+    // Async scan: the STA stays associated and keeps serving traffic.
+    if (WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING) _scanRunning = true;
+  }
+
+  void pickRoamTarget(int16_t n) {
+    int32_t currentRssi = WiFi.RSSI();
+    uint8_t* currentBssid = WiFi.BSSID();
+    int best = -1;
+    for (int i = 0; i < n; i++) {
+      if (WiFi.SSID(i) != _ssid) continue;
+      if (currentBssid && memcmp(WiFi.BSSID(i), currentBssid, 6) == 0) continue;
+      if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best)) best = i;
+    }
+    if (best < 0 || WiFi.RSSI(best) < currentRssi + WIFI_LINK_ROAM_HYSTERESIS) return;
+    memcpy(_roamBssid, WiFi.BSSID(best), 6);
+    _roamChannel = WiFi.channel(best);
+    _roaming = true;
+  }
+
+  static uint32_t cacheCrc(const WifiLinkCache& c) {
+    const uint8_t* data = (const uint8_t*)&c;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < offsetof(WifiLinkCache, crc); i++) {
+      crc ^= data[i];
+      for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+  }
+
+  bool cacheMatches(const WifiLinkCache& c) const {
+    return c.magic == WIFI_LINK_MAGIC && c.crc == cacheCrc(c) && strcmp(c.ssid, _ssid) == 0 && c.channel != 0;
+  }
+
+  void loadCache() {
+    if (cacheMatches(rtcWifiLinkCache)) {
+      _cache = rtcWifiLinkCache;
+      _cacheValid = true;
+      Serial.println("[WiFi] Using BSSID/channel cached in RTC memory.");
+      return;
+    }
+    Preferences prefs;
+    if (prefs.begin(WIFI_LINK_NVS_NAMESPACE, true)) {
+      if (prefs.getBytesLength("ap") == sizeof(WifiLinkCache)) {
+        prefs.getBytes("ap", &_cache, sizeof(_cache));
+        _cacheValid = cacheMatches(_cache);
+      }
+      prefs.end();
+    }
+    _cache.hasLease = 0;  // a lease from before a power cycle is not trusted
+    if (_cacheValid) Serial.println("[WiFi] Using BSSID/channel cached in NVS.");
+  }
+
+  void saveCache() {
+    WifiLinkCache c = {};
+    c.magic = WIFI_LINK_MAGIC;
+    strncpy(c.ssid, _ssid, sizeof(c.ssid) - 1);
+    memcpy(c.bssid, WiFi.BSSID(), 6);
+    c.channel = WiFi.channel();
+    c.hasLease = 1;
+    c.ip = (uint32_t)WiFi.localIP();
+    c.gateway = (uint32_t)WiFi.gatewayIP();
+    c.subnet = (uint32_t)WiFi.subnetMask();
+    c.dns = (uint32_t)WiFi.dnsIP();
+    c.crc = cacheCrc(c);
+    rtcWifiLinkCache = c;
+
+    // NVS only keeps the AP identity and is only rewritten when it changes.
+    bool apChanged = !_cacheValid || memcmp(_cache.bssid, c.bssid, 6) != 0 || _cache.channel != c.channel ||
+                     strcmp(_cache.ssid, c.ssid) != 0;
+    _cache = c;
+    _cacheValid = true;
+    if (!apChanged) return;
+
+    WifiLinkCache nv = c;
+    nv.hasLease = 0;
+    nv.ip = nv.gateway = nv.subnet = nv.dns = 0;
+    nv.crc = cacheCrc(nv);
+    Preferences prefs;
+    if (prefs.begin(WIFI_LINK_NVS_NAMESPACE, false)) {
+      prefs.putBytes("ap", &nv, sizeof(nv));
+      prefs.end();
+    }
+  }
+};
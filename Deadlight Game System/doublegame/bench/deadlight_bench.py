@@ -0,0 +1,522 @@
+#!/usr/bin/env python3
+"""
+Deadlight MQTT latency benchmark.
+
+Simulates Node-RED game-master dashboards (each one its own MQTT connection,
+subscribed to the same status / connection topics as flows.json) and fires
+commands at both ESPs at increasing rates. Both firmwares answer through
+mqtt_bench.h:
+
+  deadlight/bench/<esp>/ping  {"id":N}             -> pong straight from mqttCallback
+  game/control, esp32-gamemaster/command|settings/set
+                              {..., "bench_id":N}  -> ack after the command was handled
+
+Per rate step it reports round-trip percentiles per (esp, command), lost
+messages, publish failures (ours and the ESP's own, incl. packets that did not
+fit PubSubClient's buffer) and the largest gap between "online" heartbeats.
+A payload sweep then finds the largest message each ESP still receives.
+
+Without boards, --sim-esp builds the two sketches for Linux (host/Makefile:
+the real firstesp.ino / sketch_jun12a.ino and mqtt_bench.h against small
+PubSubClient, Arduino_JSON, AsyncWebSocket and hardware shims) and runs them
+against the broker, and --local-broker runs a minimal in-process broker, so a
+C++17 compiler and paho-mqtt are all that is needed. Sensors, LEDs, SPI and
+the DFPlayer cost nothing there (--sim-loop-ms adds that time back), Serial
+is throttled to --sim-serial-baud, and there is no heap figure:
+
+  pip install paho-mqtt
+  python3 deadlight_bench.py --local-broker --sim-esp esp1,esp2
+  python3 deadlight_bench.py --broker 192.168.20.208 --dashboards 3 --rates 1,5,10,20,50
+
+Run it against real boards only when no game is in progress: "noop" and
+"settings" are harmless, "start_mic_game" lights ESP2's LED and "reset_game"
+starts ESP2's homing run.
+"""
+
+import argparse
+import asyncio
+import json
+import os
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+PONG_TOPIC = "deadlight/bench/pong"
+STATUS_TOPICS = ["game/status", "esp32-gamemaster/status"]
+CONNECTION_TOPIC = "esp/+/connection"
+PUBSUB_HEADER = 5  # MQTT_MAX_HEADER_SIZE in PubSubClient
+
+# command -> esp -> (topic, payload builder)
+COMMANDS = {
+    "ping": {
+        "esp1": lambda bid: ("deadlight/bench/esp1/ping", {"id": bid}),
+        "esp2": lambda bid: ("deadlight/bench/esp2/ping", {"id": bid}),
+    },
+    "noop": {
+        "esp1": lambda bid: ("game/control", {"action": "bench_noop", "bench_id": bid}),
+        "esp2": lambda bid: ("esp32-gamemaster/command", {"action": "bench_noop", "bench_id": bid}),
+    },
+    "settings": {
+        "esp1": lambda bid: ("game/control", {"action": "apply_settings", "payload": {}, "bench_id": bid}),
+        "esp2": lambda bid: ("esp32-gamemaster/settings/set", {"bench_id": bid}),
+    },
+    "start_mic_game": {
+        "esp2": lambda bid: ("esp32-gamemaster/command", {"action": "start_mic_game", "bench_id": bid}),
+    },
+    "reset_game": {
+        "esp2": lambda bid: ("esp32-gamemaster/command", {"action": "reset_game", "bench_id": bid}),
+    },
+}
+
+
+def new_client(client_id):
+    if hasattr(mqtt, "CallbackAPIVersion"):  # paho-mqtt >= 2.0
+        return mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id=client_id)
+    return mqtt.Client(client_id=client_id)
+
+
+def connect(client, host, port, timeout=5.0):
+    client.connect(host, port, keepalive=15)
+    client.loop_start()
+    deadline = time.monotonic() + timeout
+    while not client.is_connected():
+        if time.monotonic() > deadline:
+            raise SystemExit(f"could not connect to MQTT broker {host}:{port}")
+        time.sleep(0.01)
+
+
+def pct(values, p):
+    if not values:
+        return float("nan")
+    s = sorted(values)
+    return s[min(len(s) - 1, int(p / 100.0 * (len(s) - 1) + 0.5))]
+
+
+# =====================================================================
+# Broker stand-in: MQTT 3.1.1 subset (QoS 0/1/2 in, QoS 0 out, retained
+# messages, last will, + and # wildcards). Enough for this topology.
+# =====================================================================
+def fmt_gap(seconds):
+    return "n/a" if seconds is None else f"{seconds:.2f} s"
+
+
+def topic_matches(flt, topic):
+    f, t = flt.split("/"), topic.split("/")
+    for i, part in enumerate(f):
+        if part == "#":
+            return True
+        if i >= len(t) or (part != "+" and part != t[i]):
+            return False
+    return len(f) == len(t)
+
+
+def mqtt_string(data, pos):
+    n = struct.unpack_from("!H", data, pos)[0]
+    return data[pos + 2:pos + 2 + n], pos + 2 + n
+
+
+def encode_length(n):
+    out = bytearray()
+    while True:
+        b, n = n % 128, n // 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def publish_packet(topic, payload, retain=False):
+    body = struct.pack("!H", len(topic)) + topic + payload
+    return bytes([0x30 | (1 if retain else 0)]) + encode_length(len(body)) + body
+
+
+class StandInBroker:
+    def __init__(self, host, port):
+        self.host, self.port = host, port
+        self.sessions = {}   # writer -> list of topic filters
+        self.retained = {}   # topic bytes -> payload
+        self.routed = 0
+        self._ready = threading.Event()
+
+    def start(self):
+        threading.Thread(target=lambda: asyncio.run(self._serve()), daemon=True).start()
+        if not self._ready.wait(5):
+            raise SystemExit("broker stand-in did not start")
+
+    async def _serve(self):
+        server = await asyncio.start_server(self._client, self.host, self.port)
+        self._ready.set()
+        async with server:
+            await server.serve_forever()
+
+    def _route(self, topic, payload):
+        t = topic.decode(errors="replace")
+        packet = publish_packet(topic, payload)
+        for writer, filters in list(self.sessions.items()):
+            if any(topic_matches(f, t) for f in filters):
+                writer.write(packet)
+                self.routed += 1
+
+    async def _client(self, reader, writer):
+        will, clean = None, False
+        self.sessions[writer] = []
+        try:
+            while True:
+                head = await reader.readexactly(1)
+                length, mult = 0, 1
+                while True:
+                    b = (await reader.readexactly(1))[0]
+                    length += (b & 0x7F) * mult
+                    mult *= 128
+                    if not b & 0x80:
+                        break
+                body = await reader.readexactly(length) if length else b""
+                kind, flags = head[0] >> 4, head[0] & 0x0F
+                if kind == 1:  # CONNECT
+                    _, pos = mqtt_string(body, 0)
+                    cflags = body[pos + 1]
+                    pos += 4
+                    _, pos = mqtt_string(body, pos)  # client id
+                    if cflags & 0x04:
+                        wt, pos = mqtt_string(body, pos)
+                        wm, pos = mqtt_string(body, pos)
+                        will = (wt, wm, bool(cflags & 0x20))
+                    writer.write(b"\x20\x02\x00\x00")
+                elif kind == 3:  # PUBLISH
+                    qos, retain = (flags >> 1) & 3, flags & 1
+                    topic, pos = mqtt_string(body, 0)
+                    if qos:
+                        pid = body[pos:pos + 2]
+                        pos += 2
+                        writer.write((b"\x40\x02" if qos == 1 else b"\x50\x02") + pid)
+                    payload = body[pos:]
+                    if retain:
+                        if payload:
+                            self.retained[topic] = payload
+                        else:
+                            self.retained.pop(topic, None)
+                    self._route(topic, payload)
+                elif kind == 6:  # PUBREL
+                    writer.write(b"\x70\x02" + body[:2])
+                elif kind == 8:  # SUBSCRIBE
+                    pos, granted = 2, bytearray()
+                    while pos < len(body):
+                        flt, pos = mqtt_string(body, pos)
+                        pos += 1
+                        self.sessions[writer].append(flt.decode())
+                        granted.append(0)
+                        for topic, payload in self.retained.items():
+                            if topic_matches(flt.decode(), topic.decode(errors="replace")):
+                                writer.write(publish_packet(topic, payload, retain=True))
+                    writer.write(b"\x90" + encode_length(2 + len(granted)) + body[:2] + bytes(granted))
+                elif kind == 10:  # UNSUBSCRIBE
+                    pos = 2
+                    while pos < len(body):
+                        flt, pos = mqtt_string(body, pos)
+                        if flt.decode() in self.sessions[writer]:
+                            self.sessions[writer].remove(flt.decode())
+                    writer.write(b"\xb0\x02" + body[:2])
+                elif kind == 12:  # PINGREQ
+                    writer.write(b"\xd0\x00")
+                elif kind == 14:  # DISCONNECT
+                    clean = True
+                    break
+                await writer.drain()
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.sessions.pop(writer, None)
+            if will and not clean:
+                if will[2]:
+                    self.retained[will[0]] = will[1]
+                self._route(will[0], will[1])
+            writer.close()
+
+
+# =====================================================================
+# ESP stand-ins
+# =====================================================================
+class HostEsp:
+    """One sketch built for Linux by host/Makefile (the real .ino against shims), run as a child process."""
+
+    HOST_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "host")
+
+    def __init__(self, name, host, port, loop_ms, serial_baud):
+        self.name = name
+        subprocess.run(["make", "-s", "-C", self.HOST_DIR, name], check=True)
+        fd, self.serial_log = tempfile.mkstemp(prefix=f"deadlight-{name}-", suffix=".log")
+        os.close(fd)
+        self.proc = subprocess.Popen([os.path.join(self.HOST_DIR, name), "--broker", f"{host}:{port}",
+                                      "--serial-baud", str(serial_baud), "--serial-log", self.serial_log,
+                                      "--loop-ms", f"{loop_ms:g}"], stdin=subprocess.DEVNULL)
+
+    def stop(self):
+        if self.proc.poll() is not None:
+            print(f"warning: {self.name} host build exited early (code {self.proc.returncode}), see {self.serial_log}")
+            return
+        self.proc.terminate()
+        try:
+            self.proc.wait(timeout=2)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+
+
+# =====================================================================
+# Dashboards and the load driver
+# =====================================================================
+class Dashboard:
+    """One simulated Node-RED instance: own connection, same subscriptions as the game-master flow."""
+
+    def __init__(self, index, host, port, bench):
+        self.index, self.bench = index, bench
+        self.status_rx = 0
+        self.client = new_client(f"deadlight-bench-dash{index}")
+        self.client.on_message = self._on_message
+        connect(self.client, host, port)
+        for t in STATUS_TOPICS + [CONNECTION_TOPIC, PONG_TOPIC]:
+            self.client.subscribe(t)
+
+    def _on_message(self, client, userdata, msg):
+        now = time.monotonic()
+        if msg.topic == PONG_TOPIC:
+            self.bench.on_pong(self.index, now, msg.payload)
+        elif msg.topic in STATUS_TOPICS:
+            self.status_rx += 1
+        elif not msg.retain and msg.payload == b"online" and self.index == 0:
+            self.bench.on_heartbeat(msg.topic.split("/")[1], now)
+
+
+class Bench:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.pending = {}     # (esp, id) -> (sent_at, command)
+        self.rtts = {}        # (esp, command) -> [ms]
+        self.sent = {}        # (esp, command) -> n
+        self.pub_errors = 0
+        self.esp_stats = {}   # esp -> last stats seen in a pong
+        self.sweep_len = {}   # (esp, id) -> received length
+        self.beats = {}       # esp -> [monotonic]
+        self.seq = 0
+        host, port = args.broker
+        self.dashboards = [Dashboard(i, host, port, self) for i in range(args.dashboards)]
+
+    def next_id(self, dash):
+        self.seq += 1
+        return dash * 10_000_000 + self.seq
+
+    def on_pong(self, dash, now, payload):
+        try:
+            msg = json.loads(payload)
+        except ValueError:
+            return
+        key = (msg.get("esp"), msg.get("ack", msg.get("id")))
+        if key[1] is None or key[1] // 10_000_000 != dash:
+            return
+        with self.lock:
+            if "rx" in msg:
+                self.esp_stats[key[0]] = msg
+            if "len" in msg:
+                self.sweep_len[key] = msg["len"]
+            sent = self.pending.pop(key, None)
+            if sent:
+                self.rtts.setdefault((key[0], sent[1]), []).append((now - sent[0]) * 1000.0)
+
+    def on_heartbeat(self, esp, now):
+        with self.lock:
+            self.beats.setdefault(esp, []).append(now)
+
+    def send(self, dash, esp, command, label=None, pad_to=0):
+        bid = self.next_id(dash)
+        topic, payload = COMMANDS[command][esp](bid)
+        if pad_to:
+            payload["pad"] = ""
+            payload["pad"] = "x" * max(0, pad_to - len(json.dumps(payload)))
+        label = label or command
+        with self.lock:
+            self.pending[(esp, bid)] = (time.monotonic(), label)
+            self.sent[(esp, label)] = self.sent.get((esp, label), 0) + 1
+        if self.dashboards[dash].client.publish(topic, json.dumps(payload)).rc != mqtt.MQTT_ERR_SUCCESS:
+            self.pub_errors += 1
+        return bid
+
+    def reset_step(self):
+        with self.lock:
+            self.pending.clear()
+            self.rtts, self.sent, self.pub_errors = {}, {}, 0
+            # Keep the last beat so a step shorter than two heartbeats still gets a gap.
+            self.beats = {esp: t[-1:] for esp, t in self.beats.items()}
+        for d in self.dashboards:
+            d.status_rx = 0
+
+    def run_step(self, rate):
+        plan = [(esp, cmd) for cmd in self.args.commands for esp in self.args.esps if esp in COMMANDS[cmd]]
+        if not plan:
+            raise SystemExit("no command in --commands applies to --esps")
+        self.wait_idle()
+        before = {k: dict(v) for k, v in self.esp_stats.items()}
+        self.reset_step()
+        interval, start, n = 1.0 / rate, time.monotonic(), 0
+        while time.monotonic() - start < self.args.step_s:
+            due = start + n * interval
+            delay = due - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            esp, cmd = plan[n % len(plan)]
+            self.send(n % len(self.dashboards), esp, cmd)
+            n += 1
+        elapsed = time.monotonic() - start
+        time.sleep(self.args.timeout)
+        self.collect_esp_stats()
+        return self.report_step(rate, n / elapsed, before)
+
+    def collect_esp_stats(self):
+        # Every pong carries the ESP's counters; one extra ping gives fresh ones.
+        for esp in self.args.esps:
+            self.send(0, esp, "ping", label="stats")
+        time.sleep(min(self.args.timeout, 1.0))
+
+    def wait_idle(self, limit_s=60.0):
+        """Ping until every ESP answers within --timeout, i.e. the previous step's backlog is gone."""
+        deadline = time.monotonic() + limit_s
+        for esp in self.args.esps:
+            while time.monotonic() < deadline:
+                bid = self.send(0, esp, "ping", label="stats")
+                answered_by = time.monotonic() + self.args.timeout
+                while time.monotonic() < answered_by and (esp, bid) in self.pending:
+                    time.sleep(0.01)
+                if (esp, bid) not in self.pending:
+                    break
+            else:
+                print(f"warning: {esp} did not answer a ping within {limit_s:g} s")
+
+    def report_step(self, rate, achieved, before):
+        a = self.args
+        status_rx = [d.status_rx / a.step_s for d in self.dashboards]
+        print(f"\n=== {rate:g} msg/s (achieved {achieved:.1f}), {a.step_s:g} s, {len(self.dashboards)} dashboards, "
+              f"status fan-out {statistics.mean(status_rx):.1f} msg/s per dashboard ===")
+        print(f"{'esp':5} {'command':15} {'sent':>6} {'lost%':>6} {'p50':>8} {'p95':>8} {'p99':>8} {'max':>8}  ms")
+        rows = []
+        with self.lock:
+            for (esp, cmd), sent in sorted(self.sent.items()):
+                if cmd == "stats":
+                    continue
+                r = self.rtts.get((esp, cmd), [])
+                lost = 100.0 * (sent - len(r)) / sent if sent else 0.0
+                row = dict(esp=esp, command=cmd, sent=sent, lost_pct=lost, p50=pct(r, 50), p95=pct(r, 95),
+                           p99=pct(r, 99), max=max(r) if r else float("nan"))
+                rows.append(row)
+                print(f"{esp:5} {cmd:15} {sent:6d} {lost:6.1f} {row['p50']:8.1f} {row['p95']:8.1f} "
+                      f"{row['p99']:8.1f} {row['max']:8.1f}")
+            beats = {esp: max(later - earlier for earlier, later in zip(t, t[1:])) if len(t) > 1 else None
+                     for esp, t in self.beats.items()}
+            esp_side = {}
+            for esp, s in self.esp_stats.items():
+                b = before.get(esp, {})
+                esp_side[esp] = {k: s.get(k, 0) - b.get(k, 0) for k in ("rx", "pub_ok", "pub_fail", "oversize")}
+                esp_side[esp].update(max_pkt=s.get("max_pkt"), buf=s.get("buf"), gap_p99_us=s.get("gap_p99"),
+                                     handler_p99_us=s.get("handler_p99"), heap=s.get("heap"))
+        print(f"publish failures: dashboards {self.pub_errors}", end="")
+        for esp, s in sorted(esp_side.items()):
+            total = s["pub_ok"] + s["pub_fail"]
+            rate_pct = 100.0 * s["pub_fail"] / total if total else 0.0
+            print(f" | {esp} {s['pub_fail']}/{total} ({rate_pct:.1f}%, oversize {s['oversize']})", end="")
+        print()
+        for esp, s in sorted(esp_side.items()):
+            print(f"{esp}: largest publish {s['max_pkt']}/{s['buf']} bytes, loop gap p99 {s['gap_p99_us']} us, "
+                  f"handler p99 {s['handler_p99_us']} us, heartbeat max gap {fmt_gap(beats.get(esp))}")
+        return dict(rate=rate, achieved=achieved, commands=rows, esp=esp_side, heartbeat_max_gap_s=beats,
+                    dashboard_pub_errors=self.pub_errors)
+
+    def sweep(self):
+        print("\n=== inbound size sweep (ping payload bytes -> answered?) ===")
+        self.wait_idle()
+        results = {}
+        for size in self.args.sweep:
+            row = {}
+            for esp in self.args.esps:
+                bid = self.send(0, esp, "ping", label="sweep", pad_to=size)
+                deadline = time.monotonic() + self.args.timeout
+                while time.monotonic() < deadline and (esp, bid) not in self.sweep_len:
+                    time.sleep(0.01)
+                row[esp] = self.sweep_len.get((esp, bid))
+            results[size] = row
+            print(f"{size:6d}  " + "  ".join(f"{esp}: {'ok' if n else 'DROPPED'}" for esp, n in row.items()))
+        for esp in self.args.esps:
+            ok = [s for s, r in results.items() if r.get(esp)]
+            topic = f"deadlight/bench/{esp}/ping"
+            limit = self.esp_stats.get(esp, {}).get("buf")
+            hint = f" (buffer {limit} - {PUBSUB_HEADER + 2 + len(topic)} header/topic)" if limit else ""
+            print(f"{esp}: largest payload received {max(ok) if ok else 'none'}{hint}")
+        return results
+
+
+def parse_args():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--broker", default="192.168.20.208", help="HOST[:PORT] of the MQTT broker")
+    ap.add_argument("--local-broker", action="store_true", help="run the in-process broker stand-in on --broker")
+    ap.add_argument("--sim-esp", default="", help="comma list of sketches to run as host builds (esp1,esp2)")
+    ap.add_argument("--sim-loop-ms", type=float, default=0.0,
+                    help="minimum loop() time of the host builds, for the hardware time they do not spend")
+    ap.add_argument("--sim-serial-baud", type=int, default=115200, help="Serial speed of the host builds, 0 = free")
+    ap.add_argument("--esps", default="esp1,esp2")
+    ap.add_argument("--dashboards", type=int, default=3)
+    ap.add_argument("--rates", default="1,2,5,10,20,50", help="total commands per second, one step each")
+    ap.add_argument("--step-s", type=float, default=20.0)
+    ap.add_argument("--timeout", type=float, default=3.0, help="seconds before an unanswered command counts as lost")
+    ap.add_argument("--commands", default="ping,noop", help=f"mix of {','.join(COMMANDS)}")
+    ap.add_argument("--sweep", default="256,512,1024,1536,1900,2000,2020,2030,2040,2048,3000,4096",
+                    help="ping payload sizes for the buffer sweep ('' to skip)")
+    ap.add_argument("--json", help="also write the results to this file")
+    a = ap.parse_args()
+    host, _, port = a.broker.partition(":")
+    if a.local_broker and a.broker == ap.get_default("broker"):
+        host = "127.0.0.1"
+    a.broker = (host, int(port or 1883))
+    a.esps = [e for e in a.esps.split(",") if e]
+    a.sim_esp = [e for e in a.sim_esp.split(",") if e]
+    a.rates = [float(r) for r in a.rates.split(",") if r]
+    a.commands = [c for c in a.commands.split(",") if c]
+    a.sweep = [int(s) for s in a.sweep.split(",") if s]
+    for c in a.commands:
+        if c not in COMMANDS:
+            ap.error(f"unknown command '{c}'")
+    return a
+
+
+def main():
+    a = parse_args()
+    host, port = a.broker
+    if a.local_broker:
+        broker = StandInBroker(host, port)
+        broker.start()
+        print(f"broker stand-in listening on {host}:{port}")
+    sims = []
+    try:
+        for n in a.sim_esp:
+            sims.append(HostEsp(n, host, port, a.sim_loop_ms, a.sim_serial_baud))
+            print(f"{n}: host build running, Serial -> {sims[-1].serial_log}")
+        bench = Bench(a)
+        time.sleep(0.5)
+        results = {"args": {k: v for k, v in vars(a).items()}, "steps": []}
+        for rate in a.rates:
+            results["steps"].append(bench.run_step(rate))
+        if a.sweep:
+            results["sweep"] = bench.sweep()
+    finally:
+        for s in sims:
+            s.stop()
+    if a.json:
+        with open(a.json, "w") as f:
+            json.dump(results, f, indent=2, default=str)
+        print(f"\nresults written to {a.json}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+/**
+ * @file AccelStepper.h
+ * @brief Host stand-in: positions advance in real time at the set speed
+ *        (run() at maxSpeed, no ramp); no pins are driven.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class AccelStepper {
+public:
+  typedef enum { FUNCTION = 0, DRIVER = 1, FULL2WIRE = 2, FULL3WIRE = 3, FULL4WIRE = 4, HALF3WIRE = 6, HALF4WIRE = 8 } MotorInterfaceType;
+
+  AccelStepper(uint8_t = FULL4WIRE, uint8_t = 2, uint8_t = 3, uint8_t = 4, uint8_t = 5, bool = true) {}
+
+  void moveTo(long absolute) { _target = absolute; }
+  void move(long relative) { _target = _pos + relative; }
+  void setMaxSpeed(float s) { _maxSpeed = fabsf(s); }
+  void setAcceleration(float) {}
+  void setSpeed(float s) { _speed = s; }
+  float speed() const { return _speed; }
+  long distanceToGo() const { return _target - _pos; }
+  long currentPosition() const { return _pos; }
+  void setCurrentPosition(long p) { _pos = _target = p; _speed = 0; }
+  void stop() { _target = _pos; }
+
+  bool runSpeed() {
+    if (_speed == 0) return false;
+    unsigned long now = micros();
+    if (now - _lastStepUs < (unsigned long)(1e6f / fabsf(_speed))) return false;
+    _pos += _speed > 0 ? 1 : -1;
+    _lastStepUs = now;
+    return true;
+  }
+  bool run() {
+    long d = distanceToGo();
+    if (d == 0) { _speed = 0; return false; }
+    _speed = d > 0 ? _maxSpeed : -_maxSpeed;
+    runSpeed();
+    return distanceToGo() != 0;
+  }
+
+private:
+  long _pos = 0, _target = 0;
+  float _speed = 0, _maxSpeed = 1;
+  unsigned long _lastStepUs = 0;
+};
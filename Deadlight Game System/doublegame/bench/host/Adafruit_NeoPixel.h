@@ -0,0 +1,26 @@
+/**
+ * @file Adafruit_NeoPixel.h
+ * @brief Host stand-in: keeps brightness (stored +1, as the library does, so
+ *        getBrightness() reports the same values), show() takes no time.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+typedef uint16_t neoPixelType;
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t, neoPixelType = NEO_GRB + NEO_KHZ800) : _n(n) {}
+  void begin() {}
+  void show() {}
+  void setBrightness(uint8_t b) { _brightness = b + 1; }
+  uint8_t getBrightness() const { return _brightness - 1; }
+  void setPixelColor(uint16_t, uint32_t) {}
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+private:
+  uint16_t _n;
+  uint8_t _brightness = 0;
+};
@@ -0,0 +1,302 @@
+/**
+ * @file Arduino.h
+ * @brief Host (Linux) stand-in for the parts of the ESP32 Arduino core the two
+ *        Deadlight sketches use, so the real .ino files compile into a PC binary.
+ *
+ * Only what touches the network path behaves like the board:
+ *  - Serial writes block like the UART at SERIAL baud (128-byte FIFO, no TX
+ *    buffer), so mqttCallback's Serial echo costs what it costs on the ESP.
+ *  - millis()/micros()/delay() are real time.
+ *  - FreeRTOS mutexes, tasks and task notifications map to std::thread.
+ * GPIO reads return HIGH (buttons released), writes and PWM are ignored.
+ * Settings come from host_main.cpp (hostConfig).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define DEC 10
+#define HEX 16
+#define SERIAL_8N1 0x800001c
+
+struct HostConfig {
+  const char* brokerHost = nullptr;  // replaces the sketch's mqtt_server when set
+  uint16_t brokerPort = 0;
+  uint32_t serialBaud = 115200;      // 0 = Serial costs nothing
+  FILE* serialOut = stdout;
+  uint32_t loopMinUs = 0;            // time the real loop() spends on hardware calls
+  char** argv = nullptr;             // for ESP.restart()
+};
+inline HostConfig hostConfig;
+
+// ---------------------------------------------------------------- time
+inline std::chrono::steady_clock::time_point hostBootTime = std::chrono::steady_clock::now();
+inline unsigned long micros() {
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - hostBootTime).count();
+}
+inline unsigned long millis() {
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - hostBootTime).count();
+}
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+// ---------------------------------------------------------------- GPIO, PWM, math
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline uint16_t analogRead(uint8_t) { return 0; }
+inline double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcWrite(uint8_t, uint32_t) {}
+
+inline long random(long howbig) { return howbig ? ::random() % howbig : 0; }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+inline void randomSeed(unsigned long seed) { if (seed) ::srandom(seed); }
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ---------------------------------------------------------------- String
+class String {
+public:
+  String(const char* s = "") : _s(s ? s : "") {}
+  String(const std::string& s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(int v, unsigned char base = DEC) : _s(fmt((long)v, base)) {}
+  String(unsigned int v, unsigned char base = DEC) : _s(fmtU(v, base)) {}
+  String(long v, unsigned char base = DEC) : _s(fmt(v, base)) {}
+  String(unsigned long v, unsigned char base = DEC) : _s(fmtU(v, base)) {}
+  String(double v, unsigned int decimals = 2) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    _s = buf;
+  }
+
+  unsigned int length() const { return (unsigned int)_s.size(); }
+  const char* c_str() const { return _s.c_str(); }
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { _s += o._s; return *this; }
+  String& operator+=(const char* o) { if (o) _s += o; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+  String& operator+=(int v) { _s += fmt(v, DEC); return *this; }
+  String& operator+=(unsigned int v) { _s += fmtU(v, DEC); return *this; }
+  String& operator+=(long v) { _s += fmt(v, DEC); return *this; }
+  String& operator+=(unsigned long v) { _s += fmtU(v, DEC); return *this; }
+  bool concat(const char* s, unsigned int n) { _s.append(s, n); return true; }
+
+  bool operator==(const String& o) const { return _s == o._s; }
+  bool operator==(const char* o) const { return _s == (o ? o : ""); }
+  bool operator!=(const String& o) const { return _s != o._s; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  bool equals(const String& o) const { return _s == o._s; }
+
+  void toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+  void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+  int indexOf(char c, unsigned int from = 0) const { return pos(_s.find(c, from)); }
+  int indexOf(const char* s, unsigned int from = 0) const { return pos(_s.find(s, from)); }
+  String substring(unsigned int from, unsigned int to = 0xFFFFFFFF) const {
+    if (from > _s.size()) return String();
+    return String(_s.substr(from, to == 0xFFFFFFFF ? std::string::npos : to - from));
+  }
+  bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return (float)atof(_s.c_str()); }
+
+private:
+  std::string _s;
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  static std::string fmtU(unsigned long v, unsigned char base) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", v);
+    return buf;
+  }
+  static std::string fmt(long v, unsigned char base) {
+    if (base == HEX) return fmtU((unsigned long)v, base);
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%ld", v);
+    return buf;
+  }
+};
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+// ---------------------------------------------------------------- Print / Serial
+class Printable;
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* buf, size_t n) = 0;
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int digits = 2) { return print(String(v, (unsigned int)digits)); }
+  size_t print(const Printable& p);
+  template <class T> size_t println(const T& v) { return print(v) + println(); }
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+  size_t printf(const char* f, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, f);
+    int n = vsnprintf(buf, sizeof(buf), f, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+  }
+};
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+inline size_t Print::print(const Printable& p) { return p.printTo(*this); }
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+};
+
+// UART without a TX ring buffer (arduino-esp32 default): write() returns once
+// everything but the last 128 bytes has left the wire.
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int uart) : _uart(uart) {}
+  void begin(unsigned long baud, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) { _baud = baud; }
+  size_t write(const uint8_t* buf, size_t n) override {
+    if (_uart != 0) return n;                         // DFPlayer UART: not modelled
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (hostConfig.serialOut) fwrite(buf, 1, n, hostConfig.serialOut);
+    uint32_t baud = hostConfig.serialBaud ? hostConfig.serialBaud : 0;
+    if (!baud) return n;
+    double now = micros();
+    if (_busyUntil < now) _busyUntil = now;
+    _busyUntil += n * 10.0 * 1e6 / baud;
+    double fifoUs = 128 * 10.0 * 1e6 / baud;
+    if (_busyUntil - now > fifoUs) delayMicroseconds((uint32_t)(_busyUntil - now - fifoUs));
+    return n;
+  }
+  using Print::write;
+  void flush() { if (hostConfig.serialOut) fflush(hostConfig.serialOut); }
+  operator bool() const { return true; }
+
+private:
+  int _uart;
+  unsigned long _baud = 115200;
+  double _busyUntil = 0;
+  std::mutex _mutex;
+};
+inline HardwareSerial Serial(0);
+
+// ---------------------------------------------------------------- IPAddress, ESP
+class IPAddress : public Printable {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _b{a, b, c, d} {}
+  size_t printTo(Print& p) const override {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+    return p.print(buf);
+  }
+private:
+  uint8_t _b[4];
+};
+
+struct EspClass {
+  uint32_t getFreeHeap() { return 0; }   // no heap figure on the host
+  [[noreturn]] void restart() {
+    Serial.println("[HOST] ESP.restart()");
+    Serial.flush();
+    if (hostConfig.argv) execv("/proc/self/exe", hostConfig.argv);
+    exit(0);
+  }
+};
+inline EspClass ESP;
+
+// ---------------------------------------------------------------- FreeRTOS (1 tick = 1 ms)
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+
+struct HostSemaphore { std::recursive_timed_mutex m; };
+typedef HostSemaphore* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore(); }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) { s->m.lock(); return pdTRUE; }
+  return s->m.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { s->m.unlock(); return pdTRUE; }
+
+struct HostTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notified = 0;
+};
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+inline thread_local HostTask* hostCurrentTask = nullptr;
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t,
+                                          TaskHandle_t* handle, BaseType_t) {
+  HostTask* t = new HostTask();
+  if (handle) *handle = t;
+  std::thread([fn, arg, t] { hostCurrentTask = t; fn(arg); }).detach();
+  return pdPASS;
+}
+inline void xTaskNotifyGive(TaskHandle_t t) {
+  { std::lock_guard<std::mutex> lock(t->m); t->notified++; }
+  t->cv.notify_one();
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HostTask* t = hostCurrentTask;
+  if (!t) { delay(ticks == portMAX_DELAY ? 1 : ticks); return 0; }
+  std::unique_lock<std::mutex> lock(t->m);
+  auto ready = [t] { return t->notified > 0; };
+  if (ticks == portMAX_DELAY) t->cv.wait(lock, ready);
+  else t->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+  uint32_t v = t->notified;
+  if (v) t->notified = clearOnExit ? 0 : v - 1;
+  return v;
+}
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
@@ -0,0 +1,254 @@
+/**
+ * @file Arduino_JSON.h
+ * @brief Host build of the Arduino_JSON (JSONVar) API the Deadlight sketches use.
+ *
+ * Output matches the library's cJSON_PrintUnformatted: integral numbers as %d,
+ * others as %1.15g (or %1.17g when that does not round-trip), so a float such
+ * as 4.3f prints as 4.3000001907348633 exactly like on the board and the status
+ * payloads have the same size. Casts follow the library too: (int)/(long) of a
+ * non-number is 0, (const char*) of a non-string is NULL.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <limits.h>
+#include <vector>
+
+class JSONVar {
+public:
+  enum Type { Undefined, Null, Boolean, Number, Str, Array, Object };
+
+  JSONVar() {}
+  JSONVar(std::nullptr_t) : _type(Null) {}
+  JSONVar(bool v) : _type(Boolean), _bool(v) {}
+  JSONVar(int v) : _type(Number), _num(v) {}
+  JSONVar(unsigned int v) : _type(Number), _num(v) {}
+  JSONVar(long v) : _type(Number), _num(v) {}
+  JSONVar(unsigned long v) : _type(Number), _num(v) {}
+  JSONVar(double v) : _type(Number), _num(v) {}
+  JSONVar(const char* s) : _type(s ? Str : Null), _str(s ? s : "") {}
+  JSONVar(const String& s) : _type(Str), _str(s.c_str()) {}
+
+  JSONVar& operator[](const char* key) {
+    if (_type != Object) { *this = JSONVar(); _type = Object; }
+    for (size_t i = 0; i < _keys.size(); i++)
+      if (_keys[i] == key) return _values[i];
+    _keys.push_back(key);
+    _values.push_back(JSONVar(nullptr));
+    return _values.back();
+  }
+  JSONVar& operator[](const String& key) { return (*this)[key.c_str()]; }
+  JSONVar& operator[](int index) {
+    if (_type != Array) { *this = JSONVar(); _type = Array; }
+    while ((int)_values.size() <= index) _values.push_back(JSONVar(nullptr));
+    return _values[index];
+  }
+
+  bool hasOwnProperty(const char* key) const {
+    if (_type != Object) return false;
+    for (const std::string& k : _keys) if (k == key) return true;
+    return false;
+  }
+  int length() const { return (_type == Array || _type == Object) ? (int)_values.size() : -1; }
+
+  operator bool() const { return _type == Boolean && _bool; }
+  operator int() const { return _type == Number ? valueint() : 0; }
+  operator long() const { return _type == Number ? valueint() : 0; }
+  operator double() const { return _type == Number ? _num : NAN; }
+  operator const char*() const { return _type == Str ? _str.c_str() : nullptr; }
+
+  Type type() const { return _type; }
+
+  static JSONVar parse(const char* text) {
+    JSONVar v;
+    if (!text) return v;
+    const char* p = text;
+    if (!v.parseValue(p, 0)) return JSONVar();
+    return v;
+  }
+
+  void print(std::string& out) const {
+    switch (_type) {
+      case Undefined: break;
+      case Null: out += "null"; break;
+      case Boolean: out += _bool ? "true" : "false"; break;
+      case Number: printNumber(out); break;
+      case Str: printString(_str, out); break;
+      case Array:
+        out += '[';
+        for (size_t i = 0; i < _values.size(); i++) { if (i) out += ','; _values[i].print(out); }
+        out += ']';
+        break;
+      case Object:
+        out += '{';
+        for (size_t i = 0; i < _values.size(); i++) {
+          if (i) out += ',';
+          printString(_keys[i], out);
+          out += ':';
+          _values[i].print(out);
+        }
+        out += '}';
+        break;
+    }
+  }
+
+private:
+  Type _type = Undefined;
+  bool _bool = false;
+  double _num = 0;
+  std::string _str;
+  std::vector<std::string> _keys;
+  std::vector<JSONVar> _values;
+
+  int valueint() const {
+    if (_num >= INT_MAX) return INT_MAX;
+    if (_num <= (double)INT_MIN) return INT_MIN;
+    return (int)_num;
+  }
+
+  void printNumber(std::string& out) const {
+    char buf[32];
+    if (std::isnan(_num) || std::isinf(_num)) snprintf(buf, sizeof(buf), "null");
+    else if (_num == (double)valueint()) snprintf(buf, sizeof(buf), "%d", valueint());
+    else {
+      snprintf(buf, sizeof(buf), "%1.15g", _num);
+      if (strtod(buf, nullptr) != _num) snprintf(buf, sizeof(buf), "%1.17g", _num);
+    }
+    out += buf;
+  }
+
+  static void printString(const std::string& s, std::string& out) {
+    out += '"';
+    for (unsigned char c : s) {
+      switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+          if (c < 32) { char u[8]; snprintf(u, sizeof(u), "\\u%04x", c); out += u; }
+          else out += (char)c;
+      }
+    }
+    out += '"';
+  }
+
+  static void skipWs(const char*& p) { while (*p && (unsigned char)*p <= 32) p++; }
+
+  static bool parseString(const char*& p, std::string& out) {
+    if (*p != '"') return false;
+    p++;
+    while (*p && *p != '"') {
+      if (*p != '\\') { out += *p++; continue; }
+      p++;
+      switch (*p) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case '"': case '\\': case '/': out += *p; break;
+        case 'u': {
+          unsigned cp = 0;
+          for (int i = 1; i <= 4; i++) {
+            char h = p[i];
+            if (!isxdigit((unsigned char)h)) return false;
+            cp = cp * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+          }
+          p += 4;
+          if (cp < 0x80) out += (char)cp;
+          else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+          else { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+          break;
+        }
+        default: return false;
+      }
+      p++;
+    }
+    if (*p != '"') return false;
+    p++;
+    return true;
+  }
+
+  bool parseValue(const char*& p, int depth) {
+    if (depth > 1000) return false;
+    skipWs(p);
+    if (!strncmp(p, "null", 4)) { p += 4; *this = JSONVar(nullptr); return true; }
+    if (!strncmp(p, "true", 4)) { p += 4; *this = JSONVar(true); return true; }
+    if (!strncmp(p, "false", 5)) { p += 5; *this = JSONVar(false); return true; }
+    if (*p == '"') { std::string s; if (!parseString(p, s)) return false; *this = JSONVar(s.c_str()); return true; }
+    if (*p == '-' || isdigit((unsigned char)*p)) {
+      char* end;
+      double d = strtod(p, &end);
+      if (end == p) return false;
+      p = end;
+      *this = JSONVar(d);
+      return true;
+    }
+    if (*p == '[') {
+      p++;
+      *this = JSONVar();
+      _type = Array;
+      skipWs(p);
+      if (*p == ']') { p++; return true; }
+      for (;;) {
+        JSONVar item;
+        if (!item.parseValue(p, depth + 1)) return false;
+        _values.push_back(item);
+        skipWs(p);
+        if (*p == ',') { p++; continue; }
+        if (*p == ']') { p++; return true; }
+        return false;
+      }
+    }
+    if (*p == '{') {
+      p++;
+      *this = JSONVar();
+      _type = Object;
+      skipWs(p);
+      if (*p == '}') { p++; return true; }
+      for (;;) {
+        skipWs(p);
+        std::string key;
+        if (!parseString(p, key)) return false;
+        skipWs(p);
+        if (*p++ != ':') return false;
+        JSONVar item;
+        if (!item.parseValue(p, depth + 1)) return false;
+        _keys.push_back(key);
+        _values.push_back(item);
+        skipWs(p);
+        if (*p == ',') { p++; continue; }
+        if (*p == '}') { p++; return true; }
+        return false;
+      }
+    }
+    return false;
+  }
+};
+
+class JSONClass {
+public:
+  JSONVar parse(const char* s) { return JSONVar::parse(s); }
+  JSONVar parse(const String& s) { return JSONVar::parse(s.c_str()); }
+  String stringify(const JSONVar& v) {
+    std::string out;
+    v.print(out);
+    return String(out);
+  }
+  String typeof(const JSONVar& v) {   // needs -std=c++17, not gnu++17 (typeof keyword)
+    switch (v.type()) {
+      case JSONVar::Null: return "null";
+      case JSONVar::Boolean: return "boolean";
+      case JSONVar::Number: return "number";
+      case JSONVar::Str: return "string";
+      case JSONVar::Array: return "array";
+      case JSONVar::Object: return "object";
+      default: return "undefined";
+    }
+  }
+};
+inline JSONClass JSON;
@@ -0,0 +1,7 @@
+/**
+ * @file AsyncTCP.h
+ * @brief Host stand-in; nothing of AsyncTCP is used directly by the sketches.
+ */
+#pragma once
+
+#include <Arduino.h>
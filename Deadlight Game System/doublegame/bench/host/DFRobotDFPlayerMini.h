@@ -0,0 +1,15 @@
+/**
+ * @file DFRobotDFPlayerMini.h
+ * @brief Host stand-in: reports a player present, commands are ignored.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class DFRobotDFPlayerMini {
+public:
+  bool begin(Stream&, bool = true, bool = true) { return true; }
+  void volume(uint8_t) {}
+  void playFolder(uint8_t, uint8_t) {}
+  void stop() {}
+};
@@ -0,0 +1,89 @@
+/**
+ * @file ESPAsyncWebServer.h
+ * @brief Host stand-in: no HTTP server and no browser clients.
+ *
+ * ws.textAll() goes nowhere and ws.count() is 0. host_main.cpp --ws-stdin
+ * delivers each stdin line to the sketch's onEvent handler as a WS_EVT_DATA
+ * text frame from a separate thread, as AsyncTCP's task does on the board.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+typedef enum { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_ANY = 0b01111111 } WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+typedef struct {
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebServerRequest {
+public:
+  typedef std::function<String(const String&)> AwsTemplateProcessor;
+  void send(int, const char* = "", const String& = String()) {}
+  void send_P(int, const char*, const char*, AwsTemplateProcessor = nullptr) {}
+};
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncWebSocket;
+class AsyncWebSocketClient {
+public:
+  explicit AsyncWebSocketClient(uint32_t id) : _id(id) {}
+  uint32_t id() const { return _id; }
+private:
+  uint32_t _id;
+};
+
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)> AwsEventHandler;
+
+class AsyncWebSocket;
+inline AsyncWebSocket* hostWebSocket = nullptr;   // last one constructed, for --ws-stdin
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+  explicit AsyncWebSocket(const char* url) : _url(url) { hostWebSocket = this; }
+  void onEvent(AwsEventHandler handler) { _handler = handler; }
+  void cleanupClients(uint16_t = 8) {}
+  void textAll(const String&) {}
+  void textAll(const char*) {}
+  size_t count() const { return 0; }
+
+  // One complete, unfragmented text frame, as handleWebSocketMessage expects.
+  void hostDeliverText(const std::string& text) {
+    if (!_handler) return;
+    std::string data = text;   // NUL-terminated copy; the library's buffer usually is too
+    AwsFrameInfo info = {};
+    info.message_opcode = info.opcode = WS_TEXT;
+    info.final = 1;
+    info.len = data.size();
+    _handler(this, &_client, WS_EVT_DATA, &info, (uint8_t*)&data[0], data.size());
+  }
+
+private:
+  const char* _url;
+  AwsEventHandler _handler;
+  AsyncWebSocketClient _client{1};
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t) {}
+  AsyncWebHandler& addHandler(AsyncWebHandler* h) { return *h; }
+  void on(const char*, WebRequestMethodComposite, ArRequestHandlerFunction) {}
+  void begin() {}
+};
@@ -0,0 +1,36 @@
+/**
+ * @file FastLED.h
+ * @brief Host stand-in: the pixel buffer is kept, show() takes no time.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2811 {};
+
+struct CRGB {
+  enum HTMLColorCode : uint32_t {
+    Black = 0x000000, DarkOrange = 0xFF8C00, Gold = 0xFFD700, Green = 0x008000, Red = 0xFF0000, White = 0xFFFFFF
+  };
+  uint8_t r = 0, g = 0, b = 0;
+  CRGB() {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(HTMLColorCode c) : r((c >> 16) & 0xFF), g((c >> 8) & 0xFF), b(c & 0xFF) {}
+};
+
+class CFastLED {
+public:
+  template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  CFastLED& addLeds(CRGB* leds, int count, int = 0) { _leds = leds; _count = count; return *this; }
+  void setBrightness(uint8_t b) { _brightness = b; }
+  uint8_t getBrightness() const { return _brightness; }
+  void show() {}
+private:
+  CRGB* _leds = nullptr;
+  int _count = 0;
+  uint8_t _brightness = 255;
+};
+inline CFastLED FastLED;
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) { for (int i = 0; i < count; i++) leds[i] = color; }
@@ -0,0 +1,23 @@
+/**
+ * @file MFRC522.h
+ * @brief Host stand-in: no card is ever present.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class MFRC522 {
+public:
+  typedef struct {
+    byte size;
+    byte uidByte[10];
+    byte sak;
+  } Uid;
+  Uid uid = {};
+
+  MFRC522(byte, byte) {}
+  void PCD_Init() {}
+  bool PICC_IsNewCardPresent() { return false; }
+  bool PICC_ReadCardSerial() { return false; }
+  byte PICC_HaltA() { return 0; }
+};
@@ -0,0 +1,288 @@
+/**
+ * @file PubSubClient.h
+ * @brief Host build of the PubSubClient 2.8 API the Deadlight sketches use.
+ *
+ * Follows the library's behaviour where it matters for latency and limits:
+ *  - loop() handles at most one incoming packet, and only if bytes are waiting;
+ *  - an incoming packet longer than the buffer is read and silently dropped;
+ *  - publish() returns false when MQTT_MAX_HEADER_SIZE + 2 + topic + payload
+ *    exceeds the buffer;
+ *  - QoS 0 publish, QoS 0/1 subscribe, keep-alive PINGREQ, last will.
+ * When hostConfig.brokerHost is set it replaces the sketch's setServer() host.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define MQTT_VERSION_3_1_1 4
+#define MQTT_MAX_HEADER_SIZE 5
+#ifndef MQTT_KEEPALIVE
+#define MQTT_KEEPALIVE 15
+#endif
+#ifndef MQTT_SOCKET_TIMEOUT
+#define MQTT_SOCKET_TIMEOUT 15
+#endif
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+#define MQTTCONNECT     1 << 4
+#define MQTTCONNACK     2 << 4
+#define MQTTPUBLISH     3 << 4
+#define MQTTPUBACK      4 << 4
+#define MQTTSUBSCRIBE   8 << 4
+#define MQTTSUBACK      9 << 4
+#define MQTTPINGREQ     12 << 4
+#define MQTTPINGRESP    13 << 4
+#define MQTTDISCONNECT  14 << 4
+#define MQTTQOS1        (1 << 1)
+
+class PubSubClient {
+public:
+  typedef std::function<void(char*, uint8_t*, unsigned int)> Callback;
+
+  explicit PubSubClient(Client& client) : _client(&client) { setBufferSize(256); }
+  ~PubSubClient() { free(_buffer); }
+
+  PubSubClient& setServer(const char* domain, uint16_t port) {
+    _domain = hostConfig.brokerHost ? hostConfig.brokerHost : domain;
+    _port = hostConfig.brokerPort ? hostConfig.brokerPort : port;
+    return *this;
+  }
+  PubSubClient& setCallback(Callback cb) { _callback = cb; return *this; }
+  PubSubClient& setKeepAlive(uint16_t s) { _keepAlive = s; return *this; }
+  PubSubClient& setSocketTimeout(uint16_t s) { _socketTimeout = s; return *this; }
+
+  bool setBufferSize(uint16_t size) {
+    if (size == 0) return false;
+    uint8_t* b = (uint8_t*)realloc(_buffer, size);
+    if (!b) return false;
+    _buffer = b;
+    _bufferSize = size;
+    return true;
+  }
+  uint16_t getBufferSize() { return _bufferSize; }
+  int state() { return _state; }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr); }
+  bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos,
+               bool willRetain, const char* willMessage, bool cleanSession = true) {
+    if (connected()) return true;
+    if (!_client->connect(_domain, _port)) { _state = MQTT_CONNECT_FAILED; return false; }
+    _nextMsgId = 1;
+    uint16_t len = MQTT_MAX_HEADER_SIZE;
+    const uint8_t proto[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', MQTT_VERSION_3_1_1};
+    memcpy(_buffer + len, proto, sizeof(proto));
+    len += sizeof(proto);
+    uint8_t flags = willTopic ? (0x04 | (willQos << 3) | (willRetain << 5)) : 0;
+    if (cleanSession) flags |= 0x02;
+    if (user) { flags |= 0x80; if (pass) flags |= 0x40; }
+    _buffer[len++] = flags;
+    _buffer[len++] = _keepAlive >> 8;
+    _buffer[len++] = _keepAlive & 0xFF;
+    len = writeString(id, len);
+    if (willTopic) { len = writeString(willTopic, len); len = writeString(willMessage, len); }
+    if (user) { len = writeString(user, len); if (pass) len = writeString(pass, len); }
+    write(MQTTCONNECT, len - MQTT_MAX_HEADER_SIZE);
+
+    _lastInActivity = _lastOutActivity = millis();
+    while (!_client->available()) {
+      if (millis() - _lastInActivity >= _socketTimeout * 1000UL) {
+        _state = MQTT_CONNECTION_TIMEOUT;
+        _client->stop();
+        return false;
+      }
+      delay(1);
+    }
+    uint8_t llen;
+    uint32_t n = readPacket(&llen);
+    if (n == 4 && _buffer[3] == 0) {
+      _lastInActivity = millis();
+      _pingOutstanding = false;
+      _state = MQTT_CONNECTED;
+      return true;
+    }
+    _state = n == 4 ? _buffer[3] : MQTT_CONNECT_FAILED;
+    _client->stop();
+    return false;
+  }
+
+  void disconnect() {
+    uint8_t pkt[2] = {MQTTDISCONNECT, 0};
+    _client->write(pkt, 2);
+    _state = MQTT_DISCONNECTED;
+    _client->stop();
+  }
+
+  bool connected() {
+    if (!_client->connected()) {
+      if (_state == MQTT_CONNECTED) { _state = MQTT_CONNECTION_LOST; _client->stop(); }
+      return false;
+    }
+    return _state == MQTT_CONNECTED;
+  }
+
+  bool publish(const char* topic, const char* payload, bool retained = false) {
+    return publish(topic, (const uint8_t*)payload, payload ? strnlen(payload, _bufferSize) : 0, retained);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained = false) {
+    if (!connected()) return false;
+    if (_bufferSize < MQTT_MAX_HEADER_SIZE + 2 + strnlen(topic, _bufferSize) + plength) return false;
+    uint16_t len = writeString(topic, MQTT_MAX_HEADER_SIZE);
+    memcpy(_buffer + len, payload, plength);
+    len += plength;
+    return write(MQTTPUBLISH | (retained ? 1 : 0), len - MQTT_MAX_HEADER_SIZE);
+  }
+
+  bool subscribe(const char* topic, uint8_t qos = 0) {
+    if (!connected() || _bufferSize < 9 + strnlen(topic, _bufferSize)) return false;
+    uint16_t len = MQTT_MAX_HEADER_SIZE;
+    if (++_nextMsgId == 0) _nextMsgId = 1;
+    _buffer[len++] = _nextMsgId >> 8;
+    _buffer[len++] = _nextMsgId & 0xFF;
+    len = writeString(topic, len);
+    _buffer[len++] = qos;
+    return write(MQTTSUBSCRIBE | MQTTQOS1, len - MQTT_MAX_HEADER_SIZE);
+  }
+
+  bool loop() {
+    if (!connected()) return false;
+    unsigned long t = millis();
+    if (t - _lastInActivity > _keepAlive * 1000UL || t - _lastOutActivity > _keepAlive * 1000UL) {
+      if (_pingOutstanding) {
+        _state = MQTT_CONNECTION_TIMEOUT;
+        _client->stop();
+        return false;
+      }
+      uint8_t ping[2] = {MQTTPINGREQ, 0};
+      _client->write(ping, 2);
+      _lastOutActivity = _lastInActivity = t;
+      _pingOutstanding = true;
+    }
+    if (_client->available()) {
+      uint8_t llen;
+      uint32_t len = readPacket(&llen);
+      if (len > 0) {
+        _lastInActivity = t;
+        uint8_t type = _buffer[0] & 0xF0;
+        if (type == MQTTPUBLISH) {
+          if (_callback) {
+            uint16_t tl = (_buffer[llen + 1] << 8) + _buffer[llen + 2];
+            memmove(_buffer + llen + 2, _buffer + llen + 3, tl);
+            _buffer[llen + 2 + tl] = 0;
+            char* topic = (char*)_buffer + llen + 2;
+            if ((_buffer[0] & 0x06) == MQTTQOS1) {
+              uint16_t msgId = (_buffer[llen + 3 + tl] << 8) + _buffer[llen + 3 + tl + 1];
+              _callback(topic, _buffer + llen + 3 + tl + 2, len - llen - 3 - tl - 2);
+              uint8_t ack[4] = {MQTTPUBACK, 2, (uint8_t)(msgId >> 8), (uint8_t)(msgId & 0xFF)};
+              _client->write(ack, 4);
+              _lastOutActivity = t;
+            } else {
+              _callback(topic, _buffer + llen + 3 + tl, len - llen - 3 - tl);
+            }
+          }
+        } else if (type == MQTTPINGREQ) {
+          uint8_t resp[2] = {MQTTPINGRESP, 0};
+          _client->write(resp, 2);
+        } else if (type == MQTTPINGRESP) {
+          _pingOutstanding = false;
+        }
+      } else if (!connected()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  Client* _client;
+  uint8_t* _buffer = nullptr;
+  uint16_t _bufferSize = 0;
+  uint16_t _keepAlive = MQTT_KEEPALIVE;
+  uint16_t _socketTimeout = MQTT_SOCKET_TIMEOUT;
+  uint16_t _nextMsgId = 0;
+  unsigned long _lastOutActivity = 0;
+  unsigned long _lastInActivity = 0;
+  bool _pingOutstanding = false;
+  Callback _callback;
+  const char* _domain = nullptr;
+  uint16_t _port = 1883;
+  int _state = MQTT_DISCONNECTED;
+
+  bool readByte(uint8_t* out) {
+    unsigned long start = millis();
+    for (;;) {
+      int r = _client->read(out, 1);
+      if (r == 1) return true;
+      if (r < 0 || millis() - start >= _socketTimeout * 1000UL) return false;
+      std::this_thread::yield();
+    }
+  }
+  bool readByte(uint8_t* out, uint16_t* index) {
+    if (!readByte(out + *index)) return false;
+    (*index)++;
+    return true;
+  }
+
+  // Same bookkeeping as the library: bytes past the buffer are consumed but not
+  // stored, and a packet that did not fit reports length 0 (ignored).
+  uint32_t readPacket(uint8_t* lengthLength) {
+    uint16_t len = 0;
+    if (!readByte(_buffer, &len)) return 0;
+    bool isPublish = (_buffer[0] & 0xF0) == MQTTPUBLISH;
+    uint32_t multiplier = 1, length = 0, start = 0;
+    uint8_t digit = 0;
+    do {
+      if (len == 5) { _state = MQTT_DISCONNECTED; _client->stop(); return 0; }
+      if (!readByte(&digit)) return 0;
+      _buffer[len++] = digit;
+      length += (digit & 127) * multiplier;
+      multiplier <<= 7;
+    } while (digit & 128);
+    *lengthLength = len - 1;
+    if (isPublish) {
+      if (!readByte(_buffer, &len) || !readByte(_buffer, &len)) return 0;
+      start = 2;
+    }
+    uint32_t idx = len;
+    for (uint32_t i = start; i < length; i++) {
+      if (!readByte(&digit)) return 0;
+      if (len < _bufferSize) _buffer[len++] = digit;
+      idx++;
+    }
+    if (idx > _bufferSize) len = 0;
+    return len;
+  }
+
+  uint16_t writeString(const char* s, uint16_t pos) {
+    uint16_t start = pos;
+    pos += 2;
+    for (const char* p = s; *p && pos < _bufferSize; p++) _buffer[pos++] = *p;
+    uint16_t n = pos - start - 2;
+    _buffer[start] = n >> 8;
+    _buffer[start + 1] = n & 0xFF;
+    return pos;
+  }
+
+  bool write(uint8_t header, uint16_t length) {
+    uint8_t lenBuf[4];
+    uint8_t llen = 0;
+    uint16_t len = length;
+    do {
+      uint8_t digit = len & 127;
+      len >>= 7;
+      if (len > 0) digit |= 0x80;
+      lenBuf[llen++] = digit;
+    } while (len > 0);
+    _buffer[4 - llen] = header;
+    memcpy(_buffer + MQTT_MAX_HEADER_SIZE - llen, lenBuf, llen);
+    uint16_t hlen = llen + 1;
+    size_t rc = _client->write(_buffer + (MQTT_MAX_HEADER_SIZE - hlen), length + hlen);
+    _lastOutActivity = millis();
+    return rc == (size_t)(hlen + length);
+  }
+};
@@ -0,0 +1,28 @@
+/**
+ * @file SPI.h
+ * @brief Host stand-in: transfers go nowhere and take no time.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define HSPI 2
+#define VSPI 3
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings {
+public:
+  SPISettings(uint32_t = 1000000, uint8_t = MSBFIRST, uint8_t = SPI_MODE0) {}
+};
+
+class SPIClass {
+public:
+  explicit SPIClass(uint8_t = VSPI) {}
+  void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  void writeBytes(const uint8_t*, uint32_t) {}
+  uint8_t transfer(uint8_t) { return 0; }
+};
+inline SPIClass SPI(VSPI);
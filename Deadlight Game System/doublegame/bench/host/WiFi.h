@@ -0,0 +1,116 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in: the station is always connected, WiFiClient is a plain
+ *        blocking TCP socket (what lwIP gives the sketch on the board).
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class Client : public Stream {
+public:
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+  virtual int read(uint8_t* buf, size_t n) = 0;
+  using Stream::read;
+};
+
+class WiFiClient : public Client {
+public:
+  ~WiFiClient() override { stop(); }
+
+  int connect(const char* host, uint16_t port) override {
+    stop();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &res) != 0) return 0;
+    for (addrinfo* a = res; a; a = a->ai_next) {
+      int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd < 0) continue;
+      if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // PubSubClient sets setNoDelay too
+        _fd = fd;
+        break;
+      }
+      ::close(fd);
+    }
+    freeaddrinfo(res);
+    return _fd >= 0;
+  }
+
+  uint8_t connected() override {
+    if (_fd < 0) return 0;
+    if (available() > 0) return 1;
+    pollfd p = {_fd, POLLIN, 0};
+    if (poll(&p, 1, 0) > 0 && (p.revents & (POLLIN | POLLHUP | POLLERR))) {
+      char c;
+      if (recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0) { stop(); return 0; }
+    }
+    return 1;
+  }
+
+  int available() override {
+    if (_fd < 0) return 0;
+    int n = 0;
+    if (ioctl(_fd, FIONREAD, &n) < 0) return 0;
+    return n;
+  }
+
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+
+  int read(uint8_t* buf, size_t n) override {
+    if (_fd < 0) return -1;
+    ssize_t r = recv(_fd, buf, n, MSG_DONTWAIT);
+    if (r == 0) { stop(); return -1; }
+    if (r < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    return (int)r;
+  }
+
+  size_t write(const uint8_t* buf, size_t n) override {
+    if (_fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < n) {
+      ssize_t r = send(_fd, buf + sent, n - sent, MSG_NOSIGNAL);
+      if (r <= 0) { stop(); break; }
+      sent += r;
+    }
+    return sent;
+  }
+  using Print::write;
+
+  void stop() override {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+  }
+
+private:
+  int _fd = -1;
+};
+
+class WiFiClass {
+public:
+  bool config(IPAddress, IPAddress, IPAddress) { return true; }
+  int begin(const char*, const char*) { return WL_CONNECTED; }
+  int status() { return WL_CONNECTED; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+inline WiFiClass WiFi;
@@ -0,0 +1,70 @@
+/**
+ * @file host_main.cpp
+ * @brief Runs a Deadlight sketch's setup()/loop() as a Linux process.
+ *
+ *   ./esp1 --broker 127.0.0.1:1883 [--serial-baud 115200] [--serial-log FILE]
+ *          [--loop-ms 2] [--ws-stdin]
+ *
+ * --broker replaces the sketch's mqtt_server/port, --serial-baud 0 makes
+ * Serial free, --loop-ms stretches every loop() to at least that long (the
+ * board's SPI, RMT and MFRC522 time, which the shims do not spend), and
+ * --ws-stdin hands each stdin line to the WebSocket handler as a text frame.
+ */
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+void setup();
+void loop();
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [--broker HOST[:PORT]] [--serial-baud N] [--serial-log FILE] [--loop-ms MS] [--ws-stdin]\n",
+          prog);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  bool wsStdin = false;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--broker" && hasValue) {
+      char* host = argv[++i];
+      char* colon = strrchr(host, ':');
+      if (colon) hostConfig.brokerPort = (uint16_t)atoi(colon + 1);
+      hostConfig.brokerHost = colon ? strndup(host, colon - host) : host;
+    } else if (a == "--serial-baud" && hasValue) {
+      hostConfig.serialBaud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (a == "--serial-log" && hasValue) {
+      hostConfig.serialOut = fopen(argv[++i], "a");
+      if (!hostConfig.serialOut) { perror(argv[i]); return 1; }
+    } else if (a == "--loop-ms" && hasValue) {
+      hostConfig.loopMinUs = (uint32_t)(atof(argv[++i]) * 1000);
+    } else if (a == "--ws-stdin") {
+      wsStdin = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  hostConfig.argv = argv;
+  setvbuf(hostConfig.serialOut, nullptr, _IOLBF, 0);
+
+  setup();
+
+  // On the board AsyncTCP runs WebSocket handlers on its own task, next to loop().
+  if (wsStdin && hostWebSocket) {
+    std::thread([] {
+      char line[4096];
+      while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (*line) hostWebSocket->hostDeliverText(line);
+      }
+    }).detach();
+  }
+
+  for (;;) {
+    unsigned long start = micros();
+    loop();
+    unsigned long took = micros() - start;
+    if (took < hostConfig.loopMinUs) delayMicroseconds(hostConfig.loopMinUs - took);
+  }
+}
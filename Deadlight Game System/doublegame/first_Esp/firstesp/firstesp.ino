@@ -12,11 +12,11 @@
 #include <AsyncTCP.h>
 #include <Arduino_JSON.h>
 #include <FastLED.h>
-#include <MD_Parola.h>
-#include <MD_MAX72xx.h>
 #include <SPI.h>
 #include "DFRobotDFPlayerMini.h"
 #include "index_h.h"
+#include "matrix_renderer.h"
+#include "mqtt_bench.h"
 
 //--- NETWORK & MQTT CONFIGURATION ---
 const char* wifi_ssid = "Ents_Test";
@@ -46,7 +46,6 @@ IPAddress subnet(255, 255, 255, 0);
 #define DFPLAYER_TX_PIN     17
 #define NUM_PIXELS          23
 #define BRIGHTNESS          80
-#define MATRIX_HARDWARE_TYPE MD_MAX72XX::FC16_HW
 #define MATRIX_MAX_DEVICES  4
 
 //--- GAME SETTINGS ---
@@ -74,13 +73,14 @@ const char* gameStateNames[] = {
 };
 
 CRGB leds[NUM_PIXELS];
-MD_Parola P(MATRIX_HARDWARE_TYPE, MATRIX_DATA_PIN, MATRIX_CLK_PIN, MATRIX_CS_PIN, MATRIX_MAX_DEVICES);
+MatrixRenderer matrix(MATRIX_DATA_PIN, MATRIX_CLK_PIN, MATRIX_CS_PIN, MATRIX_MAX_DEVICES);
 HardwareSerial mp3Serial(2);
 DFRobotDFPlayerMini myDFPlayer;
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
+MqttBench bench("esp1");
 
 GameState currentState = WAITING_TO_START;
 GameLanguage soundLanguage = LANG_TR;
@@ -105,7 +105,7 @@ void setup() {
   Serial.begin(115200); randomSeed(analogRead(0));
   FastLED.addLeds<WS2811, LED_PIN, BRG>(leds, NUM_PIXELS); FastLED.setBrightness(BRIGHTNESS);
   fill_solid(leds, NUM_PIXELS, CRGB::Black); FastLED.show();
-  P.begin(); P.setIntensity(4);
+  matrix.begin(4);
   mp3Serial.begin(9600, SERIAL_8N1, DFPLAYER_RX_PIN, DFPLAYER_TX_PIN);
   if (myDFPlayer.begin(mp3Serial)) { myDFPlayer.volume(gameVolume); dfPlayerStatus = true; }
   pinMode(BUTTON_1, INPUT_PULLUP); pinMode(BUTTON_2, INPUT_PULLUP); pinMode(BUTTON_3, INPUT_PULLUP); pinMode(BUTTON_4, INPUT_PULLUP);
@@ -122,8 +122,10 @@ void setup() {
   mqttClient.setCallback(mqttCallback);
   ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
     if (type == WS_EVT_DATA) {
+      uint32_t t0 = micros();
       JSONVar jsonData = JSON.parse((char*)data);
       processAction(jsonData);
+      bench.noteWsHandler(micros() - t0);
     }
   });
   server.addHandler(&ws);
@@ -134,9 +136,9 @@ void setup() {
 
 // ======================= MAIN LOOP =========================
 void loop() {
-  if (P.displayAnimate()) P.displayReset();
   ws.cleanupClients();
   if (wifiStatus && !mqttClient.connected()) reconnectMQTT();
+  bench.noteLoop();
   mqttClient.loop();
   if (gameTimerIsActive && (millis() - gameStartTime > GAME_DURATION)) {
     playSound(SOUND_S2_ERROR);
@@ -254,7 +256,7 @@ void loop() {
       if (millis() - winEntryTime > 5000) {
         Serial.println("[TRANSITION] Sending command to start Game 2 on ESP2.");
         if (mqttClient.connected()) {
-            mqttClient.publish("esp32-gamemaster/command", "{\"action\":\"start_mic_game\"}");
+            bench.publish(mqttClient, "esp32-gamemaster/command", "{\"action\":\"start_mic_game\"}");
         }
         goToWaitingState();
         winEntryTime = 0;
@@ -292,7 +294,7 @@ void loop() {
         Serial.println("[SYSTEM] Full system restart triggered by button after Game Over.");
         delay(500);
         if(mqttClient.connected()) {
-          mqttClient.publish("esp32-gamemaster/command", "{\"action\":\"reset_game\"}");
+          bench.publish(mqttClient, "esp32-gamemaster/command", "{\"action\":\"reset_game\"}");
         }
         resetGame(true);
         gameOverMessageShown = false;
@@ -309,17 +311,30 @@ void loop() {
   if (millis() - lastHeartbeat > 5000) {
     lastHeartbeat = millis();
     if (mqttClient.connected()) {
-        mqttClient.publish(esp1_connection_topic, "online", true);
+        bench.publish(mqttClient, esp1_connection_topic, "online", true);
+    }
+    if (bench.active()) {
+        char line[256];
+        bench.summary(line, sizeof(line));
+        Serial.printf("[BENCH] %s\n", line);
     }
   }
 }
 //--- HELPER FUNCTIONS ---
 void playSound(uint8_t track) { if (dfPlayerStatus) { last_played_sound_track = track; myDFPlayer.playFolder((soundLanguage == LANG_TR) ? 1 : 2, track); } }
-void showOnMatrix(const char* text) { strcpy(matrixBuffer, text); P.displayClear(); P.displayText(matrixBuffer, PA_CENTER, 0, 0, PA_NO_EFFECT, PA_NO_EFFECT); }
+void showOnMatrix(const char* text) {
+  strncpy(matrixBuffer, text, sizeof(matrixBuffer) - 1);
+  matrix.print(matrixBuffer);
+  if (!matrix.isScrolling()) {
+    MatrixStats st = matrix.getStats();
+    Serial.printf("[MATRIX] '%s' -> %lu SPI bytes in %lu us (full redraw: %lu bytes)\n", matrixBuffer,
+                  (unsigned long)st.lastBytes, (unsigned long)st.lastMicros, (unsigned long)matrix.fullRedrawBytes());
+  }
+}
 void goToWaitingState() {
     Serial.println("Transitioning to WAITING_TO_START state (memory kept).");
     fill_solid(leds, NUM_PIXELS, CRGB::Black); FastLED.show();
-    P.displayClear(); showOnMatrix("READY"); myDFPlayer.stop();
+    showOnMatrix("READY"); myDFPlayer.stop();
     gameTimerIsActive = false;
     step1Level = 0; step2Level = 0; playerStrikes = 0;
     currentState = WAITING_TO_START;
@@ -420,6 +435,11 @@ String getStatusJSON() {
   hardwareStatus["button3_pressed"] = (digitalRead(BUTTON_3) == LOW);
   hardwareStatus["button4_pressed"] = (digitalRead(BUTTON_4) == LOW);
   hardwareStatus["lastSoundTrack"] = last_played_sound_track;
+  MatrixStats matrixStats = matrix.getStats();
+  hardwareStatus["matrixUpdates"] = (int)matrixStats.updates;
+  hardwareStatus["matrixLastSpiBytes"] = (int)matrixStats.lastBytes;
+  hardwareStatus["matrixLastSpiMicros"] = (int)matrixStats.lastMicros;
+  hardwareStatus["matrixMaxSpiMicros"] = (int)matrixStats.maxMicros;
   gameStateJson["hardware"] = hardwareStatus;
   return JSON.stringify(gameStateJson);
 }
@@ -498,13 +518,16 @@ void notifyClients() {
 }
 void publishStatus(String jsonStatus) { 
     if (mqttClient.connected()) { 
-        bool success = mqttClient.publish(game_status_topic, jsonStatus.c_str(), false); 
+        bool success = bench.publish(mqttClient, game_status_topic, jsonStatus.c_str(), false); 
         if (!success) {
-            Serial.println("[MQTT] !! ESP1 FAILED TO PUBLISH STATUS !!");
+            Serial.printf("[MQTT] !! ESP1 FAILED TO PUBLISH STATUS !! (%u bytes, buffer %u)\n", jsonStatus.length(), mqttClient.getBufferSize());
         }
     } 
 }
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  bench.noteMessage();
+  if (bench.handlePing(mqttClient, topic, payload, length)) return;
+  uint32_t t0 = micros();
   String message;
   for (int i = 0; i < length; i++) { message += (char)payload[i]; }
   Serial.print("MQTT Message Received ["); Serial.print(topic); Serial.print("]: "); Serial.println(message);
@@ -526,12 +549,17 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
         }
       }
     }
+    bench.noteMqttHandler(micros() - t0);
     return;
   }
   if (strcmp(topic, game_control_topic) == 0) {
       JSONVar j = JSON.parse(message);
       processAction(j);
+      if (j.hasOwnProperty("bench_id")) {
+          bench.ack(mqttClient, (long)j["bench_id"], (const char*)j["action"], micros() - t0);
+      }
   }
+  bench.noteMqttHandler(micros() - t0);
 }
 
 void reconnectMQTT() {
@@ -540,9 +568,10 @@ void reconnectMQTT() {
     Serial.print("Attempting MQTT connection for ESP1...");
     if (mqttClient.connect(clientId.c_str(), nullptr, nullptr, esp1_connection_topic, 0, true, "offline")) {
       Serial.println("connected");
-      mqttClient.publish(esp1_connection_topic, "online", true);
+      bench.publish(mqttClient, esp1_connection_topic, "online", true);
       mqttClient.subscribe(game_control_topic);
       mqttClient.subscribe(master_status_topic);
+      mqttClient.subscribe(bench.pingTopic());
     } else {
       Serial.print("failed, rc="); Serial.print(mqttClient.state());
       Serial.println(" try again in 5 seconds");
@@ -0,0 +1,219 @@
+/**
+ * @file mqtt_bench.h
+ * @brief MQTT latency / publish-failure instrumentation shared by both Deadlight ESPs.
+ *
+ * Identical copy in first_Esp/firstesp and second_Esp/sketch_jun12a.
+ *
+ * Used together with bench/deadlight_bench.py:
+ *  - "deadlight/bench/<esp>/ping" {"id":N} is answered on "deadlight/bench/pong"
+ *    straight from mqttCallback, so the round trip is broker + WiFi + the time
+ *    the message waited for the next client.loop().
+ *  - Any game command that carries "bench_id" is acknowledged on the same pong
+ *    topic after it has been handled (command-to-effect latency).
+ *  - Every publish goes through MqttBench::publish(), which counts failures and
+ *    catches packets that would not fit PubSubClient's buffer (publish() just
+ *    returns false for those).
+ *
+ * No Arduino dependencies apart from micros()/heap, so it compiles on a PC too.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+inline uint32_t benchMicros() { return micros(); }
+inline uint32_t benchFreeHeap() { return ESP.getFreeHeap(); }
+#else
+#include <chrono>
+inline uint32_t benchMicros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t benchFreeHeap() { return 0; }
+#endif
+
+#define BENCH_TOPIC_PREFIX  "deadlight/bench/"
+#define BENCH_TOPIC_PONG    "deadlight/bench/pong"
+#define BENCH_MQTT_HEADER   5   // PubSubClient's MQTT_MAX_HEADER_SIZE, reserved in every packet
+
+// Microsecond histogram, 4 sub-buckets per power of two (<= 12.5% error),
+// 0 us .. 16 s in 92 counters.
+class LatencyHistogram {
+public:
+  static const uint8_t BUCKETS = 92;
+
+  void add(uint32_t us) {
+    _counts[bucketOf(us)]++;
+    _n++;
+    _sum += us;
+    if (us > _max) _max = us;
+  }
+
+  // Midpoint of the bucket holding the p-th sample (p = 0..100), clamped to the max seen.
+  uint32_t percentile(float p) const {
+    if (_n == 0) return 0;
+    uint32_t rank = (uint32_t)((p / 100.0f) * (_n - 1)) + 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      seen += _counts[i];
+      if (seen >= rank) {
+        uint32_t mid = lowerEdge(i) + width(i) / 2;
+        return mid < _max ? mid : _max;
+      }
+    }
+    return _max;
+  }
+
+  uint32_t count() const { return _n; }
+  uint32_t max() const { return _max; }
+  uint32_t mean() const { return _n ? (uint32_t)(_sum / _n) : 0; }
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+private:
+  static uint8_t bucketOf(uint32_t us) {
+    if (us < 4) return (uint8_t)us;
+    uint8_t msb = 31 - __builtin_clz(us);
+    if (msb > 23) return BUCKETS - 1;
+    return 4 + (msb - 2) * 4 + ((us >> (msb - 2)) & 3);
+  }
+  static uint32_t lowerEdge(uint8_t i) {
+    if (i < 4) return i;
+    uint8_t shift = (i - 4) / 4;
+    return (uint32_t)(4 + (i - 4) % 4) << shift;
+  }
+  static uint32_t width(uint8_t i) { return i < 4 ? 1 : 1UL << ((i - 4) / 4); }
+
+  uint32_t _counts[BUCKETS] = {};
+  uint32_t _n = 0;
+  uint32_t _max = 0;
+  uint64_t _sum = 0;
+};
+
+struct MqttBenchCounters {
+  uint32_t rx = 0;            // messages delivered to mqttCallback
+  uint32_t pings = 0;
+  uint32_t acks = 0;
+  uint32_t pubOk = 0;
+  uint32_t pubFail = 0;       // includes oversize
+  uint32_t pubOversize = 0;   // packet > buffer, never reached the socket
+  uint32_t maxPacket = 0;     // largest packet we tried to publish (header + topic + payload)
+  uint32_t bufferSize = 0;    // PubSubClient buffer, same limit applies to incoming packets
+};
+
+class MqttBench {
+public:
+  explicit MqttBench(const char* name) : _name(name) {
+    snprintf(_pingTopic, sizeof(_pingTopic), BENCH_TOPIC_PREFIX "%s/ping", name);
+  }
+
+  const char* name() const { return _name; }
+  const char* pingTopic() const { return _pingTopic; }
+  const MqttBenchCounters& counters() const { return _c; }
+  bool active() const { return _c.pings > 0 || _c.acks > 0; }
+
+  // Call right before client.loop(). A message that arrived during the previous
+  // iteration waited (at most) this long before mqttCallback saw it.
+  void noteLoop() {
+    uint32_t now = benchMicros();
+    if (_lastLoopUs) {
+      _lastGapUs = now - _lastLoopUs;
+      loopGap.add(_lastGapUs);
+    }
+    _lastLoopUs = now;
+  }
+
+  void noteMessage() { _c.rx++; }
+  void noteMqttHandler(uint32_t us) { mqttHandler.add(us); }
+  void noteWsHandler(uint32_t us) { wsHandler.add(us); }
+
+  template <class MqttClient>
+  bool publish(MqttClient& client, const char* topic, const char* payload, bool retained = false) {
+    uint32_t packet = BENCH_MQTT_HEADER + 2 + strlen(topic) + strlen(payload);
+    if (packet > _c.maxPacket) _c.maxPacket = packet;
+    _c.bufferSize = client.getBufferSize();
+    if (packet > _c.bufferSize) {
+      _c.pubOversize++;
+      _c.pubFail++;
+      return false;
+    }
+    bool ok = client.publish(topic, payload, retained);
+    if (ok) _c.pubOk++; else _c.pubFail++;
+    return ok;
+  }
+
+  // Answers a ping and returns true if the message was one; otherwise false and
+  // the caller handles it as usual.
+  template <class MqttClient>
+  bool handlePing(MqttClient& client, const char* topic, const uint8_t* payload, unsigned int length) {
+    if (strcmp(topic, _pingTopic) != 0) return false;
+    _c.pings++;
+    char reply[384];
+    int n = snprintf(reply, sizeof(reply), "{\"esp\":\"%s\",\"id\":%ld,\"gap_us\":%lu,\"len\":%u,",
+                     _name, findId(payload, length, "\"id\""), (unsigned long)_lastGapUs, length);
+    statsFields(reply + n, sizeof(reply) - n);
+    publish(client, BENCH_TOPIC_PONG, reply);
+    return true;
+  }
+
+  // Acknowledge a handled command that carried "bench_id".
+  template <class MqttClient>
+  void ack(MqttClient& client, long id, const char* action, uint32_t handlerUs) {
+    _c.acks++;
+    char reply[160];
+    snprintf(reply, sizeof(reply), "{\"esp\":\"%s\",\"ack\":%ld,\"action\":\"%.32s\",\"handler_us\":%lu,\"gap_us\":%lu}",
+             _name, id, action ? action : "", (unsigned long)handlerUs, (unsigned long)_lastGapUs);
+    publish(client, BENCH_TOPIC_PONG, reply);
+  }
+
+  // One-line summary for Serial.
+  int summary(char* out, size_t cap) const {
+    return snprintf(out, cap, "rx=%lu pub ok/fail/oversize=%lu/%lu/%lu max_pkt=%lu | loop gap p50/p99/max=%lu/%lu/%lu us"
+                    " | mqtt handler p50/p99=%lu/%lu us | ws handler p50/p99=%lu/%lu us",
+                    (unsigned long)_c.rx, (unsigned long)_c.pubOk, (unsigned long)_c.pubFail, (unsigned long)_c.pubOversize,
+                    (unsigned long)_c.maxPacket, (unsigned long)loopGap.percentile(50), (unsigned long)loopGap.percentile(99),
+                    (unsigned long)loopGap.max(), (unsigned long)mqttHandler.percentile(50),
+                    (unsigned long)mqttHandler.percentile(99), (unsigned long)wsHandler.percentile(50),
+                    (unsigned long)wsHandler.percentile(99));
+  }
+
+  LatencyHistogram loopGap;
+  LatencyHistogram mqttHandler;
+  LatencyHistogram wsHandler;
+
+private:
+  // Integer value of `key` in a flat JSON payload; -1 if absent.
+  static long findId(const uint8_t* payload, unsigned int length, const char* key) {
+    size_t keyLen = strlen(key);
+    for (unsigned int i = 0; i + keyLen < length; i++) {
+      if (memcmp(payload + i, key, keyLen) != 0) continue;
+      unsigned int j = i + keyLen;
+      while (j < length && (payload[j] == ':' || payload[j] == ' ')) j++;
+      long v = 0;
+      bool any = false;
+      while (j < length && payload[j] >= '0' && payload[j] <= '9') { v = v * 10 + (payload[j++] - '0'); any = true; }
+      return any ? v : -1;
+    }
+    return -1;
+  }
+
+  void statsFields(char* out, size_t cap) const {
+    snprintf(out, cap, "\"rx\":%lu,\"pub_ok\":%lu,\"pub_fail\":%lu,\"oversize\":%lu,\"max_pkt\":%lu,\"buf\":%lu,"
+             "\"gap_p50\":%lu,\"gap_p99\":%lu,\"gap_max\":%lu,\"handler_p50\":%lu,\"handler_p99\":%lu,"
+             "\"ws_p99\":%lu,\"heap\":%lu}",
+             (unsigned long)_c.rx, (unsigned long)_c.pubOk, (unsigned long)_c.pubFail, (unsigned long)_c.pubOversize,
+             (unsigned long)_c.maxPacket, (unsigned long)_c.bufferSize, (unsigned long)loopGap.percentile(50),
+             (unsigned long)loopGap.percentile(99), (unsigned long)loopGap.max(), (unsigned long)mqttHandler.percentile(50),
+             (unsigned long)mqttHandler.percentile(99), (unsigned long)wsHandler.percentile(99),
+             (unsigned long)benchFreeHeap());
+  }
+
+  const char* _name;
+  char _pingTopic[40];
+  MqttBenchCounters _c;
+  uint32_t _lastLoopUs = 0;
+  uint32_t _lastGapUs = 0;
+};
@@ -17,6 +17,7 @@
 #include <Adafruit_NeoPixel.h>
 #include <AccelStepper.h>
 #include "index_h.h"
+#include "mqtt_bench.h"
 
 // ====================================================================================================
 //                                      TANIMLAMALAR VE AYARLAR
@@ -55,6 +56,7 @@ AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 WiFiClient espClient;
 PubSubClient client(espClient);
+MqttBench bench("esp2");
 
 // --- Kontrol Edilebilir Ayarlar ---
 long game1_selectionInterval = 50;
@@ -152,6 +154,7 @@ void loop() {
     if (!client.connected()) {
         reconnect();
     }
+    bench.noteLoop();
     client.loop();
 
     switch (currentGameMode) {
@@ -182,7 +185,12 @@ void loop() {
     if (millis() - lastHeartbeat > 5000) {
         lastHeartbeat = millis();
         if (client.connected()) {
-            client.publish(esp2_connection_topic, "online", true);
+            bench.publish(client, esp2_connection_topic, "online", true);
+        }
+        if (bench.active()) {
+            char line[256];
+            bench.summary(line, sizeof(line));
+            Serial.printf("[BENCH] %s\n", line);
         }
     }
 }
@@ -194,9 +202,9 @@ void notifyClients() {
         ws.textAll(statusJson); 
     }
     if(client.connected()) {
-        bool success = client.publish(mqtt_status_topic, statusJson.c_str(), false);
+        bool success = bench.publish(client, mqtt_status_topic, statusJson.c_str(), false);
         if (!success) {
-            Serial.println("[MQTT] !! ESP2 FAILED TO PUBLISH STATUS !!");
+            Serial.printf("[MQTT] !! ESP2 FAILED TO PUBLISH STATUS !! (%u bytes, buffer %u)\n", statusJson.length(), client.getBufferSize());
         }
     }
 }
@@ -259,6 +267,7 @@ void applySettings(JSONVar& newSettings) {
 void handleWebSocketMessage(void *arg, uint8_t *data, size_t len) {
     AwsFrameInfo *info = (AwsFrameInfo*)arg;
     if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+        uint32_t t0 = micros();
         JSONVar cmd = JSON.parse((char*)data);
         if (JSON.typeof(cmd) == "undefined") { return; }
         String action = (const char*)cmd["action"];
@@ -283,6 +292,7 @@ void handleWebSocketMessage(void *arg, uint8_t *data, size_t len) {
                 applySettings(settingsPayload);
             }
         }
+        bench.noteWsHandler(micros() - t0);
     }
 }
 
@@ -298,9 +308,10 @@ void reconnect() {
         Serial.print("Attempting MQTT connection for ESP2...");
         if (client.connect(clientId.c_str(), nullptr, nullptr, esp2_connection_topic, 0, true, "offline")) {
             Serial.println("connected");
-            client.publish(esp2_connection_topic, "online", true);
+            bench.publish(client, esp2_connection_topic, "online", true);
             client.subscribe(mqtt_command_topic);
             client.subscribe(mqtt_settings_topic);
+            client.subscribe(bench.pingTopic());
         } else {
             Serial.print("failed, rc="); Serial.print(client.state());
             Serial.println(" try again in 5 seconds");
@@ -310,19 +321,22 @@ void reconnect() {
 }
 
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    bench.noteMessage();
+    if (bench.handlePing(client, topic, payload, length)) return;
+    uint32_t t0 = micros();
     String message;
     for (int i = 0; i < length; i++) { message += (char)payload[i]; }
     Serial.printf("MQTT Message arrived on topic: %s. Payload: %s\n", topic, message.c_str());
     if (strcmp(topic, mqtt_command_topic) == 0) {
         JSONVar cmd = JSON.parse(message);
-        if (JSON.typeof(cmd) == "undefined") { return; }
+        if (JSON.typeof(cmd) == "undefined") { bench.noteMqttHandler(micros() - t0); return; }
         String action = (const char*)cmd["action"];
         if (action == "start_mic_game" || action == "replay_mic_game") { startMicrophoneGame(); } 
         else if (action == "reset_game") { setIdleMode(); delay(100); currentGameMode = MODE_HOMING; currentHomingState = SEARCHING_FOR_CARD; } 
         else if (action == "skip_mic_game") { Serial.println("[COMMAND] Skipping mic game..."); currentGameMode = MODE_GAME2_WON; }
         else if (action == "force_win_game2") {
             Serial.println("[COMMAND] Forcing Game 2 win...");
-            if (client.connected()) { client.publish(mqtt_status_topic, "{\"event\":\"game2_won\"}"); }
+            if (client.connected()) { bench.publish(client, mqtt_status_topic, "{\"event\":\"game2_won\"}"); }
             setIdleMode();
         }
         else if (action == "reset_system") {
@@ -330,10 +344,13 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
             delay(500);
             ESP.restart();
         }
+        if (cmd.hasOwnProperty("bench_id")) { bench.ack(client, (long)cmd["bench_id"], action.c_str(), micros() - t0); }
     } else if (strcmp(topic, mqtt_settings_topic) == 0) {
         JSONVar settings = JSON.parse(message);
         applySettings(settings);
+        if (settings.hasOwnProperty("bench_id")) { bench.ack(client, (long)settings["bench_id"], "settings", micros() - t0); }
     }
+    bench.noteMqttHandler(micros() - t0);
 }
 
 // ======================= OYUN VE YARDIMCI FONKSİYONLAR =========================
@@ -350,7 +367,7 @@ bool compareUIDs(byte* uid1, const byte* uid2, int size) { for (int i = 0; i < s
 
 void resetAndStartVoltmeterGame() {
     Serial.println("[ACTION] Starting Voltmeter game...");
-    if (client.connected()) { client.publish(topic_game_control, "{\"action\":\"reset_game\"}"); }
+    if (client.connected()) { bench.publish(client, topic_game_control, "{\"action\":\"reset_game\"}"); }
     digitalWrite(POWER_ENABLE_PIN, HIGH);
     stepper.setMaxSpeed(stepper_max_speed);
     stepper.setAcceleration(stepper_acceleration);
@@ -378,7 +395,7 @@ void handleCardAndStartGame() {
         if (!client.connected()) reconnect();
         char jsonPayload[50];
         sprintf(jsonPayload, "{\"action\":\"start_game\", \"level\":%d}", game1_selectedLevel);
-        client.publish(topic_game_control, jsonPayload);
+        bench.publish(client, topic_game_control, jsonPayload);
         Serial.printf("[MQTT] Command sent: %s\n", jsonPayload);
         currentGameMode = MODE_HOMING;
         currentHomingState = SEARCHING_FOR_CARD;
@@ -518,7 +535,7 @@ void runGame2WinSequence() {
         commandsSent = false;
         Serial.println("[STATE] Game 2 Won! Announcing to ESP1 and waiting 5 seconds...");
         if (client.connected()) {
-            client.publish(mqtt_status_topic, "{\"event\":\"game2_won\"}");
+            bench.publish(client, mqtt_status_topic, "{\"event\":\"game2_won\"}");
         }
     }
     if (millis() - lastBlinkTime > 200) {
@@ -535,7 +552,7 @@ void runGame2WinSequence() {
     if (millis() - winStartTime > 5000 && !commandsSent) {
         Serial.println("[TRANSITION] Win sequence finished. Triggering Game 1 on ESP1.");
         if(client.connected()) {
-            client.publish(topic_game_control, "{\"action\":\"start_game\"}");
+            bench.publish(client, topic_game_control, "{\"action\":\"start_game\"}");
         }
         commandsSent = true;
         setIdleMode();
@@ -10,6 +10,7 @@
 #include <AiEsp32RotaryEncoder.h> // Rotary encoder'ı (döner kodlayıcı) okumak için.
 #include <Preferences.h>     // ESP32'nin flash belleğinde kalıcı veri saklamak için (bu kodda aktif kullanımı görünmüyor ama dahil edilmiş).
 #include <PubSubClient.h>    // MQTT (Message Queuing Telemetry Transport) protokolü ile iletişim için.
+#include <algorithm>         // Gecikme yüzdeliklerini hesaplarken örnekleri sıralamak için (std::sort).
 
 // --- BÖLÜM 2: GLOBAL SABİTLER VE DEĞİŞKENLER ---
 
@@ -24,8 +25,16 @@ const int mqtt_port = 1883;                                  // MQTT broker port
 const char* mqtt_client_id = "esp32AdvancedControl";         // ESP32 için benzersiz MQTT istemci ID'si
 WiFiClient espClient;                 // MQTT için Wi-Fi istemci nesnesi
 PubSubClient mqttClient(espClient);   // MQTT istemci nesnesi
-unsigned long lastMqttPublishTime = 0; // Son MQTT yayın zamanı
-unsigned long mqttPublishInterval = 5000; // MQTT yayın aralığı (milisaniye) - örneğin 5 saniye
+// MQTT durum yayını: sadece değişen alanlar yayınlanır. Hızlı değişiklikler (örn. encoder çevirme)
+// MQTT_COALESCE_MS penceresinde birleştirilir. Broker ile senkron kalmak için tüm alanlar
+// bağlantı kurulunca ve MQTT_FULL_REFRESH_MS aralığıyla tekrar yayınlanır.
+#define MQTT_COALESCE_MS       250     // İlk değişiklikten sonra bu kadar bekle, son değeri tek seferde yayınla.
+#define MQTT_FULL_REFRESH_MS   300000  // Tam yenileme aralığı (5 dakika).
+#define MQTT_INPUT_SAMPLE_MS   100     // Butonlar gibi doğrudan okunan alanların kontrol aralığı.
+#define MQTT_PUBLISH_PACKED_JSON false // true: tüm durum tek bir JSON mesajı olarak "esp32/status/json" konusuna yayınlanır.
+#define MQTT_BUFFER_SIZE       512     // PubSubClient varsayılanı 256; paketlenmiş JSON (~350 bayt) sığmaz.
+const char* mqtt_topic_status_json = "esp32/status/json";
+unsigned long lastMqttFullRefreshTime = 0; // Son tam yenileme zamanı
 
 // NeoPixel LED Ayarları
 #define LED_PIN       2    // NeoPixel LED şeridinin DATA pininin bağlı olduğu ESP32 pini.
@@ -98,7 +107,111 @@ const char* IR_ACTION_BACK_TRACK = "back_track"; // Önceki parça (bazı kumand
 
 // JSON Dokümanları (Veri yapılandırma için önceden bellek ayrılır)
 StaticJsonDocument<1024> jsonDocHttp; // Web sunucusu yanıtları için JSON dokümanı.
-StaticJsonDocument<512> jsonDocMqtt;  // MQTT mesajları için JSON dokümanı (bu kodda doğrudan kullanılmıyor ama ileride gerekebilir).
+StaticJsonDocument<512> jsonDocMqtt;  // MQTT mesajları için JSON dokümanı (tek konulu, paketlenmiş durum yayını için).
+
+// FreeRTOS Görev ve Kuyruk Ayarları
+// Girdiler (encoder, IR, DFPlayer olayları, HTTP ve MQTT komutları) doğrudan durumu değiştirmez;
+// hepsi bir DeviceCommand olarak commandQueue'ya atılır. Paylaşılan durumu (globalBrightness,
+// currentLedR/G/B, currentTrackNumber, ses, modlar) SADECE Task_Actor değiştirir.
+#define TASK_PRIO_INPUT      5  // Encoder + IR (en yüksek öncelik)
+#define TASK_PRIO_ACTOR      4  // Durumun sahibi olan görev
+#define TASK_PRIO_DFPLAYER   3  // DFPlayer seri port olayları
+#define TASK_PRIO_NETWORK    1  // HTTP + MQTT (en düşük öncelik)
+#define COMMAND_QUEUE_LENGTH 32
+#define INPUT_POLL_MS        5  // IR ve encoder butonu en geç bu aralıkla kontrol edilir.
+#define ENCODER_CLICK_LOCKOUT_MS 100 // Buton titreşimi (bounce) için kilit süresi.
+
+enum CommandSource { SRC_ENCODER, SRC_IR, SRC_WEB, SRC_MQTT, SRC_DFPLAYER, SRC_COUNT };
+const char* commandSourceNames[SRC_COUNT] = {"encoder", "ir", "web", "mqtt", "dfplayer"};
+
+enum CommandType {
+    CMD_ENCODER_VALUE,   // a: encoder değeri, b: encoder mod dönemi (epoch)
+    CMD_ENCODER_CLICK,
+    CMD_IR_CODE,         // a: ham IR kodu
+    CMD_LED_SET_STATE,   // a: 1 açık, 0 kapalı
+    CMD_LED_TOGGLE,
+    CMD_SET_BRIGHTNESS,  // a: 0-255
+    CMD_SET_RGB,         // a, b, c: R, G, B
+    CMD_DF_SET_VOLUME,   // a: 0-30
+    CMD_DF_PLAY_TRACK,   // a: parça numarası
+    CMD_DF_ACTION,       // a: DFAction
+    CMD_DF_EVENT         // a: DFPlayer mesaj tipi, b: değer
+};
+enum DFAction { DF_PLAY_CURRENT, DF_PAUSE, DF_NEXT, DF_PREV, DF_MUTE_TOGGLE };
+
+struct DeviceCommand {
+    CommandType type;
+    CommandSource source;
+    int32_t a, b, c;
+    uint32_t createdUs; // Girdinin algılandığı an (micros), girdi->aksiyon gecikmesini ölçmek için.
+};
+
+QueueHandle_t commandQueue;           // Tüm girdilerin Task_Actor'a aktığı kuyruk.
+SemaphoreHandle_t dfMutex;            // DFPlayer seri portuna aynı anda tek görevin erişmesi için.
+portMUX_TYPE stateMux = portMUX_INITIALIZER_UNLOCKED; // statusSnapshot kopyası için.
+TaskHandle_t Task_Input_Handle = NULL;
+TaskHandle_t Task_Actor_Handle = NULL;
+TaskHandle_t Task_DFPlayer_Handle = NULL;
+TaskHandle_t Task_Network_Handle = NULL;
+volatile uint32_t encoderIsrPendingUs = 0; // Okunmamış ilk encoder kesmesinin zamanı.
+volatile uint32_t encoderModeEpoch = 0;    // Mod değişince artar; eski moddaki encoder değerleri yok sayılır.
+volatile bool statusPublishPending = false; // Task_Actor durumu değiştirdi, Task_Network yayınlayacak.
+volatile uint32_t droppedCommands = 0;     // Kuyruk dolu olduğu için atılan komut sayısı.
+
+// Task_Network ve web handler'larının okuduğu durum kopyası (Task_Actor her değişiklikte günceller).
+struct StatusSnapshot {
+    int encoderMode;
+    int irDpadMode;
+    bool sdCardOnline;
+    bool ledsOn;
+    int brightness;
+    uint8_t ledR, ledG, ledB;
+    bool dfMuted;
+    int dfVolume;
+    int trackNumber;
+};
+StatusSnapshot statusSnapshot;
+
+// MQTT durum kaydı: her alanın konusu, JSON anahtarı ve broker'a en son gönderilen değeri.
+// Değeri en son yayınlanandan farklı olan alanın "dirty" biti set edilir.
+enum StatusField {
+    SF_WIFI_SSID, SF_ENCODER_MODE, SF_ENCODER_BUTTON, SF_BUTTON_D12, SF_IR_DPAD_MODE, SF_SD_CARD, SF_LEDS_ON,
+    SF_BRIGHTNESS, SF_COLOR_RGB, SF_DF_MUTED, SF_DF_VOLUME, SF_DF_TRACK_NUMBER, SF_DF_TRACK_NAME, SF_COUNT
+};
+const char* statusTopics[SF_COUNT] = {
+    "esp32/status/wifiSSID", "esp32/status/encoderMode", "esp32/status/encoderButton", "esp32/status/buttonD12",
+    "esp32/status/irDpadMode", "esp32/status/sdCard", "esp32/status/ledsOn", "esp32/status/brightness",
+    "esp32/status/led/colorRGB", "esp32/status/dfplayer/muted", "esp32/status/dfVolume",
+    "esp32/status/dfTrackNumber", "esp32/status/dfTrackName"
+};
+const char* statusJsonKeys[SF_COUNT] = {
+    "wifiSSID", "encoderMode", "encoderButton", "buttonD12", "irDpadMode", "sdCard", "ledsOn",
+    "brightness", "colorRGB", "dfMuted", "dfVolume", "dfTrackNumber", "dfTrackName"
+};
+#define STATUS_VALUE_LEN 40
+#define STATUS_ALL_FIELDS ((1UL << SF_COUNT) - 1)
+char statusPublished[SF_COUNT][STATUS_VALUE_LEN]; // Broker'a en son giden değerler (Task_Network).
+uint32_t statusDirtyMask = 0;                     // Yayınlanmayı bekleyen alanlar.
+unsigned long statusFirstDirtyMs = 0;             // Birleştirme penceresinin başlangıcı.
+
+// MQTT yayın istatistikleri (dakikalık rapor için).
+struct MqttPublishStats {
+    uint32_t publishes;
+    uint32_t bytes;          // Tahmini MQTT PUBLISH paket boyutu (başlık + konu + veri).
+    uint32_t fullRefreshes;
+    uint32_t oversize;       // MQTT_BUFFER_SIZE'a sığmadığı için gönderilmeyen paketler.
+};
+MqttPublishStats mqttStats;       // Açılıştan beri toplam.
+MqttPublishStats mqttStatsWindow; // Son rapordan beri.
+
+// Girdi->aksiyon gecikme ölçümü (kaynak başına son LATENCY_SAMPLES örnek, mikrosaniye).
+#define LATENCY_SAMPLES 128
+struct LatencyRing {
+    uint32_t us[LATENCY_SAMPLES];
+    uint16_t head;
+    uint16_t count;
+};
+LatencyRing latencyRings[SRC_COUNT];
 
 // Web Arayüzü HTML Kodu
 // PROGMEM: Bu büyük string'in ESP32'nin flash belleğinde saklanmasını sağlar, RAM'i tüketmez.
@@ -107,19 +220,41 @@ const char PROGMEM INDEX_HTML[] = R"rawliteral(
 <!DOCTYPE html><html lang="en"><head><meta charset="UTF-8"><title>ESP32 Advanced Control</title><meta name="viewport" content="width=device-width, initial-scale=1"><style>body{font-family:'Roboto',Arial,sans-serif;background-color:#121212;color:#e0e0e0;padding:15px;display:flex;flex-direction:column;align-items:center;margin:0}h1{color:#e53935;text-align:center;text-shadow:1px 1px 3px #000;margin-bottom:25px}h3{color:#ff7961;text-align:left;border-bottom:2px solid #b71c1c;padding-bottom:8px;margin-top:20px;margin-bottom:15px}.grid-container{display:grid;grid-template-columns:repeat(auto-fit, minmax(320px, 1fr));gap:25px;width:100%;max-width:1200px}.card{background-color:#1e1e1e;border:1px solid #c21807;border-radius:10px;padding:20px;box-shadow:0 6px 12px rgba(0,0,0,0.5)}button{background-color:#b71c1c;color:white;border:none;padding:10px 15px;margin:5px;border-radius:6px;cursor:pointer;font-size:1em;font-weight:500;transition:background-color .3s,transform .1s;box-shadow:0 2px 4px rgba(0,0,0,0.3)}button:hover{background-color:#f4511e;transform:translateY(-1px)}.status-item{margin-bottom:12px;font-size:1em;line-height:1.6}.status-label{font-weight:700;color:#ffab91}.track-buttons button,.ir-sim-buttons button{min-width:48px;height:48px;margin:4px}.color-button{width:38px;height:38px;margin:5px;border:2px solid #121212;border-radius:50%;padding:0;cursor:pointer}.color-preview{width:50px;height:25px;border:2px solid #ffab91;display:inline-block;vertical-align:middle;margin-left:10px;border-radius:4px}input[type=color]{width:50px;height:35px;border:1px solid #555;border-radius:4px;padding:2px;cursor:pointer;vertical-align:middle;margin-left:10px}input[type=range]{width:calc(100% - 180px);margin:0 10px;vertical-align:middle;cursor:pointer}label{vertical-align:middle;margin-right:5px}.controls-row{display:flex;flex-wrap:wrap;align-items:center;margin-bottom:12px;gap:10px}</style></head><body><h1>ESP32 Advanced Control Panel</h1><div class="grid-container"><div class="card"><h3>General Status</h3><div class="status-item"><span class="status-label">WiFi Network: </span><span id="wifiSSID">Loading...</span></div><div class="status-item"><span class="status-label">MQTT Status: </span><span id="mqttStatus">Loading...</span></div><div class="status-item"><span class="status-label">Active Encoder Mode: </span><span id="encoderModeStatus">Loading...</span></div><div class="status-item"><span class="status-label">Encoder Button (GPIO14): </span><span id="encoderButtonStatus">Not Pressed</span></div><div class="status-item"><span class="status-label">External Button (GPIO12): </span><span id="externalButtonD12Status">Not Pressed</span></div><div class="status-item"><span class="status-label">IR D-Pad Mode: </span><span id="irDpadModeStatus">LED Control</span></div><div class="status-item"><span class="status-label">SD Card: </span><span id="sdStatus">Loading...</span></div></div><div class="card"><h3>LED Control</h3><div class="controls-row"><button id="ledToggleBtn" onclick="sendIrAction('power')">Toggle LEDs (IR Power)</button></div><div class="controls-row"><label for="brightnessSlider" class="status-label">Brightness:</label><input type="range" id="brightnessSlider" min="0" max="255" value="120" oninput="updateBrightnessValue(this.value)" onchange="setBrightness(this.value)"><span id="brightnessValue">120</span></div><div class="status-item controls-row"><span class="status-label">Current Color:</span><input type="color" id="rgbColorPicker" onchange="setRGBColor(this.value)"><div id="currentColorPreview" class="color-preview"></div></div></div><div class="card"><h3>DFPlayer Control</h3><div class="status-item"><span class="status-label">Volume Level: </span><span id="volumeStatus">Loading...</span> (<span id="dfPlayerMutedStatus"></span>)</div><div class="status-item"><span class="status-label">Playing Track: </span><span id="trackStatus">Loading...</span> (<span id="trackNameStatus"></span>)</div><div class="controls-row"><label for="dfVolumeSlider" class="status-label">Set Volume:</label><input type="range" id="dfVolumeSlider" min="0" max="30" value="20" oninput="updateDfVolumeValue(this.value)" onchange="setDFVolume(this.value)"><span id="dfVolumeValue">20</span></div><div class="controls-row button-group"><button onclick="sendIrAction('play_stop')">Play/Pause (IR)</button><button onclick="sendIrAction('next_track')">Next (IR)</button><button onclick="sendIrAction('back_track')">Prev (IR)</button><button onclick="sendIrAction('mute')">Mute/Unmute (IR)</button></div><div><p class="status-label">Select Track (Direct):</p><span id="trackButtonsContainer"></span></div></div><div class="card"><h3>Simulate IR Remote</h3><div class="ir-sim-buttons"><button onclick="sendIrAction('power')">Power</button><button onclick="sendIrAction('mute')">Mute</button><button onclick="sendIrAction('music_btn')">Music</button><button onclick="sendIrAction('play_stop')">Play/Stop</button><br><button onclick="sendIrAction('up')">Up</button><button onclick="sendIrAction('down')">Down</button><button onclick="sendIrAction('left')">Left</button><button onclick="sendIrAction('right')">Right</button><button onclick="sendIrAction('enter')">Enter</button><br><button onclick="sendIrAction('vol_up')">Vol+</button><button onclick="sendIrAction('vol_down')">Vol-</button><button onclick="sendIrAction('ffwd')">FFWD</button><button onclick="sendIrAction('rew')">REW</button><button onclick="sendIrAction('next_track')">Next Trk</button><button onclick="sendIrAction('back_track')">Back Trk</button></div></div></div><script>const totalTracks=5;function sendCommand(url){fetch(url).then(response=>{if(!response.ok)console.error('Command Error:',response.status);return response.text()}).then(data=>console.log(url+'->'+data)).catch(error=>console.error('Fetch Error:',error));setTimeout(updateStatus,300)}function sendIrAction(actionName){sendCommand('/ir_action?cmd='+actionName)}function setBrightness(value){sendCommand('/set_brightness?value='+value)}function updateBrightnessValue(value){document.getElementById('brightnessValue').textContent=value}function setRGBColor(hexColor){const r=parseInt(hexColor.substr(1,2),16);const g=parseInt(hexColor.substr(3,2),16);const b=parseInt(hexColor.substr(5,2),16);sendCommand(`/set_led_rgb?r=${r}&g=${g}&b=${b}`)}function setDFVolume(volume){sendCommand('/set_df_volume?value='+volume)}function updateDfVolumeValue(value){document.getElementById('dfVolumeValue').textContent=value}function playTrack(trackNum){sendCommand('/play_track?track='+trackNum)}function updateStatus(){fetch('/status').then(response=>response.json()).then(data=>{document.getElementById('wifiSSID').textContent=data.wifiSSID||"Not Connected";document.getElementById('mqttStatus').textContent=data.mqttConnected?"Connected":"Disconnected";document.getElementById('encoderModeStatus').textContent=data.encoderMode;document.getElementById('encoderButtonStatus').textContent=data.encoderButtonPressed?"Pressed":"Not Pressed";document.getElementById('externalButtonD12Status').textContent=data.externalButtonD12Pressed?"Pressed":"Not Pressed";document.getElementById('irDpadModeStatus').textContent=data.irDpadMode;document.getElementById('sdStatus').textContent=data.sdCardOnline?"Online":"Offline/Error";document.getElementById('ledToggleBtn').textContent=data.ledsOn?"Turn LEDs Off":"Turn LEDs On";const brightnessSlider=document.getElementById('brightnessSlider');if(document.activeElement!==brightnessSlider){brightnessSlider.value=data.brightness}document.getElementById('brightnessValue').textContent=data.brightness;const colorHex='#'+[data.ledR,data.ledG,data.ledB].map(c=>parseInt(c).toString(16).padStart(2,'0')).join('');document.getElementById('currentColorPreview').style.backgroundColor=colorHex;const colorPicker=document.getElementById('rgbColorPicker');if(document.activeElement!==colorPicker)colorPicker.value=colorHex;document.getElementById('volumeStatus').textContent=data.dfVolume!==-1?data.dfVolume:"N/A";document.getElementById('dfPlayerMutedStatus').textContent=data.dfPlayerMuted?"MUTED":"";const dfVolumeSlider=document.getElementById('dfVolumeSlider');if(document.activeElement!==dfVolumeSlider){dfVolumeSlider.value=data.dfVolume!==-1?data.dfVolume:20}document.getElementById('dfVolumeValue').textContent=data.dfVolume!==-1?data.dfVolume:20;document.getElementById('trackStatus').textContent=data.dfTrack!==-1&&data.dfTrack!==0?data.dfTrack:"Stopped";document.getElementById('trackNameStatus').textContent=data.dfTrackName||"";console.log("Status updated:",data)}).catch(error=>console.error('Could not get status:',error))}function createTrackButtons(){const container=document.getElementById('trackButtonsContainer');if(container){container.innerHTML='';for(let i=1;i<=totalTracks;i++){const btn=document.createElement('button');btn.textContent=i;btn.onclick=function(){playTrack(i)};container.appendChild(btn)}}}window.onload=()=>{createTrackButtons();updateStatus();setInterval(updateStatus,2200)};</script></body></html>
 )rawliteral";
 
+
 // --- BÖLÜM 3: FONKSİYON PROTOTOTİPLERİ ---
 // Bu, derleyiciye bu fonksiyonların daha sonra tanımlanacağını bildirir (kodun okunurluğunu artırır).
 void setupHardware();
 void setupWiFi();
 void setupMQTT();
+void setupTasks();
+void Task_Input(void *pvParameters);
+void Task_Actor(void *pvParameters);
+void Task_DFPlayer(void *pvParameters);
+void Task_Network(void *pvParameters);
+void IRAM_ATTR encoderISR();
+bool postCommand(CommandType type, CommandSource source, int32_t a = 0, int32_t b = 0, int32_t c = 0, uint32_t createdUs = 0);
+bool applyCommand(const DeviceCommand& cmd);
+void refreshStatusSnapshot();
+StatusSnapshot readStatusSnapshot();
+void recordLatency(CommandSource source, uint32_t us);
+void printLatencyReport();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 void reconnectMQTT();
-void publishStatusMQTT(bool forcePublish = false);
+bool publishStatusMQTT(bool fullRefresh = false);
+void markChangedStatusFields();
+void renderStatusField(int field, const StatusSnapshot& st, char* out);
+void printMqttStatsReport();
+void handleMqttStats();
+int readTrackFromDFPlayer();
 void setupWebServer();
-void handleRotaryEncoder();
+bool applyEncoderValue(int value);
+bool applyEncoderClick();
+bool applyDFAction(int action);
+bool toggleDFMute();
 void updateLeds();
 void handleRoot();
 void handleStatus();
+void handleLatency();
 void handleToggleLed();
 void handleSetBrightness();
 void handleSetLedRGB();
@@ -129,7 +264,7 @@ void handleDFCommand(const char* cmd);
 void handleDFMuteToggle();
 void handleIrActionFromWeb(); // Web'den IR simülasyonu için yeni handler.
 void handleNotFound();
-void processIRCode(uint32_t irCode); // Alınan IR kodunu işler.
+bool processIRCode(uint32_t irCode); // Alınan IR kodunu işler.
 uint32_t getHexForIrAction(String actionName); // IR aksiyon ismine karşılık gelen HEX kodu döndürür.
 
 
@@ -139,10 +274,15 @@ void setup() {
     Serial.begin(115200); // Seri iletişimi başlat (hata ayıklama için).
     Serial.println("\n\n--- ESP32 Advanced Control Panel (IR Sim + MQTT) ---");
 
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(DeviceCommand)); // Görevler arası komut kuyruğu.
+    dfMutex = xSemaphoreCreateMutex(); // DFPlayer seri portu için kilit.
+
     setupHardware();    // Donanım bileşenlerini (LED, Encoder, DFPlayer, IR) başlat.
+    refreshStatusSnapshot(); // İlk durum kopyasını oluştur.
     setupWiFi();        // Wi-Fi bağlantısını kur.
     setupMQTT();        // MQTT istemcisini ayarla ve bağlanmayı dene.
     setupWebServer();   // Web sunucusunu başlat ve endpoint'leri tanımla.
+    setupTasks();       // Girdi, durum, DFPlayer ve ağ görevlerini başlat.
 
     Serial.println("Setup Complete. IP Address:");
     Serial.println(WiFi.localIP()); // ESP32'nin aldığı IP adresini yazdır.
@@ -152,58 +292,290 @@ void setup() {
 }
 
 // --- BÖLÜM 5: loop() FONKSİYONU ---
-// setup() bittikten sonra bu fonksiyon sürekli olarak tekrarlanır.
+// Tüm işler FreeRTOS görevlerinde yapılır (bkz. BÖLÜM 5b), Arduino loop görevine gerek yok.
 void loop() {
-    // Wi-Fi ve MQTT bağlantı yönetimi
-    if (WiFi.status() == WL_CONNECTED) { // Eğer Wi-Fi'ye bağlıysa
-        if (!mqttClient.connected()) {   // Eğer MQTT'ye bağlı değilse
-            reconnectMQTT();             // Yeniden bağlanmayı dene.
+    vTaskDelete(NULL);
+}
+
+// --- BÖLÜM 5b: FreeRTOS GÖREVLERİ ---
+// Görev yerleşimi:
+//   Çekirdek 1: Task_Input (5) > Task_Actor (4) > Task_DFPlayer (3)
+//   Çekirdek 0: Task_Network (1) - Wi-Fi yığınıyla aynı çekirdekte, yavaş bir HTTP istemcisi
+//               veya MQTT yeniden bağlanması girdi işlemeyi geciktiremez.
+void setupTasks() {
+    xTaskCreatePinnedToCore(Task_Actor, "Actor_Task", 6000, NULL, TASK_PRIO_ACTOR, &Task_Actor_Handle, 1);
+    xTaskCreatePinnedToCore(Task_Input, "Input_Task", 4000, NULL, TASK_PRIO_INPUT, &Task_Input_Handle, 1);
+    xTaskCreatePinnedToCore(Task_DFPlayer, "DFPlayer_Task", 3000, NULL, TASK_PRIO_DFPLAYER, &Task_DFPlayer_Handle, 1);
+    xTaskCreatePinnedToCore(Task_Network, "Network_Task", 10000, NULL, TASK_PRIO_NETWORK, &Task_Network_Handle, 0);
+    Serial.println("Tasks created (Input/Actor/DFPlayer on Core 1, Network on Core 0).");
+}
+
+// Encoder pinlerindeki her kenarda çalışır: kütüphanenin sayacını günceller ve Task_Input'u uyandırır.
+void IRAM_ATTR encoderISR() {
+    rotaryEncoder.readEncoder_ISR();
+    if (encoderIsrPendingUs == 0) encoderIsrPendingUs = micros();
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    if (Task_Input_Handle != NULL) vTaskNotifyGiveFromISR(Task_Input_Handle, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+// Bir komutu Task_Actor kuyruğuna ekler. Kuyruk doluysa beklemez, komutu sayarak atar.
+bool postCommand(CommandType type, CommandSource source, int32_t a, int32_t b, int32_t c, uint32_t createdUs) {
+    DeviceCommand cmd;
+    cmd.type = type;
+    cmd.source = source;
+    cmd.a = a; cmd.b = b; cmd.c = c;
+    cmd.createdUs = createdUs ? createdUs : micros();
+    if (xQueueSend(commandQueue, &cmd, 0) != pdTRUE) {
+        droppedCommands++;
+        Serial.printf("!!! Command queue full, dropped %s command !!!\n", commandSourceNames[source]);
+        return false;
+    }
+    return true;
+}
+
+// GİRDİ GÖREVİ: Encoder kesmesiyle uyanır, IR alıcıyı ve encoder butonunu INPUT_POLL_MS aralığıyla kontrol eder.
+// IR kütüphanesi sinyali kendi zamanlayıcı kesmesinde toplar; burada sadece çözülmüş kodu kuyruğa atarız.
+void Task_Input(void *pvParameters) {
+    Serial.println("[Input Task] Started on Core 1.");
+    unsigned long lastClickMs = 0;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(INPUT_POLL_MS));
+
+        if (rotaryEncoder.encoderChanged()) {
+            uint32_t t = encoderIsrPendingUs;
+            encoderIsrPendingUs = 0;
+            postCommand(CMD_ENCODER_VALUE, SRC_ENCODER, rotaryEncoder.readEncoder(), encoderModeEpoch, 0, t);
+        }
+
+        if (rotaryEncoder.isEncoderButtonClicked() && millis() - lastClickMs > ENCODER_CLICK_LOCKOUT_MS) {
+            lastClickMs = millis();
+            postCommand(CMD_ENCODER_CLICK, SRC_ENCODER);
+        }
+
+        if (IrReceiver.decode()) { // Eğer bir IR kodu çözüldüyse
+            uint32_t t = micros();
+            uint32_t code = IrReceiver.decodedIRData.decodedRawData; // Farklı IR protokolleri için .command veya .address de kullanılabilir.
+            IrReceiver.resume(); // Bir sonraki IR sinyalini almak için alıcıyı tekrar aktif et.
+            if (code != 0 && code != 0xFFFFFFFF) postCommand(CMD_IR_CODE, SRC_IR, (int32_t)code, 0, 0, t);
         }
-        mqttClient.loop(); // MQTT istemcisinin arka plan işlemlerini (mesaj alma, keep-alive) yapmasını sağla.
     }
+}
 
-    server.handleClient(); // Gelen HTTP isteklerini işle.
-    handleRotaryEncoder(); // Rotary encoder'dan gelen girdileri işle.
+// DURUM (ACTOR) GÖREVİ: Paylaşılan durumu değiştiren tek görev. Komutları sırayla uygular,
+// gecikmeyi kaydeder ve durum değiştiyse Task_Network'e yayın yapması gerektiğini bildirir.
+void Task_Actor(void *pvParameters) {
+    Serial.println("[Actor Task] Started on Core 1.");
+    DeviceCommand cmd;
+    for (;;) {
+        if (xQueueReceive(commandQueue, &cmd, portMAX_DELAY) != pdTRUE) continue;
+
+        xSemaphoreTake(dfMutex, portMAX_DELAY);
+        bool changed = applyCommand(cmd);
+        xSemaphoreGive(dfMutex);
+
+        recordLatency(cmd.source, micros() - cmd.createdUs);
+        if (changed) {
+            refreshStatusSnapshot();
+            statusPublishPending = true;
+        }
+    }
+}
 
-    // IR alıcıdan veri gelip gelmediğini kontrol et.
-    if (IrReceiver.decode()) { // Eğer bir IR kodu çözüldüyse
-        processIRCode(IrReceiver.decodedIRData.decodedRawData); // Çözülen ham veriyi işle.
-                                                                // Farklı IR protokolleri için .command veya .address de kullanılabilir.
-        IrReceiver.resume(); // Bir sonraki IR sinyalini almak için alıcıyı tekrar aktif et.
+// DFPLAYER GÖREVİ: DFPlayer'dan gelen olayları (parça bitti, kart takıldı/çıkarıldı, hata) okur.
+// Seri porta veri geldiğinde onReceive ile uyandırılır; ayrıca 50ms'de bir kontrol eder.
+void Task_DFPlayer(void *pvParameters) {
+    Serial.println("[DFPlayer Task] Started on Core 1.");
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+        if (!dfPlayerAvailable) continue;
+
+        xSemaphoreTake(dfMutex, portMAX_DELAY);
+        bool hasEvent = myDFPlayer.available();
+        uint8_t type = 0; int value = 0;
+        if (hasEvent) {
+            type = myDFPlayer.readType(); // Gelen mesajın türünü oku.
+            value = myDFPlayer.read();    // Gelen mesajın değerini oku.
+        }
+        xSemaphoreGive(dfMutex);
+
+        if (hasEvent) postCommand(CMD_DF_EVENT, SRC_DFPLAYER, type, value);
     }
+}
+
+// AĞ GÖREVİ (ÇEKİRDEK 0): MQTT bağlantısı, MQTT mesajları, HTTP istekleri ve periyodik durum yayını.
+// Buradaki bloklayan işlemler (yavaş istemci, broker'a bağlanma) girdi görevlerini etkilemez.
+void Task_Network(void *pvParameters) {
+    Serial.println("[Network Task] Started on Core 0.");
+    unsigned long lastLatencyReport = 0;
+    unsigned long lastMqttStatsReport = millis();
+    unsigned long lastStatusSample = 0;
+    for (;;) {
+        // Wi-Fi ve MQTT bağlantı yönetimi
+        if (WiFi.status() == WL_CONNECTED) { // Eğer Wi-Fi'ye bağlıysa
+            if (!mqttClient.connected()) {   // Eğer MQTT'ye bağlı değilse
+                reconnectMQTT();             // Yeniden bağlanmayı dene.
+            }
+            mqttClient.loop(); // MQTT istemcisinin arka plan işlemlerini (mesaj alma, keep-alive) yapmasını sağla.
+        }
 
-    // DFPlayer olaylarını işle (örn: parça bitti, hata oluştu).
-    bool dfStatusChanged = false; // DFPlayer durumunda değişiklik olup olmadığını izle.
-    if (dfPlayerAvailable && myDFPlayer.available()) { // DFPlayer kullanılabilir ve seri portta veri varsa
-        uint8_t type = myDFPlayer.readType(); // Gelen mesajın türünü oku.
-        int value = myDFPlayer.read();        // Gelen mesajın değerini oku.
-        switch (type) {
-            case DFPlayerPlayFinished: // Bir parça bittiğinde
-                Serial.print("Track Finished: "); Serial.println(value);
-                if (currentTrackNumber != 0) dfStatusChanged = true; // Eğer bir parça çalıyorduysa durumu güncelle.
-                currentTrackNumber = 0; // Mevcut parça numarasını sıfırla (durdu).
-                break;
-            case DFPlayerError: // Bir hata oluştuğunda
-                Serial.print("DFPlayer Error, Code: "); Serial.println(value); // Hata kodunu yazdır.
-                dfStatusChanged = true;
-                break;
-            case DFPlayerCardOnline: // SD kart takıldığında
-                 if (!sdCardOnline) dfStatusChanged = true; // Eğer daha önce offline idiyse durumu güncelle.
-                sdCardOnline = true;
-                break;
-            case DFPlayerCardRemoved: // SD kart çıkarıldığında
-                if (sdCardOnline) dfStatusChanged = true; // Eğer daha önce online idiyse durumu güncelle.
-                sdCardOnline = false;
-                break;
+        server.handleClient(); // Gelen HTTP isteklerini işle.
+
+        // MQTT durum yayınlama: önce hangi alanların değiştiğini bul, sonra birleştirme penceresi dolunca yayınla.
+        if (statusPublishPending || millis() - lastStatusSample > MQTT_INPUT_SAMPLE_MS) {
+            statusPublishPending = false;
+            lastStatusSample = millis();
+            markChangedStatusFields();
+        }
+        if (millis() - lastMqttFullRefreshTime > MQTT_FULL_REFRESH_MS) { // Broker senkronu için yavaş tam yenileme.
+            publishStatusMQTT(true);
+        } else if (statusDirtyMask != 0 && millis() - statusFirstDirtyMs >= MQTT_COALESCE_MS) {
+            publishStatusMQTT(); // Yayın yapılamazsa dirty bitleri kalır, bir sonraki turda tekrar denenir.
         }
+
+        if (millis() - lastLatencyReport > 30000) { // 30 saniyede bir gecikme raporu.
+            lastLatencyReport = millis();
+            printLatencyReport();
+        }
+        if (millis() - lastMqttStatsReport > 60000) { // Dakikada bir MQTT yayın raporu.
+            lastMqttStatsReport = millis();
+            printMqttStatsReport();
+        }
+
+        vTaskDelay(2 / portTICK_PERIOD_MS);
     }
+}
+
+// Task_Actor tarafından, durum her değiştiğinde çağrılır.
+void refreshStatusSnapshot() {
+    StatusSnapshot s;
+    s.encoderMode = currentEncoderMode;
+    s.irDpadMode = irDpadMode;
+    s.sdCardOnline = sdCardOnline;
+    s.ledsOn = ledsOn;
+    s.brightness = globalBrightness;
+    s.ledR = currentLedR; s.ledG = currentLedG; s.ledB = currentLedB;
+    s.dfMuted = dfPlayerMuted;
+    s.dfVolume = currentDFPlayerVolume;
+    s.trackNumber = currentTrackNumber;
+    portENTER_CRITICAL(&stateMux);
+    statusSnapshot = s;
+    portEXIT_CRITICAL(&stateMux);
+}
 
-    // MQTT durum yayınlama
-    if (millis() - lastMqttPublishTime > mqttPublishInterval) { // Belirli aralıklarla
-        publishStatusMQTT(true); // Durumu MQTT'ye zorla yayınla.
-    } else if (dfStatusChanged) { // Veya DFPlayer durumunda bir değişiklik olduysa
-        publishStatusMQTT();      // Durumu MQTT'ye yayınla.
+// Diğer görevler durumu bu tutarlı kopya üzerinden okur.
+StatusSnapshot readStatusSnapshot() {
+    portENTER_CRITICAL(&stateMux);
+    StatusSnapshot s = statusSnapshot;
+    portEXIT_CRITICAL(&stateMux);
+    return s;
+}
+
+void recordLatency(CommandSource source, uint32_t us) {
+    portENTER_CRITICAL(&stateMux);
+    LatencyRing& ring = latencyRings[source];
+    ring.us[ring.head] = us;
+    ring.head = (ring.head + 1) % LATENCY_SAMPLES;
+    if (ring.count < LATENCY_SAMPLES) ring.count++;
+    portEXIT_CRITICAL(&stateMux);
+}
+
+// Bir kaynağın son örneklerinden yüzdelikleri hesaplar. Örnek yoksa false döner.
+bool getLatencyPercentiles(CommandSource source, uint16_t& n, uint32_t& p50, uint32_t& p90, uint32_t& p99, uint32_t& maxUs) {
+    uint32_t samples[LATENCY_SAMPLES];
+    portENTER_CRITICAL(&stateMux);
+    n = latencyRings[source].count;
+    memcpy(samples, latencyRings[source].us, n * sizeof(uint32_t)); // Ring dolana kadar örnekler baştan dizilir.
+    portEXIT_CRITICAL(&stateMux);
+    if (n == 0) return false;
+    std::sort(samples, samples + n);
+    p50 = samples[(n - 1) * 50 / 100];
+    p90 = samples[(n - 1) * 90 / 100];
+    p99 = samples[(n - 1) * 99 / 100];
+    maxUs = samples[n - 1];
+    return true;
+}
+
+void printLatencyReport() {
+    Serial.println("--- Input->Action Latency (us) ---");
+    for (int i = 0; i < SRC_COUNT; i++) {
+        uint16_t n; uint32_t p50, p90, p99, maxUs;
+        if (!getLatencyPercentiles((CommandSource)i, n, p50, p90, p99, maxUs)) continue;
+        Serial.printf("%-9s n=%3u p50=%6lu p90=%6lu p99=%6lu max=%6lu\n", commandSourceNames[i], n,
+                      (unsigned long)p50, (unsigned long)p90, (unsigned long)p99, (unsigned long)maxUs);
+    }
+    Serial.printf("Dropped commands: %lu, queue free: %u\n", (unsigned long)droppedCommands, (unsigned)uxQueueSpacesAvailable(commandQueue));
+}
+
+// Task_Actor içinde çağrılır (dfMutex alınmış durumda). Durum değiştiyse true döner.
+bool applyCommand(const DeviceCommand& cmd) {
+    switch (cmd.type) {
+        case CMD_ENCODER_VALUE:
+            if ((uint32_t)cmd.b != encoderModeEpoch) return false; // Mod değişmeden önce okunmuş değer, yok say.
+            return applyEncoderValue(cmd.a);
+        case CMD_ENCODER_CLICK:
+            return applyEncoderClick();
+        case CMD_IR_CODE:
+            return processIRCode((uint32_t)cmd.a);
+        case CMD_LED_SET_STATE:
+            ledsOn = (cmd.a != 0);
+            updateLeds();
+            return true;
+        case CMD_LED_TOGGLE:
+            ledsOn = !ledsOn;
+            updateLeds();
+            return true;
+        case CMD_SET_BRIGHTNESS:
+            globalBrightness = constrain(cmd.a, 0, 255);
+            updateLeds();
+            return true;
+        case CMD_SET_RGB:
+            currentLedR = cmd.a; currentLedG = cmd.b; currentLedB = cmd.c;
+            // Renk ayarlandıysa ve LED'ler kapalıysa otomatik aç.
+            if (!ledsOn && (currentLedR > 0 || currentLedG > 0 || currentLedB > 0)) ledsOn = true;
+            updateLeds();
+            return true;
+        case CMD_DF_SET_VOLUME:
+            if (!dfPlayerAvailable) return false;
+            currentDFPlayerVolume = constrain(cmd.a, 0, 30);
+            myDFPlayer.volume(currentDFPlayerVolume);
+            dfPlayerMuted = (currentDFPlayerVolume == 0); // Ses 0 ise sessize alınmış say.
+            // Sessize almadan önceki sesi güncelle (eğer yeni ses 0 değilse).
+            if (currentDFPlayerVolume > 0) previousDFPlayerVolume = currentDFPlayerVolume;
+            return true;
+        case CMD_DF_PLAY_TRACK:
+            if (!dfPlayerAvailable || cmd.a < 1 || cmd.a > totalTracks) return false;
+            myDFPlayer.play(cmd.a);
+            currentTrackNumber = cmd.a;
+            dfPlayerMuted = false; // Müzik çalmaya başlayınca sessizden çık.
+            return true;
+        case CMD_DF_ACTION:
+            return applyDFAction(cmd.a);
+        case CMD_DF_EVENT: {
+            bool dfStatusChanged = false; // DFPlayer durumunda değişiklik olup olmadığını izle.
+            switch (cmd.a) {
+                case DFPlayerPlayFinished: // Bir parça bittiğinde
+                    Serial.print("Track Finished: "); Serial.println(cmd.b);
+                    if (currentTrackNumber != 0) dfStatusChanged = true; // Eğer bir parça çalıyorduysa durumu güncelle.
+                    currentTrackNumber = 0; // Mevcut parça numarasını sıfırla (durdu).
+                    break;
+                case DFPlayerError: // Bir hata oluştuğunda
+                    Serial.print("DFPlayer Error, Code: "); Serial.println(cmd.b); // Hata kodunu yazdır.
+                    dfStatusChanged = true;
+                    break;
+                case DFPlayerCardOnline: // SD kart takıldığında
+                    if (!sdCardOnline) dfStatusChanged = true; // Eğer daha önce offline idiyse durumu güncelle.
+                    sdCardOnline = true;
+                    break;
+                case DFPlayerCardRemoved: // SD kart çıkarıldığında
+                    if (sdCardOnline) dfStatusChanged = true; // Eğer daha önce online idiyse durumu güncelle.
+                    sdCardOnline = false;
+                    break;
+            }
+            return dfStatusChanged;
+        }
     }
+    return false;
 }
 
 // --- BÖLÜM 6: setupHardware() FONKSİYONU ---
@@ -221,8 +593,8 @@ void setupHardware() {
 
     // Rotary Encoder Başlatma
     rotaryEncoder.begin(); // Encoder kütüphanesini başlat.
-    // Encoder pinlerindeki değişiklikleri dinlemek için kesme (interrupt) ayarını yap. Lambda fonksiyonu kullanılır.
-    rotaryEncoder.setup([] { rotaryEncoder.readEncoder_ISR(); });
+    // Encoder pinlerindeki değişiklikleri dinlemek için kesme (interrupt) ayarını yap. ISR ayrıca Task_Input'u uyandırır.
+    rotaryEncoder.setup(encoderISR);
     rotaryEncoder.setBoundaries(0, 255, false); // Başlangıç modu (parlaklık) için sınırları ayarla (0-255, döngü yok).
     rotaryEncoder.setEncoderValue(globalBrightness); // Encoder'ın başlangıç değerini parlaklığa ayarla.
     Serial.println("Rotary Encoder Initialized. CLK:" + String(ROTARY_ENCODER_A_PIN) + " DT:" + String(ROTARY_ENCODER_B_PIN) + " SW:" + String(ROTARY_ENCODER_BUTTON_PIN) + ". Mode: " + encoderModes[currentEncoderMode]);
@@ -233,6 +605,8 @@ void setupHardware() {
 
     // DFPlayer Mini Başlatma
     myDFPlayerSerial.begin(9600, SERIAL_8N1, DFPLAYER_RX_PIN, DFPLAYER_TX_PIN); // DFPlayer için seri portu başlat.
+    // Seri porta veri geldiğinde DFPlayer görevini uyandır (olayları beklemeden işlemek için).
+    myDFPlayerSerial.onReceive([]() { if (Task_DFPlayer_Handle != NULL) xTaskNotifyGive(Task_DFPlayer_Handle); });
     Serial.println("DFPlayer Serial Port Initialized.");
     // DFPlayer modülünü başlatmayı dene.
     if (!myDFPlayer.begin(myDFPlayerSerial, false, false)) { // `false, false` feedback ve ACK'yi devre dışı bırakır (isteğe bağlı).
@@ -252,7 +626,6 @@ void setupHardware() {
                                                          // ENABLE_LED_FEEDBACK, IR sinyali alındığında ESP32'nin dahili LED'ini yakıp söndürebilir (kütüphane versiyonuna bağlı).
     Serial.println("IR Receiver Initialized. Pin: " + String(IR_RECEIVE_PIN));
 }
-
 // --- BÖLÜM 7: setupWiFi() FONKSİYONU ---
 // ESP32'yi belirtilen Wi-Fi ağına bağlar.
 void setupWiFi() {
@@ -283,6 +656,7 @@ void setupMQTT() {
     }
     mqttClient.setServer(mqtt_server, mqtt_port); // MQTT broker adresini ve portunu ayarla.
     mqttClient.setCallback(mqttCallback);         // Gelen MQTT mesajlarını işleyecek fonksiyonu ayarla.
+    if (!mqttClient.setBufferSize(MQTT_BUFFER_SIZE)) Serial.println("MQTT: setBufferSize failed, keeping default buffer.");
     Serial.println("MQTT Setup Done. Attempting to connect...");
     reconnectMQTT(); // İlk bağlantıyı kurmayı dene.
 }
@@ -310,8 +684,10 @@ uint32_t getHexForIrAction(String actionName) {
 }
 
 // --- BÖLÜM 10: mqttCallback() FONKSİYONU ---
-// Abone olunan MQTT konularına mesaj geldiğinde bu fonksiyon çağrılır.
+// Abone olunan MQTT konularına mesaj geldiğinde bu fonksiyon çağrılır (Task_Network içinde).
+// Durumu doğrudan değiştirmez; mesajı bir komuta çevirip Task_Actor kuyruğuna atar.
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    uint32_t receivedUs = micros(); // Gecikme ölçümü mesajın geldiği andan başlar.
     Serial.print("MQTT Message arrived ["); Serial.print(topic); Serial.print("] ");
     char msg[length + 1]; // Gelen mesajı saklamak için bir karakter dizisi.
     for (unsigned int i = 0; i < length; i++) { msg[i] = (char)payload[i]; }
@@ -319,57 +695,41 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
     Serial.println(msg);
 
     String topicStr = String(topic); // Konuyu String nesnesine çevir.
-    bool publishUpdate = true;       // Durum güncellemesi yayınlanmalı mı?
 
-    // Gelen konuya göre ilgili işlemi yap:
+    // Gelen konuya göre ilgili komutu kuyruğa at:
     if (topicStr == "esp32/command/led/state") {
-        if (strcmp(msg, "ON") == 0) ledsOn = true; else if (strcmp(msg, "OFF") == 0) ledsOn = false;
-        updateLeds();
+        if (strcmp(msg, "ON") == 0) postCommand(CMD_LED_SET_STATE, SRC_MQTT, 1, 0, 0, receivedUs);
+        else if (strcmp(msg, "OFF") == 0) postCommand(CMD_LED_SET_STATE, SRC_MQTT, 0, 0, 0, receivedUs);
     } else if (topicStr == "esp32/command/led/brightness") {
-        globalBrightness = atoi(msg); // Gelen string mesajı integer'a çevir.
-        updateLeds();
+        postCommand(CMD_SET_BRIGHTNESS, SRC_MQTT, atoi(msg), 0, 0, receivedUs); // Gelen string mesajı integer'a çevir.
     } else if (topicStr == "esp32/command/led/colorRGB") {
         int r, g, b;
         // Mesajı "R,G,B" formatında ayrıştır.
         if (sscanf(msg, "%d,%d,%d", &r, &g, &b) == 3) { // Eğer 3 değer başarıyla okunursa
-            currentLedR = r; currentLedG = g; currentLedB = b;
-            // Eğer renk ayarlandıysa ve LED'ler kapalıysa, otomatik aç.
-            if (!ledsOn && (currentLedR > 0 || currentLedG > 0 || currentLedB > 0) ) ledsOn = true;
-            updateLeds();
-        } else { Serial.println("MQTT: Failed to parse RGB color string."); publishUpdate = false;}
+            postCommand(CMD_SET_RGB, SRC_MQTT, r, g, b, receivedUs);
+        } else { Serial.println("MQTT: Failed to parse RGB color string."); }
     } else if (topicStr == "esp32/command/dfplayer/volume") {
-        if (dfPlayerAvailable) { currentDFPlayerVolume = atoi(msg); myDFPlayer.volume(currentDFPlayerVolume); dfPlayerMuted = false; } 
-        else { publishUpdate = false; }
+        postCommand(CMD_DF_SET_VOLUME, SRC_MQTT, atoi(msg), 0, 0, receivedUs);
     } else if (topicStr == "esp32/command/dfplayer/playTrack") {
-        if (dfPlayerAvailable) {
-            int track = atoi(msg);
-            if (track >= 1 && track <= totalTracks) { myDFPlayer.play(track); currentTrackNumber = track; dfPlayerMuted = false; } 
-            else { publishUpdate = false; }
-        } else { publishUpdate = false; }
+        postCommand(CMD_DF_PLAY_TRACK, SRC_MQTT, atoi(msg), 0, 0, receivedUs);
     } else if (topicStr == "esp32/command/dfplayer/action") {
-        if (dfPlayerAvailable) {
-            if (strcmp(msg, "PLAY_CURRENT") == 0) { // Mevcut (veya ilk) parçayı çal/devam et.
-                if (currentTrackNumber <= 0 || currentTrackNumber > totalTracks) {myDFPlayer.play(1); currentTrackNumber = 1;} else myDFPlayer.start();
-                dfPlayerMuted = false;
-            } else if (strcmp(msg, "PAUSE") == 0) { myDFPlayer.pause(); Serial.println("MQTT: DFPlayer Paused");}
-            else if (strcmp(msg, "NEXT") == 0) { myDFPlayer.next(); currentTrackNumber = 0; dfPlayerMuted = false; Serial.println("MQTT: DFPlayer Next");} // `currentTrackNumber = 0` bir sonraki IR/manuel işlemde durumu doğru alması için.
-            else if (strcmp(msg, "PREV") == 0) { myDFPlayer.previous(); currentTrackNumber = 0; dfPlayerMuted = false; Serial.println("MQTT: DFPlayer Previous");}
-            else if (strcmp(msg, "MUTE_TOGGLE") == 0) { // MQTT için sessize alma/açma.
-                if (dfPlayerMuted) { myDFPlayer.volume(previousDFPlayerVolume); currentDFPlayerVolume = previousDFPlayerVolume; dfPlayerMuted = false; } 
-                else { previousDFPlayerVolume = myDFPlayer.readVolume(); if(previousDFPlayerVolume == -1 || previousDFPlayerVolume == 0) previousDFPlayerVolume = 20; myDFPlayer.volume(0); currentDFPlayerVolume = 0; dfPlayerMuted = true; }
-            } else { Serial.print("MQTT: Unknown DFPlayer action: "); Serial.println(msg); publishUpdate = false; }
-        } else { publishUpdate = false; }
+        int action = -1;
+        if (strcmp(msg, "PLAY_CURRENT") == 0) action = DF_PLAY_CURRENT; // Mevcut (veya ilk) parçayı çal/devam et.
+        else if (strcmp(msg, "PAUSE") == 0) action = DF_PAUSE;
+        else if (strcmp(msg, "NEXT") == 0) action = DF_NEXT;
+        else if (strcmp(msg, "PREV") == 0) action = DF_PREV;
+        else if (strcmp(msg, "MUTE_TOGGLE") == 0) action = DF_MUTE_TOGGLE; // MQTT için sessize alma/açma.
+        if (action >= 0) postCommand(CMD_DF_ACTION, SRC_MQTT, action, 0, 0, receivedUs);
+        else { Serial.print("MQTT: Unknown DFPlayer action: "); Serial.println(msg); }
     } else if (topicStr == "esp32/command/ir_action") { // MQTT üzerinden IR komutu simülasyonu.
         String cmdName = String(msg);
         uint32_t hexCode = getHexForIrAction(cmdName); // Aksiyon ismine karşılık gelen HEX kodu al.
         if (hexCode != 0) { // Eğer geçerli bir aksiyon ismiyse
             Serial.print("MQTT: Simulating IR command: "); Serial.println(cmdName);
-            processIRCode(hexCode); // IR kodunu işle.
-        } else { Serial.print("MQTT: Unknown IR Sim action: "); Serial.println(cmdName); publishUpdate = false;}
-    } else { // Bilinmeyen bir konuysa
-        publishUpdate = false;
+            postCommand(CMD_IR_CODE, SRC_MQTT, (int32_t)hexCode, 0, 0, receivedUs); // IR kodunu işle.
+        } else { Serial.print("MQTT: Unknown IR Sim action: "); Serial.println(cmdName); }
     }
-    if (publishUpdate) publishStatusMQTT(); // Eğer işlem başarılıysa ve durum değiştiyse MQTT'ye güncelleme yayınla.
+    // Durum değiştiyse yayın, komut uygulandıktan sonra Task_Actor'ın işaretiyle Task_Network tarafından yapılır.
 }
 
 // --- BÖLÜM 11: reconnectMQTT() FONKSİYONU ---
@@ -408,54 +768,140 @@ void reconnectMQTT() {
 
 // --- BÖLÜM 12: publishStatusMQTT() FONKSİYONU ---
 // Cihazın mevcut durumunu (LED, DFPlayer, sensörler vb.) MQTT konularına yayınlar.
-// `forcePublish`: true ise, kısa süre önce yayın yapılmış olsa bile tekrar yayınlar.
-void publishStatusMQTT(bool forcePublish = false) {
-    static unsigned long lastForcedPublish = 0; // Son zorla yayın zamanı.
-                                                // Bu, durum değişikliklerinin çok sık yayınlanmasını engellemek için.
-    if (forcePublish) { 
-        lastForcedPublish = millis(); 
-    } else { 
-        // Eğer zorla yayın değilse ve son zorla yayından bu yana çok kısa süre geçtiyse (500ms) yayınlama.
-        if (millis() - lastForcedPublish < 500) return; 
+// Sadece dirty biti set olan alanlar yayınlanır. `fullRefresh`: true ise tüm alanlar yeniden yayınlanır
+// (bağlantı kurulunca ve MQTT_FULL_REFRESH_MS aralığıyla, broker'daki retained değerleri tazelemek için).
+// Task_Network içinde çalışır; DFPlayer'a seri port üzerinden sorgu yapmaz, Task_Actor'ın kopyasını kullanır.
+
+// Tahmini MQTT PUBLISH (QoS 0) paket boyutu: sabit başlık + kalan uzunluk + konu uzunluğu + konu + veri.
+uint32_t mqttPacketSize(size_t topicLen, size_t payloadLen) {
+    uint32_t remaining = 2 + topicLen + payloadLen;
+    return 1 + (remaining < 128 ? 1 : 2) + remaining;
+}
+
+// PubSubClient::publish() paket tampona sığmazsa sessizce false döner. Bu durumda tekrar denemek
+// işe yaramaz: sayılır, loglanır ve çağıran alanı yayınlanmış gibi işaretler (değer değişince
+// ya da tam yenilemede tekrar denenir). Kütüphane her pakete MQTT_MAX_HEADER_SIZE ayırır.
+bool mqttFitsBuffer(const char* topic, size_t payloadLen) {
+    size_t topicLen = strlen(topic);
+    if (MQTT_MAX_HEADER_SIZE + 2 + topicLen + payloadLen <= mqttClient.getBufferSize()) return true;
+    mqttStats.oversize++; mqttStatsWindow.oversize++;
+    Serial.printf("MQTT: %s not published, %lu byte packet > %u byte buffer.\n", topic,
+                  (unsigned long)mqttPacketSize(topicLen, payloadLen), mqttClient.getBufferSize());
+    return false;
+}
+
+// Bir alanın yayınlanacak değerini string olarak üretir.
+void renderStatusField(int field, const StatusSnapshot& st, char* out) {
+    switch (field) {
+        case SF_WIFI_SSID:      snprintf(out, STATUS_VALUE_LEN, "%s", WiFi.SSID().c_str()); break;
+        case SF_ENCODER_MODE:   snprintf(out, STATUS_VALUE_LEN, "%s", encoderModes[st.encoderMode]); break;
+        case SF_ENCODER_BUTTON: snprintf(out, STATUS_VALUE_LEN, "%s", (digitalRead(ROTARY_ENCODER_BUTTON_PIN) == LOW) ? "PRESSED" : "NOT_PRESSED"); break;
+        case SF_BUTTON_D12:     snprintf(out, STATUS_VALUE_LEN, "%s", (digitalRead(EXTERNAL_BUTTON_D12_PIN) == LOW) ? "PRESSED" : "NOT_PRESSED"); break;
+        case SF_IR_DPAD_MODE:   snprintf(out, STATUS_VALUE_LEN, "%s", irDpadModes[st.irDpadMode]); break;
+        case SF_SD_CARD:        snprintf(out, STATUS_VALUE_LEN, "%s", st.sdCardOnline ? "ONLINE" : "OFFLINE"); break;
+        case SF_LEDS_ON:        snprintf(out, STATUS_VALUE_LEN, "%s", st.ledsOn ? "ON" : "OFF"); break;
+        case SF_BRIGHTNESS:     snprintf(out, STATUS_VALUE_LEN, "%d", st.brightness); break;
+        case SF_COLOR_RGB:      snprintf(out, STATUS_VALUE_LEN, "%d,%d,%d", st.ledR, st.ledG, st.ledB); break;
+        case SF_DF_MUTED:       snprintf(out, STATUS_VALUE_LEN, "%s", st.dfMuted ? "MUTED" : "UNMUTED"); break;
+        case SF_DF_VOLUME:      snprintf(out, STATUS_VALUE_LEN, "%d", dfPlayerAvailable ? st.dfVolume : -1); break;
+        case SF_DF_TRACK_NUMBER: snprintf(out, STATUS_VALUE_LEN, "%d", dfPlayerAvailable ? st.trackNumber : -1); break;
+        case SF_DF_TRACK_NAME: {
+            int track = dfPlayerAvailable ? st.trackNumber : 0;
+            snprintf(out, STATUS_VALUE_LEN, "%s", (track > 0 && track <= totalTracks) ? trackNames[track] : trackNames[0]); // "Unknown/Stopped"
+            break;
+        }
+        default: out[0] = '\0'; break;
     }
+}
+
+// Mevcut değerleri en son yayınlananlarla karşılaştırır ve değişen alanların dirty bitini set eder.
+void markChangedStatusFields() {
+    StatusSnapshot st = readStatusSnapshot();
+    char value[STATUS_VALUE_LEN];
+    for (int f = 0; f < SF_COUNT; f++) {
+        renderStatusField(f, st, value);
+        if (strcmp(value, statusPublished[f]) != 0) {
+            if (statusDirtyMask == 0) statusFirstDirtyMs = millis(); // Birleştirme penceresi ilk değişiklikle başlar.
+            statusDirtyMask |= (1UL << f);
+        }
+    }
+}
 
-    if (!mqttClient.connected() || WiFi.status() != WL_CONNECTED) return; // Bağlantı yoksa yayınlama.
+bool publishStatusMQTT(bool fullRefresh) {
+    if (!mqttClient.connected() || WiFi.status() != WL_CONNECTED) return false; // Bağlantı yoksa yayınlama.
 
-    char buffer[64]; // Sayısal değerleri string'e çevirmek için geçici tampon.
+    if (fullRefresh) {
+        statusDirtyMask = STATUS_ALL_FIELDS;
+        lastMqttFullRefreshTime = millis();
+        mqttStats.fullRefreshes++; mqttStatsWindow.fullRefreshes++;
+    }
+    if (statusDirtyMask == 0) return true;
+
+    StatusSnapshot st = readStatusSnapshot(); // Task_Actor'ın son durum kopyası.
+    char value[STATUS_VALUE_LEN];
+    uint32_t publishedMask = 0;
+    uint32_t oversizeMask = 0; // Tampona sığmadı; tekrar denenmez.
 
-    // Tüm durum bilgilerini ilgili MQTT konularına `true` (retained) olarak yayınla.
     // Retained mesajlar, yeni abone olan istemcilerin son durumu hemen almasını sağlar.
-    mqttClient.publish("esp32/status/wifiSSID", WiFi.SSID().c_str(), true);
-    mqttClient.publish("esp32/status/encoderMode", encoderModes[currentEncoderMode], true);
-    mqttClient.publish("esp32/status/encoderButton", (digitalRead(ROTARY_ENCODER_BUTTON_PIN) == LOW) ? "PRESSED" : "NOT_PRESSED", true);
-    mqttClient.publish("esp32/status/buttonD12", (digitalRead(EXTERNAL_BUTTON_D12_PIN) == LOW) ? "PRESSED" : "NOT_PRESSED", true);
-    mqttClient.publish("esp32/status/irDpadMode", irDpadModes[irDpadMode], true);
-    mqttClient.publish("esp32/status/sdCard", sdCardOnline ? "ONLINE" : "OFFLINE", true);
-    mqttClient.publish("esp32/status/ledsOn", ledsOn ? "ON" : "OFF", true);
-    sprintf(buffer, "%d", globalBrightness); mqttClient.publish("esp32/status/brightness", buffer, true);
-    sprintf(buffer, "%d,%d,%d", currentLedR, currentLedG, currentLedB); mqttClient.publish("esp32/status/led/colorRGB", buffer, true);
-    mqttClient.publish("esp32/status/dfplayer/muted", dfPlayerMuted ? "MUTED" : "UNMUTED", true);
-    
-    if (dfPlayerAvailable) {
-        int vol = myDFPlayer.readVolume(); // Mevcut ses seviyesini oku.
-        sprintf(buffer, "%d", vol); mqttClient.publish("esp32/status/dfVolume", buffer, true);
-        
-        int track = myDFPlayer.readCurrentFileNumber(); // Mevcut parça numarasını oku.
-                                                       // Not: Bu fonksiyon bazen çalınan parçayı değil, son komutla seçilen dosyayı döndürebilir.
-                                                       // Daha güvenilir parça takibi için DFPlayer olayları (örn: PlayFinished) kullanılabilir.
-        sprintf(buffer, "%d", track); mqttClient.publish("esp32/status/dfTrackNumber", buffer, true);
-        
-        if (track > 0 && track <= totalTracks) { mqttClient.publish("esp32/status/dfTrackName", trackNames[track], true); } 
-        else { mqttClient.publish("esp32/status/dfTrackName", trackNames[0], true); } // "Unknown/Stopped"
-    } else { // DFPlayer kullanılamıyorsa varsayılan/hata değerleri yayınla.
-        mqttClient.publish("esp32/status/dfVolume", "-1", true); 
-        mqttClient.publish("esp32/status/dfTrackNumber", "-1", true); 
-        mqttClient.publish("esp32/status/dfTrackName", trackNames[0], true);
+    if (MQTT_PUBLISH_PACKED_JSON) {
+        // Tek konu: tüm alanlar tek bir JSON mesajında (değişen alan sayısından bağımsız olarak tek yayın).
+        jsonDocMqtt.clear();
+        for (int f = 0; f < SF_COUNT; f++) {
+            renderStatusField(f, st, value);
+            jsonDocMqtt[statusJsonKeys[f]] = value;
+        }
+        char payload[512];
+        size_t len = serializeJson(jsonDocMqtt, payload, sizeof(payload));
+        if (!mqttFitsBuffer(mqtt_topic_status_json, len)) {
+            oversizeMask = STATUS_ALL_FIELDS;
+        } else if (mqttClient.publish(mqtt_topic_status_json, payload, true)) {
+            publishedMask = STATUS_ALL_FIELDS;
+            mqttStats.publishes++; mqttStatsWindow.publishes++;
+            uint32_t bytes = mqttPacketSize(strlen(mqtt_topic_status_json), len);
+            mqttStats.bytes += bytes; mqttStatsWindow.bytes += bytes;
+        }
+    } else {
+        for (int f = 0; f < SF_COUNT; f++) {
+            if (!(statusDirtyMask & (1UL << f))) continue;
+            renderStatusField(f, st, value);
+            if (!mqttFitsBuffer(statusTopics[f], strlen(value))) { oversizeMask |= (1UL << f); continue; }
+            if (!mqttClient.publish(statusTopics[f], value, true)) continue; // Başarısız alan dirty kalır.
+            publishedMask |= (1UL << f);
+            mqttStats.publishes++; mqttStatsWindow.publishes++;
+            uint32_t bytes = mqttPacketSize(strlen(statusTopics[f]), strlen(value));
+            mqttStats.bytes += bytes; mqttStatsWindow.bytes += bytes;
+        }
     }
-    Serial.println("MQTT Status Published.");
-    lastMqttPublishTime = millis(); // Son yayın zamanını güncelle.
+
+    // Yayınlanan (ve tampona sığmayan) değerleri kaydet ve bitlerini temizle.
+    for (int f = 0; f < SF_COUNT; f++) {
+        if (!((publishedMask | oversizeMask) & (1UL << f))) continue;
+        renderStatusField(f, st, value);
+        strncpy(statusPublished[f], value, STATUS_VALUE_LEN);
+    }
+    statusDirtyMask &= ~(publishedMask | oversizeMask);
+    if (statusDirtyMask != 0) statusFirstDirtyMs = millis(); // Kalanlar bir sonraki pencerede tekrar denenir.
+    Serial.printf("MQTT Status Published (%s, %d fields).\n", fullRefresh ? "full" : "changed", __builtin_popcount(publishedMask));
+    return statusDirtyMask == 0;
 }
 
+// Dakikalık MQTT yayın raporu. Karşılaştırma için eski yöntemin (5 saniyede bir tüm konular) aynı
+// değerlerle dakikada ne kadar yayın/bayt üreteceğini de hesaplar.
+void printMqttStatsReport() {
+    StatusSnapshot st = readStatusSnapshot();
+    char value[STATUS_VALUE_LEN];
+    uint32_t legacyBytesPerPass = 0;
+    for (int f = 0; f < SF_COUNT; f++) {
+        renderStatusField(f, st, value);
+        legacyBytesPerPass += mqttPacketSize(strlen(statusTopics[f]), strlen(value));
+    }
+    const uint32_t legacyPassesPerMin = 60000 / 5000;
+    Serial.printf("--- MQTT Status: %lu publishes/min, %lu bytes/min (%lu full refreshes, %lu oversize) | legacy 5 s publish: %lu publishes/min, %lu bytes/min ---\n",
+                  (unsigned long)mqttStatsWindow.publishes, (unsigned long)mqttStatsWindow.bytes, (unsigned long)mqttStatsWindow.fullRefreshes,
+                  (unsigned long)mqttStatsWindow.oversize,
+                  (unsigned long)(SF_COUNT * legacyPassesPerMin), (unsigned long)(legacyBytesPerPass * legacyPassesPerMin));
+    memset(&mqttStatsWindow, 0, sizeof(mqttStatsWindow));
+}
 
 // --- BÖLÜM 13: setupWebServer() FONKSİYONU ---
 // Web sunucusunu başlatır ve HTTP isteklerini işleyecek endpoint'leri (URL yolları) tanımlar.
@@ -482,6 +928,10 @@ void setupWebServer() {
 
     // IR Simülasyonu için endpoint
     server.on("/ir_action", HTTP_GET, handleIrActionFromWeb); // Web'den IR komutu göndermek için.
+
+    // Girdi->aksiyon gecikme raporu (JSON). "/latency?reset=1" örnekleri sıfırlar.
+    server.on("/latency", HTTP_GET, handleLatency);
+    server.on("/mqtt_stats", HTTP_GET, handleMqttStats); // MQTT yayın sayısı ve bayt istatistikleri.
     
     server.onNotFound(handleNotFound); // Tanımlanmayan bir URL isteği gelirse handleNotFound'u çağır.
     
@@ -501,103 +951,134 @@ void updateLeds() {
     strip.show(); // Değişiklikleri LED şeridine gönder.
 }
 
-// --- BÖLÜM 15: handleRotaryEncoder() FONKSİYONU ---
-// Rotary encoder'dan gelen döndürme ve buton basma olaylarını işler.
-void handleRotaryEncoder() {
-    bool stateChanged = false; // Encoder durumunda değişiklik oldu mu?
-
-    // Encoder döndürüldüyse
-    if (rotaryEncoder.encoderChanged()) {
-        int value = rotaryEncoder.readEncoder(); // Encoder'ın yeni değerini oku.
-        stateChanged = true;
-        switch (currentEncoderMode) { // Mevcut encoder moduna göre işlem yap.
-            case 0: // LED Parlaklık Modu
-                globalBrightness = value; // Okunan değeri global parlaklığa ata.
-                updateLeds(); // LED'leri güncelle.
-                break;
-            case 1: // LED Renk Seçim Modu
-                currentPredefinedColorIndex = value; // Okunan değeri renk indeksine ata.
-                // Seçilen indeksteki ön tanımlı rengi al ve RGB bileşenlerine ayır.
-                uint32_t newColor = predefinedColors[currentPredefinedColorIndex];
-                currentLedR = (newColor >> 16) & 0xFF; // Kırmızı bileşeni
-                currentLedG = (newColor >> 8) & 0xFF;  // Yeşil bileşeni
-                currentLedB = newColor & 0xFF;         // Mavi bileşeni
-                updateLeds(); // LED'leri güncelle.
-                break;
-            case 2: // DFPlayer Ses Seviyesi Modu
-                currentDFPlayerVolume = value; // Okunan değeri ses seviyesine ata.
-                if (dfPlayerAvailable && !dfPlayerMuted) { // DFPlayer varsa ve sessizde değilse
-                    myDFPlayer.volume(currentDFPlayerVolume); // Ses seviyesini ayarla.
-                }
-                break;
+// --- BÖLÜM 15: ENCODER KOMUTLARI ---
+// Task_Input'un gönderdiği encoder olaylarını Task_Actor içinde uygular. Durum değiştiyse true döner.
+bool applyEncoderValue(int value) {
+    switch (currentEncoderMode) { // Mevcut encoder moduna göre işlem yap.
+        case 0: // LED Parlaklık Modu
+            globalBrightness = value; // Okunan değeri global parlaklığa ata.
+            updateLeds(); // LED'leri güncelle.
+            break;
+        case 1: { // LED Renk Seçim Modu
+            currentPredefinedColorIndex = value; // Okunan değeri renk indeksine ata.
+            // Seçilen indeksteki ön tanımlı rengi al ve RGB bileşenlerine ayır.
+            uint32_t newColor = predefinedColors[currentPredefinedColorIndex];
+            currentLedR = (newColor >> 16) & 0xFF; // Kırmızı bileşeni
+            currentLedG = (newColor >> 8) & 0xFF;  // Yeşil bileşeni
+            currentLedB = newColor & 0xFF;         // Mavi bileşeni
+            updateLeds(); // LED'leri güncelle.
+            break;
         }
+        case 2: // DFPlayer Ses Seviyesi Modu
+            currentDFPlayerVolume = value; // Okunan değeri ses seviyesine ata.
+            if (dfPlayerAvailable && !dfPlayerMuted) { // DFPlayer varsa ve sessizde değilse
+                myDFPlayer.volume(currentDFPlayerVolume); // Ses seviyesini ayarla.
+            }
+            break;
     }
+    return true;
+}
 
-    // Encoder butonuna basıldıysa
-    if (rotaryEncoder.isEncoderButtonClicked()) {
-        currentEncoderMode = (currentEncoderMode + 1) % 3; // Modu bir sonrakine geçir (3 mod arasında döngü).
-        stateChanged = true;
-        Serial.print("Encoder Mode Changed to: "); Serial.println(encoderModes[currentEncoderMode]);
-
-        // Yeni moda göre encoder'ın sınırlarını ve başlangıç değerini ayarla.
-        switch (currentEncoderMode) {
-            case 0: // LED Parlaklık
-                rotaryEncoder.setBoundaries(0, 255, false); // Sınırlar 0-255, döngü yok.
-                rotaryEncoder.setEncoderValue(globalBrightness); // Mevcut parlaklığı ayarla.
-                break;
-            case 1: // LED Renk Seçimi
-                rotaryEncoder.setBoundaries(0, num_predefined_colors - 1, true); // Sınırlar renk sayısı kadar, döngü var.
-                rotaryEncoder.setEncoderValue(currentPredefinedColorIndex); // Mevcut renk indeksini ayarla.
-                break;
-            case 2: // DFPlayer Ses Seviyesi
-                rotaryEncoder.setBoundaries(0, 30, false); // Sınırlar 0-30 (DFPlayer ses aralığı), döngü yok.
-                int volToSet = currentDFPlayerVolume;
-                if(dfPlayerAvailable && !dfPlayerMuted) { // Eğer DFPlayer aktif ve sessizde değilse
-                    int volRead = myDFPlayer.readVolume(); // Mevcut sesi oku (emin olmak için).
-                    volToSet = (volRead == -1 ? currentDFPlayerVolume : volRead); // Okuma başarısızsa eski değeri kullan.
-                } else if (dfPlayerMuted) { // Sessizdeyse encoder'ı 0'a ayarla.
-                    volToSet = 0;
-                } else { // DFPlayer yoksa varsayılan bir değere ayarla.
-                    volToSet = 20;
-                }
-                rotaryEncoder.setEncoderValue(volToSet);
-                break;
+bool applyEncoderClick() {
+    currentEncoderMode = (currentEncoderMode + 1) % 3; // Modu bir sonrakine geçir (3 mod arasında döngü).
+    encoderModeEpoch++; // Kuyrukta bekleyen eski moda ait değerler artık geçersiz.
+    Serial.print("Encoder Mode Changed to: "); Serial.println(encoderModes[currentEncoderMode]);
+
+    // Yeni moda göre encoder'ın sınırlarını ve başlangıç değerini ayarla.
+    switch (currentEncoderMode) {
+        case 0: // LED Parlaklık
+            rotaryEncoder.setBoundaries(0, 255, false); // Sınırlar 0-255, döngü yok.
+            rotaryEncoder.setEncoderValue(globalBrightness); // Mevcut parlaklığı ayarla.
+            break;
+        case 1: // LED Renk Seçimi
+            rotaryEncoder.setBoundaries(0, num_predefined_colors - 1, true); // Sınırlar renk sayısı kadar, döngü var.
+            rotaryEncoder.setEncoderValue(currentPredefinedColorIndex); // Mevcut renk indeksini ayarla.
+            break;
+        case 2: { // DFPlayer Ses Seviyesi
+            rotaryEncoder.setBoundaries(0, 30, false); // Sınırlar 0-30 (DFPlayer ses aralığı), döngü yok.
+            int volToSet = currentDFPlayerVolume;
+            if(dfPlayerAvailable && !dfPlayerMuted) { // Eğer DFPlayer aktif ve sessizde değilse
+                int volRead = myDFPlayer.readVolume(); // Mevcut sesi oku (emin olmak için).
+                volToSet = (volRead == -1 ? currentDFPlayerVolume : volRead); // Okuma başarısızsa eski değeri kullan.
+            } else if (dfPlayerMuted) { // Sessizdeyse encoder'ı 0'a ayarla.
+                volToSet = 0;
+            } else { // DFPlayer yoksa varsayılan bir değere ayarla.
+                volToSet = 20;
+            }
+            rotaryEncoder.setEncoderValue(volToSet);
+            break;
         }
-        delay(100); // Buton "bounce" etkisini (titreşimle çoklu basım algılama) önlemek için kısa bekleme.
     }
+    return true;
+}
 
-    // Eğer encoder durumu değiştiyse ve MQTT bağlıysa, durumu yayınla.
-    if (stateChanged && mqttClient.connected()) {
-        publishStatusMQTT();
+// DFPlayer aksiyonlarını (web, MQTT) Task_Actor içinde uygular. Durum değiştiyse true döner.
+bool applyDFAction(int action) {
+    if (!dfPlayerAvailable) return false;
+    switch (action) {
+        case DF_PLAY_CURRENT: // Mevcut (veya ilk) parçayı çal/devam et.
+            if (currentTrackNumber <= 0 || currentTrackNumber > totalTracks) { myDFPlayer.play(1); currentTrackNumber = 1; }
+            else { myDFPlayer.start(); }
+            dfPlayerMuted = false;
+            return true;
+        case DF_PAUSE:
+            myDFPlayer.pause(); Serial.println("DFPlayer Paused");
+            return true;
+        case DF_NEXT:
+            myDFPlayer.next(); currentTrackNumber = readTrackFromDFPlayer(); dfPlayerMuted = false; Serial.println("DFPlayer Next"); // Parça numarası sadece bu olayda bir kez sorgulanır.
+            return true;
+        case DF_PREV:
+            myDFPlayer.previous(); currentTrackNumber = readTrackFromDFPlayer(); dfPlayerMuted = false; Serial.println("DFPlayer Previous");
+            return true;
+        case DF_MUTE_TOGGLE:
+            return toggleDFMute();
     }
+    return false;
+}
+
+// next/previous sonrası çalan parçayı DFPlayer'dan bir kez okur (Task_Actor içinde, dfMutex alınmışken).
+// Parça numarası periyodik olarak sorgulanmaz; sadece bu olaylarda ve PlayFinished olayında güncellenir.
+int readTrackFromDFPlayer() {
+    int track = myDFPlayer.readCurrentFileNumber();
+    return (track > 0 && track <= totalTracks) ? track : 0;
+}
+
+// Sessize alma/açma (IR, web ve MQTT aynı davranışı kullanır).
+bool toggleDFMute() {
+    if (!dfPlayerAvailable) return false;
+    if (dfPlayerMuted) { // Eğer sessizdeyse, sesi aç.
+        // `previousDFPlayerVolume` 0 veya -1 (hata) değilse onu kullan, yoksa 15 gibi bir varsayılan kullan.
+        int volToSet = previousDFPlayerVolume > 0 ? previousDFPlayerVolume : 15;
+        myDFPlayer.volume(volToSet);
+        currentDFPlayerVolume = volToSet;
+        dfPlayerMuted = false;
+        Serial.println("DFPlayer Unmuted. Volume set to: " + String(currentDFPlayerVolume));
+    } else { // Eğer ses açıksa, sessize al.
+        previousDFPlayerVolume = myDFPlayer.readVolume(); // Mevcut sesi kaydet.
+        // Eğer okunan ses -1 (hata) veya 0 ise, ve mevcut ses 0 değilse onu kullan, yoksa varsayılan bir değere ayarla.
+        if (previousDFPlayerVolume == -1 || previousDFPlayerVolume == 0) previousDFPlayerVolume = currentDFPlayerVolume > 0 ? currentDFPlayerVolume : 15;
+        myDFPlayer.volume(0); // Sesi sıfırla.
+        currentDFPlayerVolume = 0;
+        dfPlayerMuted = true;
+        Serial.println("DFPlayer Muted. Previous volume was: " + String(previousDFPlayerVolume));
+    }
+    return true;
 }
 
 // --- BÖLÜM 16: processIRCode() FONKSİYONU ---
 // Alınan ham IR kodunu işler ve ilgili eylemi gerçekleştirir.
 // Bu IR kodları (örn: 0xED127F80) spesifik bir IR kumandasına (genellikle NEC protokolü) aittir.
 // Kendi kumandanızın kodlarını buraya girmeniz gerekir.
-void processIRCode(uint32_t irCode) {
-    if (irCode == 0 || irCode == 0xFFFFFFFF) return; // Geçersiz veya tekrar eden kodları yoksay.
+// Task_Actor içinde çalışır (IR alıcı, web ve MQTT simülasyonu). Durum değiştiyse true döner.
+bool processIRCode(uint32_t irCode) {
+    if (irCode == 0 || irCode == 0xFFFFFFFF) return false; // Geçersiz veya tekrar eden kodları yoksay.
     Serial.printf("IR Code Received: 0x%X\n", irCode); // Alınan kodu Seri Monitör'e yazdır.
     bool stateChanged = true; // Durumda değişiklik oldu mu? (MQTT yayınlamak için)
 
     switch (irCode) {
         case 0xED127F80: // Örnek: MUTE tuşu
             Serial.println("IR: Mute Toggle"); 
-            if (dfPlayerAvailable) { 
-                if (dfPlayerMuted) { // Eğer sessizdeyse, sesi aç.
-                    myDFPlayer.volume(previousDFPlayerVolume); 
-                    currentDFPlayerVolume = previousDFPlayerVolume; 
-                    dfPlayerMuted = false; 
-                } else { // Eğer ses açıksa, sessize al.
-                    previousDFPlayerVolume = myDFPlayer.readVolume(); 
-                    // Eğer okunan ses -1 (hata) veya 0 ise, ve mevcut ses 0 değilse onu kullan, yoksa varsayılan bir değere ayarla.
-                    if(previousDFPlayerVolume == -1 || previousDFPlayerVolume == 0) previousDFPlayerVolume = currentDFPlayerVolume > 0 ? currentDFPlayerVolume : 15; 
-                    myDFPlayer.volume(0); 
-                    currentDFPlayerVolume = 0; 
-                    dfPlayerMuted = true; 
-                } 
-            } 
+            toggleDFMute();
             break;
         case 0xE11E7F80: // Örnek: POWER tuşu (LED Toggle olarak kullanılıyor)
             Serial.println("IR: LED Toggle"); 
@@ -651,7 +1132,7 @@ void processIRCode(uint32_t irCode) {
             Serial.println("IR: Next Track"); 
             if (dfPlayerAvailable) { 
                 myDFPlayer.next(); 
-                currentTrackNumber = 0; // Bir sonraki parçanın numarasını DFPlayer'dan okumak gerekebilir. Şimdilik sıfırla.
+                currentTrackNumber = readTrackFromDFPlayer(); // Parça numarasını sadece bu olayda bir kez sorgula.
                 dfPlayerMuted = false; 
             } 
             break;
@@ -661,7 +1142,7 @@ void processIRCode(uint32_t irCode) {
             Serial.println("IR: Previous Track"); 
             if (dfPlayerAvailable) { 
                 myDFPlayer.previous(); 
-                currentTrackNumber = 0; 
+                currentTrackNumber = readTrackFromDFPlayer(); // Parça numarasını sadece bu olayda bir kez sorgula.
                 dfPlayerMuted = false; 
             } 
             break;
@@ -708,7 +1189,7 @@ void processIRCode(uint32_t irCode) {
             } else { // DFPlayer Kontrol Modu: Önceki parça
                 if (dfPlayerAvailable) { 
                     myDFPlayer.previous(); 
-                    currentTrackNumber = 0; 
+                    currentTrackNumber = readTrackFromDFPlayer(); // Parça numarasını sadece bu olayda bir kez sorgula.
                     dfPlayerMuted = false;
                 } 
             } 
@@ -724,7 +1205,7 @@ void processIRCode(uint32_t irCode) {
             } else { // DFPlayer Kontrol Modu: Sonraki parça
                 if (dfPlayerAvailable) { 
                     myDFPlayer.next(); 
-                    currentTrackNumber = 0; 
+                    currentTrackNumber = readTrackFromDFPlayer(); // Parça numarasını sadece bu olayda bir kez sorgula.
                     dfPlayerMuted = false;
                 } 
             } 
@@ -735,10 +1216,8 @@ void processIRCode(uint32_t irCode) {
             break;
     }
 
-    // Eğer IR komutu bir durum değişikliğine yol açtıysa ve MQTT bağlıysa, durumu yayınla.
-    if (stateChanged && mqttClient.connected()) { 
-        publishStatusMQTT(); 
-    }
+    // Eğer IR komutu bir durum değişikliğine yol açtıysa Task_Actor durumu yayınlanmak üzere işaretler.
+    return stateChanged;
 }
 
 
@@ -752,27 +1231,27 @@ void handleRoot() {
 
 // Cihazın mevcut durumunu JSON formatında döndürür.
 void handleStatus() {
+    StatusSnapshot st = readStatusSnapshot(); // Task_Actor'ın son durum kopyası.
     jsonDocHttp.clear(); // Önceki JSON verilerini temizle.
     // Durum bilgilerini JSON nesnesine ekle.
     jsonDocHttp["wifiSSID"] = (WiFi.status() == WL_CONNECTED) ? WiFi.SSID() : "Not Connected";
     jsonDocHttp["mqttConnected"] = mqttClient.connected();
-    jsonDocHttp["encoderMode"] = encoderModes[currentEncoderMode];
+    jsonDocHttp["encoderMode"] = encoderModes[st.encoderMode];
     jsonDocHttp["encoderButtonPressed"] = (digitalRead(ROTARY_ENCODER_BUTTON_PIN) == LOW); // Buton basılıysa true.
     jsonDocHttp["externalButtonD12Pressed"] = (digitalRead(EXTERNAL_BUTTON_D12_PIN) == LOW);
-    jsonDocHttp["irDpadMode"] = irDpadModes[irDpadMode];
-    jsonDocHttp["sdCardOnline"] = sdCardOnline;
-    jsonDocHttp["ledsOn"] = ledsOn;
-    jsonDocHttp["brightness"] = globalBrightness;
-    jsonDocHttp["ledR"] = currentLedR;
-    jsonDocHttp["ledG"] = currentLedG;
-    jsonDocHttp["ledB"] = currentLedB;
-    jsonDocHttp["dfPlayerMuted"] = dfPlayerMuted;
-
-    if(dfPlayerAvailable) { // DFPlayer varsa bilgilerini ekle.
-        jsonDocHttp["dfVolume"] = myDFPlayer.readVolume(); 
-        int track = myDFPlayer.readCurrentFileNumber(); // Güvenilirlik için `currentTrackNumber` da kullanılabilir.
-        jsonDocHttp["dfTrack"] = track > 0 ? track : currentTrackNumber; // Eğer okunan 0 ise ve currentTrackNumber >0 ise onu kullan.
-        int trackNumForName = track > 0 ? track : currentTrackNumber;
+    jsonDocHttp["irDpadMode"] = irDpadModes[st.irDpadMode];
+    jsonDocHttp["sdCardOnline"] = st.sdCardOnline;
+    jsonDocHttp["ledsOn"] = st.ledsOn;
+    jsonDocHttp["brightness"] = st.brightness;
+    jsonDocHttp["ledR"] = st.ledR;
+    jsonDocHttp["ledG"] = st.ledG;
+    jsonDocHttp["ledB"] = st.ledB;
+    jsonDocHttp["dfPlayerMuted"] = st.dfMuted;
+
+    if(dfPlayerAvailable) { // DFPlayer varsa bilgilerini ekle (olaylarla güncellenen değerler, seri port sorgusu yok).
+        jsonDocHttp["dfVolume"] = st.dfVolume; 
+        int trackNumForName = st.trackNumber;
+        jsonDocHttp["dfTrack"] = trackNumForName;
         if (trackNumForName > 0 && trackNumForName <= totalTracks) { jsonDocHttp["dfTrackName"] = trackNames[trackNumForName]; } 
         else { jsonDocHttp["dfTrackName"] = trackNames[0]; } // "Unknown/Stopped"
     } else { // DFPlayer yoksa varsayılan/hata değerleri ekle.
@@ -785,106 +1264,102 @@ void handleStatus() {
     server.send(200, "application/json", response); // JSON yanıtını gönder.
 }
 
+// Girdi->aksiyon gecikme yüzdeliklerini (mikrosaniye) kaynak başına JSON olarak döndürür.
+void handleLatency() {
+    if (server.hasArg("reset")) {
+        portENTER_CRITICAL(&stateMux);
+        memset(latencyRings, 0, sizeof(latencyRings));
+        portEXIT_CRITICAL(&stateMux);
+        droppedCommands = 0;
+    }
+    jsonDocHttp.clear();
+    for (int i = 0; i < SRC_COUNT; i++) {
+        uint16_t n; uint32_t p50, p90, p99, maxUs;
+        if (!getLatencyPercentiles((CommandSource)i, n, p50, p90, p99, maxUs)) continue;
+        JsonObject src = jsonDocHttp.createNestedObject(commandSourceNames[i]);
+        src["n"] = n;
+        src["p50_us"] = p50;
+        src["p90_us"] = p90;
+        src["p99_us"] = p99;
+        src["max_us"] = maxUs;
+    }
+    jsonDocHttp["droppedCommands"] = droppedCommands;
+    String response;
+    serializeJson(jsonDocHttp, response);
+    server.send(200, "application/json", response);
+}
+
+// MQTT yayın istatistiklerini JSON olarak döndürür.
+void handleMqttStats() {
+    jsonDocHttp.clear();
+    jsonDocHttp["publishes"] = mqttStats.publishes;
+    jsonDocHttp["bytes"] = mqttStats.bytes;
+    jsonDocHttp["fullRefreshes"] = mqttStats.fullRefreshes;
+    jsonDocHttp["oversize"] = mqttStats.oversize;
+    jsonDocHttp["bufferSize"] = mqttClient.getBufferSize();
+    jsonDocHttp["uptimeMs"] = millis();
+    jsonDocHttp["packedJson"] = MQTT_PUBLISH_PACKED_JSON;
+    jsonDocHttp["coalesceMs"] = MQTT_COALESCE_MS;
+    String response;
+    serializeJson(jsonDocHttp, response);
+    server.send(200, "application/json", response);
+}
+
+// Web handler'ları durumu doğrudan değiştirmez: komutu Task_Actor kuyruğuna atar ve hemen yanıt verir.
+// MQTT yayını, komut uygulandıktan sonra Task_Network tarafından yapılır.
+
 // LED'leri açıp kapatır.
 void handleToggleLed() { 
-    ledsOn = !ledsOn; 
-    updateLeds(); 
+    postCommand(CMD_LED_TOGGLE, SRC_WEB);
     server.send(200, "text/plain", "OK"); 
-    publishStatusMQTT(); // Durumu MQTT'ye yayınla.
 }
 
 // LED parlaklığını ayarlar.
 void handleSetBrightness() { 
     if (server.hasArg("value")) { // Eğer "value" parametresi geldiyse
-        globalBrightness = server.arg("value").toInt(); // Değeri integer'a çevir ve ata.
-        updateLeds(); 
+        postCommand(CMD_SET_BRIGHTNESS, SRC_WEB, server.arg("value").toInt()); // Değeri integer'a çevir ve gönder.
     } 
     server.send(200, "text/plain", "OK"); 
-    publishStatusMQTT();
 }
 
 // LED rengini RGB olarak ayarlar.
 void handleSetLedRGB() { 
     if (server.hasArg("r") && server.hasArg("g") && server.hasArg("b")) { // r, g, b parametreleri geldiyse
-        currentLedR = server.arg("r").toInt(); 
-        currentLedG = server.arg("g").toInt(); 
-        currentLedB = server.arg("b").toInt(); 
-        // Renk ayarlandıysa ve LED'ler kapalıysa otomatik aç.
-        if (!ledsOn && (currentLedR > 0 || currentLedG > 0 || currentLedB > 0) ) { 
-            ledsOn = true; 
-        } 
-        updateLeds(); 
+        postCommand(CMD_SET_RGB, SRC_WEB, server.arg("r").toInt(), server.arg("g").toInt(), server.arg("b").toInt());
     } 
     server.send(200, "text/plain", "OK"); 
-    publishStatusMQTT();
 }
 
 // DFPlayer ses seviyesini ayarlar.
 void handleSetDFVolume() { 
     if (dfPlayerAvailable && server.hasArg("value")) { 
-        currentDFPlayerVolume = server.arg("value").toInt(); 
-        myDFPlayer.volume(currentDFPlayerVolume); 
-        dfPlayerMuted = (currentDFPlayerVolume == 0); // Ses 0 ise sessize alınmış say.
-        // Sessize almadan önceki sesi güncelle (eğer yeni ses 0 değilse).
-        if (currentDFPlayerVolume > 0) previousDFPlayerVolume = currentDFPlayerVolume;
+        postCommand(CMD_DF_SET_VOLUME, SRC_WEB, server.arg("value").toInt());
     } 
     server.send(200, "text/plain", "OK"); 
-    publishStatusMQTT();
 }
 
 // Belirli bir parçayı çalar.
 void handlePlayTrack() { 
     if (dfPlayerAvailable && server.hasArg("track")) { 
-        int trackNum = server.arg("track").toInt(); 
-        if (trackNum >= 1 && trackNum <= totalTracks) { // Geçerli parça numarası mı?
-            myDFPlayer.play(trackNum); 
-            currentTrackNumber = trackNum; 
-            dfPlayerMuted = false; // Müzik çalmaya başlayınca sessizden çık.
-        } 
+        postCommand(CMD_DF_PLAY_TRACK, SRC_WEB, server.arg("track").toInt()); // Geçerlilik Task_Actor'da kontrol edilir.
     } 
     server.send(200, "text/plain", "OK"); 
-    publishStatusMQTT();
 }
 
 // Genel DFPlayer komutlarını işler (play, pause, next, prev).
 void handleDFCommand(const char* cmd) { 
     if (!dfPlayerAvailable) { server.send(503, "text/plain", "DFPlayer Not Available"); return; } 
-    bool statusShouldChange = true; 
-    if (strcmp(cmd, "play_current") == 0) { 
-        if (currentTrackNumber <= 0 || currentTrackNumber > totalTracks) { myDFPlayer.play(1); currentTrackNumber = 1; } 
-        else { myDFPlayer.start(); } 
-        dfPlayerMuted = false; 
-    } else if (strcmp(cmd, "pause") == 0) myDFPlayer.pause(); 
-    else if (strcmp(cmd, "next") == 0) { myDFPlayer.next(); currentTrackNumber = 0; dfPlayerMuted = false; } 
-    else if (strcmp(cmd, "prev") == 0) { myDFPlayer.previous(); currentTrackNumber = 0; dfPlayerMuted = false; } 
-    else { statusShouldChange = false; } // Bilinmeyen komutsa durumu yayınlama.
+    if (strcmp(cmd, "play_current") == 0) postCommand(CMD_DF_ACTION, SRC_WEB, DF_PLAY_CURRENT);
+    else if (strcmp(cmd, "pause") == 0) postCommand(CMD_DF_ACTION, SRC_WEB, DF_PAUSE);
+    else if (strcmp(cmd, "next") == 0) postCommand(CMD_DF_ACTION, SRC_WEB, DF_NEXT);
+    else if (strcmp(cmd, "prev") == 0) postCommand(CMD_DF_ACTION, SRC_WEB, DF_PREV);
     server.send(200, "text/plain", "OK"); 
-    if(statusShouldChange) publishStatusMQTT(); 
 }
 
 // DFPlayer için web'den sessize alma/açma işlemini yönetir.
 void handleDFMuteToggle() {
-    if (dfPlayerAvailable) {
-        if (dfPlayerMuted) { // Eğer sessizdeyse, sesi aç.
-            // `previousDFPlayerVolume` 0 veya -1 (hata) değilse onu kullan, yoksa 15 gibi bir varsayılan kullan.
-            int volToSet = previousDFPlayerVolume > 0 ? previousDFPlayerVolume : 15;
-            myDFPlayer.volume(volToSet); 
-            currentDFPlayerVolume = volToSet;
-            dfPlayerMuted = false;
-            Serial.println("WEB: DFPlayer Unmuted. Volume set to: " + String(currentDFPlayerVolume));
-        } else { // Eğer ses açıksa, sessize al.
-            previousDFPlayerVolume = myDFPlayer.readVolume(); // Mevcut sesi kaydet.
-            // Eğer okunan ses -1 (hata) veya 0 ise, ve mevcut `currentDFPlayerVolume` 0 değilse onu `previous` olarak sakla,
-            // yoksa `previous` için 15 gibi bir varsayılan kullan.
-            if (previousDFPlayerVolume == -1 || previousDFPlayerVolume == 0) previousDFPlayerVolume = currentDFPlayerVolume > 0 ? currentDFPlayerVolume : 15;
-            myDFPlayer.volume(0); // Sesi sıfırla.
-            currentDFPlayerVolume = 0; 
-            dfPlayerMuted = true;
-            Serial.println("WEB: DFPlayer Muted. Previous volume was: " + String(previousDFPlayerVolume));
-        }
-    }
+    if (dfPlayerAvailable) postCommand(CMD_DF_ACTION, SRC_WEB, DF_MUTE_TOGGLE);
     server.send(200, "text/plain", "OK");
-    publishStatusMQTT(); // Durumu MQTT'ye yayınla.
 }
 
 // --- BÖLÜM 18: handleIrActionFromWeb() FONKSİYONU ---
@@ -895,14 +1370,12 @@ void handleIrActionFromWeb() {
         uint32_t hexCode = getHexForIrAction(cmdName); // Komut ismine karşılık gelen HEX IR kodunu al.
         if (hexCode != 0) { // Eğer geçerli bir komutsa
             Serial.print("WEB: Simulating IR command: "); Serial.println(cmdName);
-            processIRCode(hexCode); // IR kodunu işle (sanki IR alıcıdan gelmiş gibi).
+            postCommand(CMD_IR_CODE, SRC_WEB, (int32_t)hexCode); // IR kodunu işle (sanki IR alıcıdan gelmiş gibi).
         } else { // Bilinmeyen komutsa
             Serial.print("WEB: Unknown IR action: "); Serial.println(cmdName);
         }
     }
     server.send(200, "text/plain", "OK"); // Her durumda "OK" yanıtı gönder.
-    // publishStatusMQTT(); // processIRCode zaten durum değişikliğinde yayın yapıyor, burada tekrar gerekebilir veya gerekmeyebilir.
-                         // İsteğe bağlı olarak, her web IR simülasyonundan sonra durumu zorla yayınlamak için açılabilir.
 }
 
 // --- BÖLÜM 19: handleNotFound() FONKSİYONU ---
@@ -0,0 +1,335 @@
+/**
+ * @file matrix_renderer.h
+ * @brief Cached-glyph, dirty-region renderer for FC16 MAX72xx 8x8 chains.
+ *
+ * Replaces the MD_Parola "displayClear() + full redraw" path. Text is
+ * rasterized from a glyph cache into a column framebuffer, the framebuffer is
+ * diffed against what each module last received, and only rows that changed
+ * are clocked out over hardware SPI. Unchanged modules in a sent row receive a
+ * NO-OP so their registers are left alone. Scrolling is driven by a dedicated
+ * FreeRTOS task, so it keeps running while loop() is busy (MQTT reconnect etc).
+ *
+ * Every flush is measured (bytes on the wire and microseconds spent inside the
+ * SPI transaction) so updates can be compared to the 8 * 2 * N bytes that a
+ * full MD_MAX72XX redraw costs.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define MATRIX_RENDERER_MAX_DEVICES 8
+#define MATRIX_RENDERER_STRIP_COLS  512   // rendered width limit for scrolling text
+#define MATRIX_RENDERER_SPI_HZ      8000000
+
+// MAX7219 registers
+#define MAX7219_REG_NOOP        0x00
+#define MAX7219_REG_DIGIT0      0x01
+#define MAX7219_REG_DECODE      0x09
+#define MAX7219_REG_INTENSITY   0x0A
+#define MAX7219_REG_SCANLIMIT   0x0B
+#define MAX7219_REG_SHUTDOWN    0x0C
+#define MAX7219_REG_TEST        0x0F
+
+// Classic 5x7 font, ASCII 0x20..0x7E, one byte per column, bit 0 = top row.
+static const uint8_t MATRIX_FONT_5X7[] PROGMEM = {
+  0x00,0x00,0x00,0x00,0x00, 0x00,0x00,0x5F,0x00,0x00, 0x00,0x07,0x00,0x07,0x00, 0x14,0x7F,0x14,0x7F,0x14, // ' ' ! " #
+  0x24,0x2A,0x7F,0x2A,0x12, 0x23,0x13,0x08,0x64,0x62, 0x36,0x49,0x56,0x20,0x50, 0x00,0x05,0x03,0x00,0x00, // $ % & '
+  0x00,0x1C,0x22,0x41,0x00, 0x00,0x41,0x22,0x1C,0x00, 0x08,0x2A,0x1C,0x2A,0x08, 0x08,0x08,0x3E,0x08,0x08, // ( ) * +
+  0x00,0x50,0x30,0x00,0x00, 0x08,0x08,0x08,0x08,0x08, 0x00,0x60,0x60,0x00,0x00, 0x20,0x10,0x08,0x04,0x02, // , - . /
+  0x3E,0x51,0x49,0x45,0x3E, 0x00,0x42,0x7F,0x40,0x00, 0x42,0x61,0x51,0x49,0x46, 0x21,0x41,0x45,0x4B,0x31, // 0 1 2 3
+  0x18,0x14,0x12,0x7F,0x10, 0x27,0x45,0x45,0x45,0x39, 0x3C,0x4A,0x49,0x49,0x30, 0x01,0x71,0x09,0x05,0x03, // 4 5 6 7
+  0x36,0x49,0x49,0x49,0x36, 0x06,0x49,0x49,0x29,0x1E, 0x00,0x36,0x36,0x00,0x00, 0x00,0x56,0x36,0x00,0x00, // 8 9 : ;
+  0x08,0x14,0x22,0x41,0x00, 0x14,0x14,0x14,0x14,0x14, 0x00,0x41,0x22,0x14,0x08, 0x02,0x01,0x51,0x09,0x06, // < = > ?
+  0x32,0x49,0x79,0x41,0x3E, 0x7E,0x11,0x11,0x11,0x7E, 0x7F,0x49,0x49,0x49,0x36, 0x3E,0x41,0x41,0x41,0x22, // @ A B C
+  0x7F,0x41,0x41,0x22,0x1C, 0x7F,0x49,0x49,0x49,0x41, 0x7F,0x09,0x09,0x09,0x01, 0x3E,0x41,0x49,0x49,0x7A, // D E F G
+  0x7F,0x08,0x08,0x08,0x7F, 0x00,0x41,0x7F,0x41,0x00, 0x20,0x40,0x41,0x3F,0x01, 0x7F,0x08,0x14,0x22,0x41, // H I J K
+  0x7F,0x40,0x40,0x40,0x40, 0x7F,0x02,0x0C,0x02,0x7F, 0x7F,0x04,0x08,0x10,0x7F, 0x3E,0x41,0x41,0x41,0x3E, // L M N O
+  0x7F,0x09,0x09,0x09,0x06, 0x3E,0x41,0x51,0x21,0x5E, 0x7F,0x09,0x19,0x29,0x46, 0x46,0x49,0x49,0x49,0x31, // P Q R S
+  0x01,0x01,0x7F,0x01,0x01, 0x3F,0x40,0x40,0x40,0x3F, 0x1F,0x20,0x40,0x20,0x1F, 0x3F,0x40,0x38,0x40,0x3F, // T U V W
+  0x63,0x14,0x08,0x14,0x63, 0x07,0x08,0x70,0x08,0x07, 0x61,0x51,0x49,0x45,0x43, 0x00,0x7F,0x41,0x41,0x00, // X Y Z [
+  0x02,0x04,0x08,0x10,0x20, 0x00,0x41,0x41,0x7F,0x00, 0x04,0x02,0x01,0x02,0x04, 0x40,0x40,0x40,0x40,0x40, // \ ] ^ _
+  0x00,0x01,0x02,0x04,0x00, 0x20,0x54,0x54,0x54,0x78, 0x7F,0x48,0x44,0x44,0x38, 0x38,0x44,0x44,0x44,0x20, // ` a b c
+  0x38,0x44,0x44,0x48,0x7F, 0x38,0x54,0x54,0x54,0x18, 0x08,0x7E,0x09,0x01,0x02, 0x0C,0x52,0x52,0x52,0x3E, // d e f g
+  0x7F,0x08,0x04,0x04,0x78, 0x00,0x44,0x7D,0x40,0x00, 0x20,0x40,0x44,0x3D,0x00, 0x7F,0x10,0x28,0x44,0x00, // h i j k
+  0x00,0x41,0x7F,0x40,0x00, 0x7C,0x04,0x18,0x04,0x78, 0x7C,0x08,0x04,0x04,0x78, 0x38,0x44,0x44,0x44,0x38, // l m n o
+  0x7C,0x14,0x14,0x14,0x08, 0x08,0x14,0x14,0x18,0x7C, 0x7C,0x08,0x04,0x04,0x08, 0x48,0x54,0x54,0x54,0x20, // p q r s
+  0x04,0x3F,0x44,0x40,0x20, 0x3C,0x40,0x40,0x20,0x7C, 0x1C,0x20,0x40,0x20,0x1C, 0x3C,0x40,0x30,0x40,0x3C, // t u v w
+  0x44,0x28,0x10,0x28,0x44, 0x0C,0x50,0x50,0x50,0x3C, 0x44,0x64,0x54,0x4C,0x44, 0x00,0x08,0x36,0x41,0x00, // x y z {
+  0x00,0x00,0x7F,0x00,0x00, 0x00,0x41,0x36,0x08,0x00, 0x08,0x04,0x08,0x10,0x08                             // | } ~
+};
+#define MATRIX_FONT_FIRST   0x20
+#define MATRIX_FONT_COUNT   95
+#define MATRIX_FONT_WIDTH   5
+#define MATRIX_SPACE_WIDTH  2   // width of ' ' after trimming
+#define MATRIX_CHAR_SPACING 1
+
+struct MatrixStats {
+  uint32_t updates = 0;        // flushes that put at least one row on the wire
+  uint32_t skipped = 0;        // flushes where nothing had changed
+  uint32_t rowsSent = 0;
+  uint32_t bytesSent = 0;
+  uint32_t lastBytes = 0;       // last flush, 0 if it was skipped
+  uint32_t lastMicros = 0;
+  uint32_t maxMicros = 0;
+  uint64_t totalMicros = 0;
+};
+
+class MatrixRenderer {
+public:
+  MatrixRenderer(uint8_t dataPin, uint8_t clkPin, uint8_t csPin, uint8_t numDevices)
+    : _spi(HSPI), _dataPin(dataPin), _clkPin(clkPin), _csPin(csPin),
+      _numDevices(numDevices > MATRIX_RENDERER_MAX_DEVICES ? MATRIX_RENDERER_MAX_DEVICES : numDevices) {}
+
+  void begin(uint8_t intensity = 4) {
+    buildGlyphCache();
+    _mutex = xSemaphoreCreateMutex();
+    pinMode(_csPin, OUTPUT); digitalWrite(_csPin, HIGH);
+    _spi.begin(_clkPin, -1, _dataPin, -1);
+    sendAll(MAX7219_REG_TEST, 0);
+    sendAll(MAX7219_REG_DECODE, 0);
+    sendAll(MAX7219_REG_SCANLIMIT, 7);
+    sendAll(MAX7219_REG_INTENSITY, intensity & 0x0F);
+    memset(_fb, 0, sizeof(_fb));
+    invalidate();
+    flush();
+    sendAll(MAX7219_REG_SHUTDOWN, 1);
+    xTaskCreatePinnedToCore(animationTask, "Matrix_Task", 3000, this, 1, &_taskHandle, 0);
+  }
+
+  void setIntensity(uint8_t intensity) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    sendAll(MAX7219_REG_INTENSITY, intensity & 0x0F);
+    xSemaphoreGive(_mutex);
+  }
+
+  // Static text, centered. Text wider than the display scrolls instead.
+  void print(const char* text) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _stripWidth = rasterize(text, _strip, MATRIX_RENDERER_STRIP_COLS);
+    if (_stripWidth > displayWidth()) {
+      startScrollLocked(_defaultScrollMs, true);
+    } else {
+      _scrolling = false;
+      memset(_fb, 0, sizeof(_fb));
+      uint16_t left = (displayWidth() - _stripWidth) / 2;
+      memcpy(_fb + left, _strip, _stripWidth);
+      flush();
+    }
+    xSemaphoreGive(_mutex);
+  }
+
+  // Scroll text right-to-left, one column every msPerColumn, on the matrix task.
+  void scroll(const char* text, uint16_t msPerColumn, bool repeat = true) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _stripWidth = rasterize(text, _strip, MATRIX_RENDERER_STRIP_COLS);
+    startScrollLocked(msPerColumn, repeat);
+    xSemaphoreGive(_mutex);
+  }
+
+  bool isScrolling() const { return _scrolling; }
+  void setDefaultScrollSpeed(uint16_t msPerColumn) { _defaultScrollMs = msPerColumn; }
+
+  void clear() { print(""); }
+
+  // Forget what the modules hold so the next flush rewrites every row
+  // (e.g. after a brown-out or a glitch on the data line).
+  void invalidate() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    memset(_sent, 0, sizeof(_sent));
+    _sentValid = false;
+    xSemaphoreGive(_mutex);
+  }
+
+  // Copied under the mutex: the scroll task updates it on every frame.
+  MatrixStats getStats() const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    MatrixStats copy = _stats;
+    xSemaphoreGive(_mutex);
+    return copy;
+  }
+  uint32_t fullRedrawBytes() const { return 8UL * 2 * _numDevices; }
+
+  void printStats(Stream& out) const {
+    MatrixStats st = getStats();
+    uint32_t avgUs = st.updates ? (uint32_t)(st.totalMicros / st.updates) : 0;
+    uint32_t avgBytes = st.updates ? st.bytesSent / st.updates : 0;
+    out.printf("[MATRIX] updates=%lu skipped=%lu rows=%lu bytes=%lu avgBytes=%lu (full redraw=%lu) avgUs=%lu maxUs=%lu\n",
+               (unsigned long)st.updates, (unsigned long)st.skipped, (unsigned long)st.rowsSent,
+               (unsigned long)st.bytesSent, (unsigned long)avgBytes, (unsigned long)fullRedrawBytes(),
+               (unsigned long)avgUs, (unsigned long)st.maxMicros);
+  }
+
+private:
+  struct Glyph { uint16_t offset; uint8_t width; };
+
+  SPIClass _spi;
+  uint8_t _dataPin, _clkPin, _csPin, _numDevices;
+  SemaphoreHandle_t _mutex = NULL;
+  TaskHandle_t _taskHandle = NULL;
+
+  Glyph _glyphs[MATRIX_FONT_COUNT];
+  uint8_t _glyphCols[MATRIX_FONT_COUNT * MATRIX_FONT_WIDTH];
+
+  uint8_t _fb[MATRIX_RENDERER_MAX_DEVICES * 8];            // one byte per column, bit 0 = top row
+  uint8_t _sent[MATRIX_RENDERER_MAX_DEVICES][8];           // last row byte each module received
+  bool _sentValid = false;
+
+  uint8_t _strip[MATRIX_RENDERER_STRIP_COLS];
+  uint16_t _stripWidth = 0;
+  volatile bool _scrolling = false;
+  bool _scrollRepeat = true;
+  uint16_t _scrollMs = 50;
+  uint16_t _defaultScrollMs = 50;
+  int32_t _scrollPos = 0;
+  uint32_t _nextScrollAt = 0;
+
+  MatrixStats _stats;
+
+  uint16_t displayWidth() const { return (uint16_t)_numDevices * 8; }
+
+  // Copy the PROGMEM font into RAM once, trimming blank side columns so text
+  // is proportionally spaced and rasterizing never touches flash again.
+  void buildGlyphCache() {
+    uint16_t pos = 0;
+    for (uint8_t i = 0; i < MATRIX_FONT_COUNT; i++) {
+      const uint8_t* src = MATRIX_FONT_5X7 + i * MATRIX_FONT_WIDTH;
+      int8_t first = -1, last = -1;
+      for (uint8_t c = 0; c < MATRIX_FONT_WIDTH; c++) {
+        if (pgm_read_byte(src + c)) { if (first < 0) first = c; last = c; }
+      }
+      _glyphs[i].offset = pos;
+      if (first < 0) {
+        _glyphs[i].width = MATRIX_SPACE_WIDTH;
+        for (uint8_t c = 0; c < MATRIX_SPACE_WIDTH; c++) _glyphCols[pos++] = 0;
+      } else {
+        _glyphs[i].width = last - first + 1;
+        for (int8_t c = first; c <= last; c++) _glyphCols[pos++] = pgm_read_byte(src + c);
+      }
+    }
+  }
+
+  uint16_t rasterize(const char* text, uint8_t* out, uint16_t maxCols) {
+    uint16_t x = 0;
+    for (const char* p = text; *p; p++) {
+      uint8_t ch = (uint8_t)*p;
+      if (ch < MATRIX_FONT_FIRST || ch >= MATRIX_FONT_FIRST + MATRIX_FONT_COUNT) ch = '?';
+      const Glyph& g = _glyphs[ch - MATRIX_FONT_FIRST];
+      if (x > 0) { if (x >= maxCols) break; out[x++] = 0; }
+      for (uint8_t c = 0; c < g.width && x < maxCols; c++) out[x++] = _glyphCols[g.offset + c];
+    }
+    return x;
+  }
+
+  void startScrollLocked(uint16_t msPerColumn, bool repeat) {
+    _scrollMs = msPerColumn ? msPerColumn : 1;
+    _scrollRepeat = repeat;
+    _scrollPos = 0;
+    _nextScrollAt = millis();
+    _scrolling = true;
+    if (_taskHandle) xTaskNotifyGive(_taskHandle);
+  }
+
+  // Window of the strip entering from the right edge and leaving on the left.
+  void renderScrollFrame() {
+    int32_t w = displayWidth();
+    for (int32_t x = 0; x < w; x++) {
+      int32_t s = _scrollPos + x - w;
+      _fb[x] = (s >= 0 && s < _stripWidth) ? _strip[s] : 0;
+    }
+    flush();
+    _scrollPos++;
+    if (_scrollPos > (int32_t)_stripWidth + w) {
+      if (_scrollRepeat) _scrollPos = 0; else _scrolling = false;
+    }
+  }
+
+  static void animationTask(void* arg) {
+    MatrixRenderer* self = (MatrixRenderer*)arg;
+    for (;;) {
+      if (!self->_scrolling) { ulTaskNotifyTake(pdTRUE, portMAX_DELAY); continue; }
+      xSemaphoreTake(self->_mutex, portMAX_DELAY);
+      uint32_t waitMs = 0;
+      if (self->_scrolling) {
+        int32_t due = (int32_t)(millis() - self->_nextScrollAt);
+        if (due >= 0) {
+          self->renderScrollFrame();
+          self->_nextScrollAt += self->_scrollMs;
+          if ((int32_t)(millis() - self->_nextScrollAt) > (int32_t)self->_scrollMs) self->_nextScrollAt = millis();
+        }
+        waitMs = self->_nextScrollAt - millis();
+        if ((int32_t)waitMs < 0) waitMs = 0;
+      }
+      xSemaphoreGive(self->_mutex);
+      // A new print()/scroll() notifies us so the wait never delays a fresh request
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs ? waitMs : 1));
+    }
+  }
+
+  // FC16 modules: digit register r holds row r, bit c is the c-th column from the
+  // left of that module. The first pair shifted out lands in the module furthest
+  // from the MCU, which is the leftmost one.
+  uint8_t rowByte(uint8_t dev, uint8_t row) const {
+    uint8_t b = 0;
+    const uint8_t* cols = _fb + dev * 8;
+    for (uint8_t c = 0; c < 8; c++) if (cols[c] & (1 << row)) b |= (1 << c);
+    return b;
+  }
+
+  // Diff the framebuffer against _sent and clock out only the rows that differ.
+  // A row write has to shift through the whole chain, so modules whose byte is
+  // unchanged get a NO-OP instead of a register write.
+  void flush() {
+    uint8_t packet[MATRIX_RENDERER_MAX_DEVICES * 2];
+    uint32_t bytes = 0, rows = 0;
+    uint32_t t0 = micros();
+    for (uint8_t r = 0; r < 8; r++) {
+      bool changed = false;
+      for (uint8_t d = 0; d < _numDevices; d++) {
+        uint8_t b = rowByte(d, r);
+        if (!_sentValid || b != _sent[d][r]) {
+          packet[d * 2] = MAX7219_REG_DIGIT0 + r;
+          packet[d * 2 + 1] = b;
+          _sent[d][r] = b;
+          changed = true;
+        } else {
+          packet[d * 2] = MAX7219_REG_NOOP;
+          packet[d * 2 + 1] = 0;
+        }
+      }
+      if (!changed) continue;
+      transfer(packet, _numDevices * 2);
+      bytes += _numDevices * 2;
+      rows++;
+    }
+    uint32_t elapsed = micros() - t0;
+    _sentValid = true;
+    if (rows == 0) {
+      _stats.skipped++;
+      _stats.lastBytes = 0;   // nothing went out; do not report the previous update's cost
+      _stats.lastMicros = 0;
+      return;
+    }
+    _stats.updates++;
+    _stats.rowsSent += rows;
+    _stats.bytesSent += bytes;
+    _stats.lastBytes = bytes;
+    _stats.lastMicros = elapsed;
+    _stats.totalMicros += elapsed;
+    if (elapsed > _stats.maxMicros) _stats.maxMicros = elapsed;
+  }
+
+  void sendAll(uint8_t reg, uint8_t value) {
+    uint8_t packet[MATRIX_RENDERER_MAX_DEVICES * 2];
+    for (uint8_t d = 0; d < _numDevices; d++) { packet[d * 2] = reg; packet[d * 2 + 1] = value; }
+    transfer(packet, _numDevices * 2);
+  }
+
+  void transfer(const uint8_t* data, uint8_t len) {
+    _spi.beginTransaction(SPISettings(MATRIX_RENDERER_SPI_HZ, MSBFIRST, SPI_MODE0));
+    digitalWrite(_csPin, LOW);
+    _spi.writeBytes(data, len);
+    digitalWrite(_csPin, HIGH);
+    _spi.endTransaction();
+  }
+};
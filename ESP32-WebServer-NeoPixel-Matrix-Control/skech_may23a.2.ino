@@ -2,9 +2,8 @@
 #include <WebServer.h>
 #include <Adafruit_NeoPixel.h>
 #include <ESP32Encoder.h>
-#include <MD_Parola.h>      // <<< MATRIX IÇIN EKLENDI
-#include <MD_MAX72xx.h>     
-#include <SPI.h>            
+#include <SPI.h>
+#include "matrix_renderer.h" // <<< MATRIX IÇIN EKLENDI
 
 // --- Ağ Ayarları ---
 const char* ssid = "WIFI-NAME";
@@ -29,13 +28,14 @@ ESP32Encoder encoder;
 WebServer server(80);
 
 // --- MAX7219 Pin Tanımlamaları ---
-#define MAX_HW_TYPE MD_MAX72XX::FC16_HW
 #define MAX_MATRIX_DEVICES 4
 #define MATRIX_CLK_PIN     2
 #define MATRIX_DATA_PIN    12
 #define MATRIX_CS_PIN      13
 
-MD_Parola P = MD_Parola(MAX_HW_TYPE, MATRIX_DATA_PIN, MATRIX_CLK_PIN, MATRIX_CS_PIN, MAX_MATRIX_DEVICES);
+#define MATRIX_SCROLL_MS   75 // Bir sütun kayma süresi (ms)
+
+MatrixRenderer matrix(MATRIX_DATA_PIN, MATRIX_CLK_PIN, MATRIX_CS_PIN, MAX_MATRIX_DEVICES);
 char webMatrixMessage[100] = "ESP32 Matrix!"; // Web'den gelen mesajı tutacak
 bool newWebMatrixMessageAvailable = true;    // Yeni mesaj var mı?
 
@@ -202,15 +202,8 @@ void setup() {
 
   strip.begin(); strip.setBrightness(255);
 
-  // --- MAX7219 (Parola)
-  P.begin();
-  P.setIntensity(4); 
-  P.displayClear();
-  P.setTextAlignment(PA_LEFT);
-  P.setTextEffect(PA_SCROLL_LEFT, PA_SCROLL_LEFT);
-  P.setSpeed(75);  
-  P.setPause(0);   
-  // P.displayText(webMatrixMessage, PA_LEFT, 75, 0, PA_SCROLL_LEFT, PA_SCROLL_LEFT);
+  // --- MAX7219 (kendi görevinde kayan yazı)
+  matrix.begin(4);
 
   pinMode(ENCODER_CLK_PIN, INPUT); pinMode(ENCODER_DT_PIN, INPUT); pinMode(ENCODER_SW_PIN, INPUT);
   encoder.attachHalfQuad(ENCODER_DT_PIN, ENCODER_CLK_PIN);
@@ -241,14 +234,16 @@ void setup() {
 void loop() {
   server.handleClient();
 
-  // --- MAX7219 (Parola) Animasyon ---
-  if (P.displayAnimate()) { 
-    if (newWebMatrixMessageAvailable) { 
-      P.displayText(webMatrixMessage, PA_LEFT, 75, 0, PA_SCROLL_LEFT, PA_SCROLL_LEFT);
-      newWebMatrixMessageAvailable = false;
-    } else { 
-      P.displayText(webMatrixMessage, PA_LEFT, 75, 0, PA_SCROLL_LEFT, PA_SCROLL_LEFT);
-    }
+  // --- MAX7219 Animasyon --- (kaydırma matrix görevinde zamanlanır, loop'a bağlı değil)
+  if (newWebMatrixMessageAvailable) {
+    matrix.scroll(webMatrixMessage, MATRIX_SCROLL_MS, true);
+    newWebMatrixMessageAvailable = false;
+  }
+
+  static unsigned long lastMatrixStats = 0;
+  if (millis() - lastMatrixStats > 30000) {
+    lastMatrixStats = millis();
+    matrix.printStats(Serial);
   }
 
   long val = encoder.getCount();
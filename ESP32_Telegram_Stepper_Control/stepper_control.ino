@@ -1,15 +1,16 @@
 // --- Core Libraries ---
 #include <WiFi.h> // Use <ESP8266WiFi.h> for ESP8266
-#include <WiFiClientSecure.h>
-#include <UniversalTelegramBot.h>
+#include <TelegramCertificate.h> // Root CA from the UniversalTelegramBot library
 #include <AiEsp32RotaryEncoder.h>
+#define TELEGRAM_LONG_POLL_S 5   // position reports (sendLatest) wait for the poll to return
+#include "telegram_link.h"
+#include "stepper_motion.h"
 
 // --- WiFi and Telegram Settings (Update with your credentials) ---
 const char* WIFI_SSID = "YOUR_WIFI_SSID";
 const char* WIFI_PASSWORD = "YOUR_WIFI_PASSWORD";
 #define BOT_TOKEN "YOUR_BOT_TOKEN"
 #define CHAT_ID "YOUR_CHAT_ID" // Your numerical Telegram Chat ID
-const unsigned long BOT_MTBS = 1000; // Mean Time Between Scan messages
 
 // --- Stepper Motor Pin Definitions ---
 #define STEP_PIN 23
@@ -20,6 +21,16 @@ const unsigned long BOT_MTBS = 1000; // Mean Time Between Scan messages
 #define STEPS_PER_REVOLUTION 200 
 #define MICROSTEPPING_FACTOR 1    // e.g., 1 for full step, 2 for half, 8 for 1/8, etc.
 
+// --- Motion Profile Defaults (in steps, change at runtime with speed/accel/profile) ---
+#define MOTOR_MAX_SPEED 1000      // steps/s
+#define MOTOR_ACCEL 2000          // steps/s^2
+#define MOTOR_JERK 20000          // steps/s^3, used by the S-curve profile
+#define MOTOR_START_SPEED 100     // steps/s, start/stop speed without ramping
+
+// --- Position Reporting While Moving ---
+#define POSITION_REPORT_SERIAL_MS 250
+#define POSITION_REPORT_TELEGRAM_MS 3000
+
 // --- Rotary Encoder Pin Definitions ---
 #define ROTARY_ENCODER_A_PIN 14
 #define ROTARY_ENCODER_B_PIN 33
@@ -27,15 +38,19 @@ const unsigned long BOT_MTBS = 1000; // Mean Time Between Scan messages
 #define ROTARY_ENCODER_STEPS 4 // Pulses per detent for your encoder
 
 // --- Global Variables - Motor & Encoder ---
-int stepMotorSpeedDelay = 1000; // Microseconds delay between step pulses (controls speed)
 long currentEncoderPosition = 0;
 long lastEncoderPosition = 0;
 volatile boolean motorGloballyEnabled = false; // Motor active state (controlled by EN_PIN)
+bool sCurveEnabled = false;
+bool wasMoving = false;
+bool reportMoveToTelegram = false; // Only Telegram-started moves are reported back
+unsigned long lastSerialReport = 0;
+unsigned long lastTelegramReport = 0;
+String pendingMoveDone; // "Move complete." not yet accepted by the Telegram queue
 
 // --- Library Objects ---
-WiFiClientSecure secured_client;
-UniversalTelegramBot bot(BOT_TOKEN, secured_client);
-unsigned long bot_lasttime;
+TelegramLink telegram; // Long-polls the Bot API in its own task
+StepperMotion motion;  // Timer-driven step generator with acceleration ramps
 AiEsp32RotaryEncoder rotaryEncoder = AiEsp32RotaryEncoder(ROTARY_ENCODER_A_PIN, ROTARY_ENCODER_B_PIN, ROTARY_ENCODER_BUTTON_PIN, -1, ROTARY_ENCODER_STEPS);
 
 // --- Interrupt Service Routine for Rotary Encoder ---
@@ -51,105 +66,150 @@ void enableMotor() {
 }
 
 void disableMotor() {
+    motion.halt(); // Drop any running move before the driver lets go
     digitalWrite(EN_PIN, HIGH); // HIGH to disable for many common drivers
     motorGloballyEnabled = false;
     Serial.println("Motor DISABLED");
 }
 
-void stepOnce(bool direction, int speedDelay) {
-  if (!motorGloballyEnabled) return; // Only step if motor is enabled
-  digitalWrite(DIR_PIN, direction);
-  digitalWrite(STEP_PIN, HIGH);
-  delayMicroseconds(speedDelay);
-  digitalWrite(STEP_PIN, LOW);
-  delayMicroseconds(speedDelay);
+long degreesToSteps(float degrees) {
+  return lroundf((degrees / 360.0) * STEPS_PER_REVOLUTION * MICROSTEPPING_FACTOR);
 }
 
-void rotateStepperBySteps(long stepsToMove, bool direction) {
-  if (!motorGloballyEnabled) {
-    Serial.println("Motor is disabled. Cannot move.");
-    // Optionally send a Telegram message back if called from there
-    // bot.sendMessage(CHAT_ID, "Motor is disabled. Use 'motoron' first.", "");
-    return;
-  }
-  Serial.print("Rotating by steps: "); Serial.print(stepsToMove);
-  Serial.print(" Direction: "); Serial.println(direction ? "CW (HIGH)" : "CCW (LOW)");
-  for (long i = 0; i < stepsToMove; i++) {
-    stepOnce(direction, stepMotorSpeedDelay);
-  }
+float stepsToDegrees(long steps) {
+  return steps * 360.0 / (STEPS_PER_REVOLUTION * MICROSTEPPING_FACTOR);
+}
+
+void applyMotionLimits(float maxSpeed, float accel, bool sCurve) {
+  MotionLimits lim = { maxSpeed, accel, sCurve ? (float)MOTOR_JERK : 0, MOTOR_START_SPEED };
+  motion.setLimits(lim);
+  sCurveEnabled = sCurve;
 }
 
-void rotateStepperByDegrees(float degrees) {
-  bool direction = HIGH; // Default Clockwise
-  if (degrees < 0) {
-    direction = LOW; // Counter-Clockwise
-    degrees = -degrees;
+String positionReport() {
+  String msg = "Position: " + String(motion.position()) + " steps (" + String(stepsToDegrees(motion.position()), 1) + " deg)";
+  if (motion.isMoving()) {
+    msg += ", target " + String(motion.target()) + ", speed " + String((int)motion.speed()) + " steps/s";
   }
-  long stepsToMove = (long)((degrees / 360.0) * STEPS_PER_REVOLUTION * MICROSTEPPING_FACTOR);
-  rotateStepperBySteps(stepsToMove, direction);
+  if (motion.queuedMoves()) msg += ", queued " + String(motion.queuedMoves());
+  return msg;
 }
 
-// --- Telegram Message Handler ---
-void handleNewMessages(int numNewMessages) {
-  Serial.print("handleNewMessages "); Serial.println(numNewMessages);
-  for (int i = 0; i < numNewMessages; i++) {
-    String chat_id_from_message = bot.messages[i].chat_id;
-    String text = bot.messages[i].text;
-    Serial.println(text);
-    String from_name = bot.messages[i].from_name;
-    if (from_name == "") from_name = "Guest";
-
-    if (chat_id_from_message != CHAT_ID) {
-      bot.sendMessage(chat_id_from_message, "Unauthorized user", "");
-      continue;
+// Live position on Serial (and Telegram for Telegram-started moves) while the motor runs.
+void reportMotion() {
+  bool moving = motion.isMoving();
+  if (moving) {
+    if (millis() - lastSerialReport >= POSITION_REPORT_SERIAL_MS) {
+      Serial.println(positionReport());
+      lastSerialReport = millis();
     }
+    if (reportMoveToTelegram && millis() - lastTelegramReport >= POSITION_REPORT_TELEGRAM_MS) {
+      telegram.sendLatest(CHAT_ID, positionReport(), "");
+      lastTelegramReport = millis();
+    }
+  } else if (wasMoving) {
+    Serial.println("Move complete. " + positionReport());
+    if (reportMoveToTelegram) pendingMoveDone = "Move complete. " + positionReport();
+    reportMoveToTelegram = false;
+  }
+  wasMoving = moving;
+  // Retried until queued: a full reply queue must not swallow the completion.
+  if (pendingMoveDone.length() && telegram.send(CHAT_ID, pendingMoveDone, "")) pendingMoveDone = "";
+}
 
-    String lowerText = text;
-    lowerText.toLowerCase();
-
-    if (lowerText == "/start") {
-      String welcome = "Welcome, " + from_name + ".\n";
-      welcome += "Stepper Motor Control Bot:\n\n";
-      welcome += "motoron -> Enables the motor driver\n";
-      welcome += "motoroff -> Disables the motor driver\n";
-      welcome += "turn <degrees> -> Rotates motor (e.g., turn90, turn-45 for CCW)\n";
-      welcome += "step <count> -> Rotates motor by steps (e.g., step200, step-100 for CCW)\n";
-      welcome += "motorstatus -> Shows if motor driver is enabled\n";
-      bot.sendMessage(chat_id_from_message, welcome, "Markdown");
-    } else if (lowerText == "motoron") { 
-      enableMotor();
-      bot.sendMessage(chat_id_from_message, "Motor driver ENABLED.", "");
-    } else if (lowerText == "motoroff") { 
-      disableMotor();
-      bot.sendMessage(chat_id_from_message, "Motor driver DISABLED.", "");
-    } else if (lowerText.startsWith("turn")) {
-        String valStr = text.substring(4); // Use original text for toFloat to handle potential "-"
-        float degrees = valStr.toFloat();
-        if (!motorGloballyEnabled) {
-            bot.sendMessage(chat_id_from_message, "Motor is disabled. Use 'motoron' first.", "");
-        } else {
-            rotateStepperByDegrees(degrees);
-            bot.sendMessage(chat_id_from_message, "Motor command: turn " + valStr + " degrees.", "");
-        }
-    } else if (lowerText.startsWith("step")) {
-        String valStr = text.substring(4); // Use original text for toInt to handle potential "-"
-        long steps = valStr.toInt();
-        bool dir = HIGH; 
-        if (steps < 0) {
-            dir = LOW; 
-            steps = -steps;
-        }
-        if (!motorGloballyEnabled) {
-            bot.sendMessage(chat_id_from_message, "Motor is disabled. Use 'motoron' first.", "");
-        } else {
-            rotateStepperBySteps(steps, dir);
-            bot.sendMessage(chat_id_from_message, "Motor command: step " + valStr + " steps.", "");
-        }
-    } else if (lowerText == "motorstatus") {
-        String msg = "Motor driver is currently: ";
-        msg += motorGloballyEnabled ? "ENABLED." : "DISABLED.";
-        bot.sendMessage(chat_id_from_message, msg, "");
+// --- Telegram Command Handler ---
+// Only commands from CHAT_ID reach here; TelegramLink answers other chats itself.
+void handleCommand(const TelegramCommand& cmd) {
+  String text = cmd.text;
+  Serial.println(text);
+  String from_name = cmd.fromName;
+  if (from_name == "") from_name = "Guest";
+
+  String lowerText = text;
+  lowerText.toLowerCase();
+
+  // A leading '+' queues the move after the current one; otherwise it overrides it.
+  bool queued = lowerText.startsWith("+");
+  if (queued) {
+    text = text.substring(1);
+    lowerText = lowerText.substring(1);
+  }
+  bool isMove = lowerText.startsWith("turn") || lowerText.startsWith("step") || lowerText.startsWith("goto");
+
+  if (lowerText == "/start") {
+    String welcome = "Welcome, " + from_name + ".\n";
+    welcome += "Stepper Motor Control Bot:\n\n";
+    welcome += "motoron -> Enables the motor driver\n";
+    welcome += "motoroff -> Disables the motor driver (stops immediately)\n";
+    welcome += "turn <degrees> -> Rotates motor (e.g., turn90, turn-45 for CCW)\n";
+    welcome += "step <count> -> Rotates motor by steps (e.g., step200, step-100 for CCW)\n";
+    welcome += "goto <degrees> -> Moves to an absolute angle (e.g., goto180)\n";
+    welcome += "gotostep <count> -> Moves to an absolute step position\n";
+    welcome += "A new move overrides the running one; prefix with + to queue it (e.g., +turn90)\n";
+    welcome += "stop -> Ramps down and clears the queue\n";
+    welcome += "speed <steps/s>, accel <steps/s2> -> Motion limits\n";
+    welcome += "profile trap|scurve -> Acceleration profile\n";
+    welcome += "motorstatus -> Shows driver state and position\n";
+    telegram.reply(cmd, welcome, "Markdown");
+  } else if (lowerText == "motoron") { 
+    enableMotor();
+    telegram.reply(cmd, "Motor driver ENABLED.", "");
+  } else if (lowerText == "motoroff") { 
+    disableMotor();
+    telegram.reply(cmd, "Motor driver DISABLED.", "");
+  } else if (isMove && !motorGloballyEnabled) {
+    telegram.reply(cmd, "Motor is disabled. Use 'motoron' first.", "");
+  } else if (lowerText.startsWith("turn")) {
+    String valStr = text.substring(4); // Use original text for toFloat to handle potential "-"
+    motion.move(degreesToSteps(valStr.toFloat()), queued);
+    reportMoveToTelegram = true;
+    telegram.reply(cmd, String(queued ? "Queued" : "Motor command") + ": turn " + valStr + " degrees.", "");
+  } else if (lowerText.startsWith("step")) {
+    String valStr = text.substring(4); // Use original text for toInt to handle potential "-"
+    motion.move(valStr.toInt(), queued);
+    reportMoveToTelegram = true;
+    telegram.reply(cmd, String(queued ? "Queued" : "Motor command") + ": step " + valStr + " steps.", "");
+  } else if (lowerText.startsWith("gotostep")) {
+    String valStr = text.substring(8);
+    motion.moveTo(valStr.toInt(), queued);
+    reportMoveToTelegram = true;
+    telegram.reply(cmd, String(queued ? "Queued" : "Motor command") + ": go to step " + valStr + ".", "");
+  } else if (lowerText.startsWith("goto")) {
+    String valStr = text.substring(4);
+    motion.moveTo(degreesToSteps(valStr.toFloat()), queued);
+    reportMoveToTelegram = true;
+    telegram.reply(cmd, String(queued ? "Queued" : "Motor command") + ": go to " + valStr + " degrees.", "");
+  } else if (lowerText == "stop") {
+    motion.stop();
+    telegram.reply(cmd, "Stopping. " + positionReport(), "");
+  } else if (lowerText.startsWith("speed")) {
+    float val = text.substring(5).toFloat();
+    if (val >= MOTOR_START_SPEED && val <= 1000000 / STEPPER_MIN_INTERVAL_US) {
+      applyMotionLimits(val, motion.limits().accel, sCurveEnabled);
+      telegram.reply(cmd, "Max speed set: " + String((int)val) + " steps/s", "");
+    } else {
+      telegram.reply(cmd, "Invalid speed. Use: speed" + String(MOTOR_START_SPEED) + ".." + String(1000000 / STEPPER_MIN_INTERVAL_US), "");
+    }
+  } else if (lowerText.startsWith("accel")) {
+    float val = text.substring(5).toFloat();
+    if (val > 0) {
+      applyMotionLimits(motion.limits().maxSpeed, val, sCurveEnabled);
+      telegram.reply(cmd, "Acceleration set: " + String((int)val) + " steps/s2", "");
+    } else {
+      telegram.reply(cmd, "Invalid acceleration. Use: accel<steps/s2>", "");
     }
+  } else if (lowerText == "profile trap" || lowerText == "profile scurve") {
+    applyMotionLimits(motion.limits().maxSpeed, motion.limits().accel, lowerText.endsWith("scurve"));
+    telegram.reply(cmd, sCurveEnabled ? "Profile: S-curve (jerk limited)." : "Profile: trapezoidal.", "");
+  } else if (lowerText == "motorstatus") {
+    StepperStats st = motion.stats();
+    String msg = "Motor driver is currently: ";
+    msg += motorGloballyEnabled ? "ENABLED.\n" : "DISABLED.\n";
+    msg += positionReport() + "\n";
+    msg += "Limits: " + String((int)motion.limits().maxSpeed) + " steps/s, " + String((int)motion.limits().accel) + " steps/s2, ";
+    msg += sCurveEnabled ? "S-curve\n" : "trapezoidal\n";
+    msg += "Steps: " + String(st.steps) + ", step jitter max " + String(st.maxJitterUs) + " us, underruns " + String(st.underruns);
+    telegram.reply(cmd, msg, "");
   }
 }
 
@@ -158,10 +218,12 @@ void setup() {
   Serial.begin(115200);
   Serial.println("\nStarting ESP32 Telegram Stepper Control Bot...");
 
-  // Initialize Stepper Motor Pins
-  pinMode(STEP_PIN, OUTPUT);
-  pinMode(DIR_PIN, OUTPUT);
+  // Initialize Stepper Motor Pins and the step generator
   pinMode(EN_PIN, OUTPUT);
+  MotionLimits limits = { MOTOR_MAX_SPEED, MOTOR_ACCEL, 0, MOTOR_START_SPEED };
+  if (!motion.begin(STEP_PIN, DIR_PIN, limits)) {
+    Serial.println("ERROR: Stepper timer/task could not be started.");
+  }
   disableMotor(); // Start with motor driver disabled
 
   // Initialize Rotary Encoder
@@ -181,30 +243,22 @@ void setup() {
   Serial.print("Connecting to Wifi SSID: "); Serial.println(WIFI_SSID);
   WiFi.mode(WIFI_STA);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  
-  // Configure WiFiClientSecure for Telegram (ESP32 specific)
-  // For ESP8266, SSL/TLS handling might differ slightly with UniversalTelegramBot or require BearSSL setup
-  secured_client.setCACert(TELEGRAM_CERTIFICATE_ROOT); 
-  
+
   while (WiFi.status() != WL_CONNECTED) {
     Serial.print(".");
     delay(500);
   }
   Serial.print("\nWiFi connected. IP address: "); Serial.println(WiFi.localIP());
-  bot.sendMessage(CHAT_ID, "ESP32 Stepper Bot Online!", "");
+  telegram.begin(BOT_TOKEN, CHAT_ID, TELEGRAM_CERTIFICATE_ROOT);
+  telegram.send(CHAT_ID, "ESP32 Stepper Bot Online!", "");
 }
 
 // --- Main Loop ---
 void loop() {
-  // Check for new Telegram messages
-  if (millis() - bot_lasttime > BOT_MTBS) {
-    int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    while (numNewMessages) {
-      Serial.println("Got Telegram response");
-      handleNewMessages(numNewMessages);
-      numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    }
-    bot_lasttime = millis();
+  // Handle Telegram commands queued by the Telegram task (non-blocking)
+  TelegramCommand cmd;
+  while (telegram.nextCommand(cmd)) {
+    handleCommand(cmd);
   }
 
   // Check Rotary Encoder Button (to toggle motor enable state)
@@ -219,20 +273,21 @@ void loop() {
   }
 
   // Control Stepper Motor with Rotary Encoder (if motor is enabled)
+  // Each detent shifts the target by one step, so jogging also works during a move.
   if (motorGloballyEnabled) {
     if (rotaryEncoder.encoderChanged()) {
       currentEncoderPosition = rotaryEncoder.readEncoder();
-      bool direction = HIGH; // Default CW
       if (currentEncoderPosition > lastEncoderPosition) {
-        direction = HIGH; // Or your preferred CW direction
         Serial.print("Encoder CW -> Pos: "); Serial.println(currentEncoderPosition);
-        stepOnce(direction, stepMotorSpeedDelay);
+        motion.jog(1);
       } else if (currentEncoderPosition < lastEncoderPosition) {
-        direction = LOW; // Or your preferred CCW direction
         Serial.print("Encoder CCW -> Pos: "); Serial.println(currentEncoderPosition);
-        stepOnce(direction, stepMotorSpeedDelay);
+        motion.jog(-1);
       }
       lastEncoderPosition = currentEncoderPosition;
     }
   }
+
+  reportMotion();
+  delay(1);
 }
\ No newline at end of file
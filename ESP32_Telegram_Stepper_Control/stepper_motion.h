@@ -0,0 +1,425 @@
+/**
+ * @file stepper_motion.h
+ * @brief Timer-driven step generator with acceleration profiles and a move queue.
+ *
+ * Split in two:
+ *  - StepProfile plans the motion one step at a time: trapezoidal acceleration,
+ *    or jerk-limited (S-curve) when jerk > 0. Its target can change at any
+ *    time (override/cancel); it brakes, overshoots if it has to, and comes back.
+ *    It has no Arduino dependencies so it can be compiled on a PC to check the
+ *    step timing of a profile without a motor.
+ *  - StepperMotion runs StepProfile in a FreeRTOS task. The task fills a small
+ *    ring buffer (~STEPPER_LOOKAHEAD_US of motion) with step intervals. A
+ *    hardware timer ISR pops one entry per step, pulses STEP_PIN and re-arms
+ *    itself with the interval. The ISR does no math, so WiFi/Telegram traffic
+ *    does not change the step timing.
+ *
+ * Commands (moveTo/move/jog/stop/halt) can be called from any task; they are
+ * passed to the planner task through a queue.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+#define STEPPER_MIN_INTERVAL_US   50        // 20 kHz ceiling (ISR + pulse time)
+#define STEPPER_MAX_INTERVAL_US   1000000
+
+struct MotionLimits {
+  float maxSpeed;     // steps/s
+  float accel;        // steps/s^2
+  float jerk;         // steps/s^3, 0 = trapezoidal
+  float startSpeed;   // steps/s, speed the motor can start/stop at without ramping
+};
+
+class StepProfile {
+public:
+  void setLimits(const MotionLimits& lim) {
+    _lim = lim;
+    if (_lim.startSpeed < 1) _lim.startSpeed = 1;
+    if (_lim.maxSpeed < _lim.startSpeed) _lim.maxSpeed = _lim.startSpeed;
+  }
+  const MotionLimits& limits() const { return _lim; }
+
+  void setTarget(long target) {
+    if (target != _target) _braking = false;
+    _target = target;
+  }
+  long target() const { return _target; }
+  long position() const { return _pos; }
+  float speed() const { return _v; }
+  int direction() const { return _dir; }
+  bool atRest() const { return _v == 0 && _pos == _target; }
+
+  // Drops all motion state; used after a hard stop.
+  void resetAt(long pos) {
+    _pos = _target = pos;
+    _v = _a = 0;
+    _braking = false;
+  }
+
+  // Where the motor would come to rest if braking started now.
+  long stoppingTarget() const {
+    if (_v == 0) return _pos;
+    return _pos + _dir * (long)ceilf(stopDistance());
+  }
+
+  // Plans the next step. Returns the time in microseconds to wait after that
+  // step and sets dir (+1/-1), or returns 0 when resting on the target.
+  uint32_t next(int& dir) {
+    if (_v > 0) {
+      long ahead = (_target - _pos) * _dir;
+      if (ahead == 0 && canStopNow()) {            // arrived
+        _v = _a = 0;
+        _braking = false;
+        return 0;
+      }
+      if (ahead <= 0 && canStopNow()) {
+        _v = _a = 0;              // stopped past an overridden target, reverse
+        _braking = false;
+      } else {
+        accelerate(ahead);
+      }
+    }
+    if (_v == 0) {
+      long remaining = _target - _pos;
+      if (remaining == 0) return 0;
+      _dir = remaining > 0 ? 1 : -1;
+      _v = _lim.startSpeed;
+      _a = 0;
+    }
+
+    _pos += _dir;
+    dir = _dir;
+    float us = 1000000.0f / _v;
+    if (us < STEPPER_MIN_INTERVAL_US) us = STEPPER_MIN_INTERVAL_US;
+    if (us > STEPPER_MAX_INTERVAL_US) us = STEPPER_MAX_INTERVAL_US;
+    return (uint32_t)us;
+  }
+
+private:
+  MotionLimits _lim = {1000, 2000, 0, 100};
+  long _pos = 0;
+  long _target = 0;
+  int _dir = 1;
+  float _v = 0;       // steps/s
+  float _a = 0;       // steps/s^2
+  bool _braking = false;
+
+  // True when stopping dead from the current speed is no harsher than one step
+  // of full deceleration down to startSpeed. Arriving faster than that means
+  // passing the target and coming back.
+  bool canStopNow() const {
+    return _v * _v <= _lim.startSpeed * _lim.startSpeed + 2 * _lim.accel;
+  }
+
+  float stopDistance() const {
+    float s = _lim.startSpeed;
+    if (_v <= s) return 0;
+    float A = _lim.accel;
+    if (_lim.jerk <= 0) return (_v * _v - s * s) / (2 * A);
+    // S-curve: ramp the acceleration from _a down to -A at the jerk limit,
+    // then brake at -A down to startSpeed.
+    float J = _lim.jerk;
+    float t = (_a + A) / J;
+    float v1 = _v + _a * t - J * t * t / 2;
+    float d = _v * t + _a * t * t / 2 - J * t * t * t / 6;
+    if (v1 > s) d += (v1 * v1 - s * s) / (2 * A);
+    return d;
+  }
+
+  // Updates speed for one step of travel; ahead = steps left in the current direction.
+  void accelerate(long ahead) {
+    float aTarget;
+    if (ahead <= 0) {
+      aTarget = -_lim.accel;                       // target at/behind us: brake, pass it, come back
+    } else if (_braking || ahead <= stopDistance()) {
+      // Once braking, use exactly the deceleration that lands on the target,
+      // but never more than the limit. A target moved closer than the stopping
+      // distance is overshot and approached again from the other side.
+      _braking = true;
+      float s = _lim.startSpeed;
+      float need = (_v * _v - s * s) / (2 * (float)ahead);
+      if (need > _lim.accel) need = _lim.accel;
+      aTarget = -(need > 0 ? need : 0);
+    } else if (_v >= _lim.maxSpeed) {
+      aTarget = 0;
+    } else if (_lim.jerk > 0 && _a > 0 && _v + _a * _a / (2 * _lim.jerk) + _a / _v >= _lim.maxSpeed) {
+      aTarget = 0;                                 // ease into cruise
+    } else {
+      aTarget = _lim.accel;
+    }
+
+    if (_lim.jerk <= 0 || _braking) {
+      // Trapezoidal, and braking: the brake deceleration is recomputed per step.
+      if (_lim.jerk > 0 && _braking && _a > aTarget) {
+        float da = _lim.jerk / _v;
+        _a = (_a - da > aTarget) ? _a - da : aTarget;
+      } else {
+        _a = aTarget;
+      }
+    } else {
+      float da = _lim.jerk / _v;                   // jerk * dt, dt = 1/v
+      if (_a < aTarget) _a = (_a + da < aTarget) ? _a + da : aTarget;
+      else if (_a > aTarget) _a = (_a - da > aTarget) ? _a - da : aTarget;
+    }
+
+    float v2 = _v * _v + 2 * _a;                   // v^2 = v0^2 + 2*a*s, s = 1 step
+    float s2 = _lim.startSpeed * _lim.startSpeed;
+    _v = v2 > s2 ? sqrtf(v2) : _lim.startSpeed;
+    if (_v > _lim.maxSpeed) _v = _lim.maxSpeed;
+  }
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+#define STEPPER_BUF_LEN         128       // power of two
+#define STEPPER_LOOKAHEAD_US    20000     // motion buffered ahead of the ISR (override latency)
+#define STEPPER_IDLE_TICK_US    500       // timer period while the buffer is empty
+#define STEPPER_PULSE_US        3         // STEP high time (A4988 >= 1 us, DRV8825 >= 1.9 us)
+#define STEPPER_DIR_SETUP_US    2         // DIR -> STEP setup time
+#define STEPPER_MOVE_QUEUE_LEN  8
+#define STEPPER_TIMER_NUM       0         // Arduino core 2.x timer index
+
+struct StepperStats {
+  uint32_t steps;
+  uint32_t moves;
+  uint32_t underruns;       // ISR found the buffer empty while a move was running
+  uint32_t maxJitterUs;     // worst |actual - planned| step interval
+};
+
+class StepperMotion {
+public:
+  bool begin(int stepPin, int dirPin, const MotionLimits& lim, BaseType_t core = 1) {
+    _stepPin = stepPin;
+    _dirPin = dirPin;
+    pinMode(_stepPin, OUTPUT);
+    pinMode(_dirPin, OUTPUT);
+    digitalWrite(_stepPin, LOW);
+    digitalWrite(_dirPin, HIGH);
+    _dirHigh = true;
+    _profile.setLimits(lim);
+
+    _commands = xQueueCreate(STEPPER_MOVE_QUEUE_LEN, sizeof(Command));
+    if (!_commands) return false;
+    if (xTaskCreatePinnedToCore(taskEntry, "Stepper_Task", 4096, this, 3, &_task, core) != pdPASS) return false;
+
+    s_instance = this;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    _timer = timerBegin(1000000);
+    timerAttachInterrupt(_timer, &onTimer);
+    timerAlarm(_timer, STEPPER_IDLE_TICK_US, true, 0);
+#else
+    _timer = timerBegin(STEPPER_TIMER_NUM, 80, true);   // 1 MHz
+    timerAttachInterrupt(_timer, &onTimer, true);
+    timerAlarmWrite(_timer, STEPPER_IDLE_TICK_US, true);
+    timerAlarmEnable(_timer);
+#endif
+    return _timer != nullptr;
+  }
+
+  // Absolute/relative moves in steps. queued=false overrides the running move
+  // (the motor ramps over to the new target); queued=true runs it afterwards.
+  bool moveTo(long target, bool queued = false) { return post(queued ? CMD_QUEUE_TO : CMD_MOVE_TO, target); }
+  bool move(long delta, bool queued = false)    { return post(queued ? CMD_QUEUE_BY : CMD_MOVE_BY, delta); }
+  bool jog(long delta)                          { return post(CMD_JOG, delta); }
+  bool stop()                                   { return post(CMD_STOP, 0); }   // ramp down, clear queue
+  bool halt()                                   { return post(CMD_HALT, 0); }   // drop everything now
+  bool setLimits(const MotionLimits& lim) {
+    _newLimits = lim;
+    return post(CMD_LIMITS, 0);
+  }
+
+  long position() const { return _position; }        // steps actually output
+  long target() const { return _target; }
+  float speed() const { return _speed; }              // planned speed, steps/s
+  bool isMoving() const { return _moving; }
+  uint8_t queuedMoves() const { return _queuedCount; }
+  MotionLimits limits() const { return _limits; }
+  StepperStats stats() const {
+    StepperStats s = _stats;
+    return s;
+  }
+
+private:
+  enum CommandType : uint8_t { CMD_MOVE_TO, CMD_MOVE_BY, CMD_QUEUE_TO, CMD_QUEUE_BY, CMD_JOG, CMD_STOP, CMD_HALT, CMD_LIMITS };
+  struct Command {
+    CommandType type;
+    int32_t value;
+  };
+
+  int _stepPin = -1;
+  int _dirPin = -1;
+  hw_timer_t* _timer = nullptr;
+  QueueHandle_t _commands = nullptr;
+  TaskHandle_t _task = nullptr;
+  StepProfile _profile;
+  MotionLimits _newLimits;
+
+  // Planner-task-only move queue (absolute targets)
+  long _queue[STEPPER_MOVE_QUEUE_LEN];
+  uint8_t _queueHead = 0;
+  uint8_t _queueLen = 0;
+
+  // Ring buffer: planner task writes _head, ISR writes _tail.
+  // Entry = interval after the step in us, bit 31 = direction (1 = DIR high).
+  volatile uint32_t _buf[STEPPER_BUF_LEN];
+  volatile uint16_t _head = 0;
+  volatile uint16_t _tail = 0;
+  volatile bool _flush = false;
+  volatile bool _dirHigh = true;
+  volatile bool _planning = false;        // profile still has steps to produce
+  volatile bool _lastWasStep = false;
+  volatile uint32_t _lastIsrUs = 0;
+  volatile uint32_t _programmedUs = STEPPER_IDLE_TICK_US;
+  uint32_t _lastInterval = STEPPER_IDLE_TICK_US;
+
+  // Published state
+  volatile long _position = 0;
+  volatile long _target = 0;
+  volatile float _speed = 0;
+  volatile bool _moving = false;
+  volatile uint8_t _queuedCount = 0;
+  MotionLimits _limits;
+  StepperStats _stats = {};
+
+  static StepperMotion* s_instance;
+
+  bool post(CommandType type, long value) {
+    Command c = { type, (int32_t)value };
+    return _commands && xQueueSend(_commands, &c, 0) == pdTRUE;
+  }
+
+  uint16_t buffered() const { return (uint16_t)((_head - _tail) & (STEPPER_BUF_LEN - 1)); }
+
+  static void IRAM_ATTR onTimer() {
+    StepperMotion* m = s_instance;
+    uint32_t now = micros();
+    uint32_t next = STEPPER_IDLE_TICK_US;
+
+    if (m->_flush) {
+      m->_tail = m->_head;
+      m->_flush = false;
+    }
+    if (m->_tail != m->_head) {
+      uint32_t e = m->_buf[m->_tail];
+      m->_tail = (m->_tail + 1) & (STEPPER_BUF_LEN - 1);
+      bool high = e >> 31;
+      if (high != m->_dirHigh) {
+        digitalWrite(m->_dirPin, high);
+        m->_dirHigh = high;
+        delayMicroseconds(STEPPER_DIR_SETUP_US);
+      }
+      digitalWrite(m->_stepPin, HIGH);
+      delayMicroseconds(STEPPER_PULSE_US);
+      digitalWrite(m->_stepPin, LOW);
+      m->_position += high ? 1 : -1;
+      m->_stats.steps++;
+
+      // Step timing check: how far this step landed from its planned time
+      if (m->_lastWasStep) {
+        int32_t dev = (int32_t)(now - m->_lastIsrUs) - (int32_t)m->_programmedUs;
+        uint32_t absDev = dev < 0 ? -dev : dev;
+        if (absDev > m->_stats.maxJitterUs) m->_stats.maxJitterUs = absDev;
+      }
+      next = e & 0x7FFFFFFF;
+      m->_lastWasStep = true;
+    } else {
+      if (m->_planning) m->_stats.underruns++;
+      m->_lastWasStep = false;
+    }
+    m->_lastIsrUs = now;
+    m->_programmedUs = next;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerAlarm(m->_timer, next, true, 0);
+#else
+    timerAlarmWrite(m->_timer, next, true);
+#endif
+  }
+
+  static void taskEntry(void* arg) { static_cast<StepperMotion*>(arg)->run(); }
+
+  void run() {
+    _limits = _profile.limits();
+    for (;;) {
+      Command c;
+      while (xQueueReceive(_commands, &c, 0) == pdTRUE) apply(c);
+      fill();
+
+      _target = _profile.target();
+      _speed = _profile.speed();
+      _queuedCount = _queueLen;
+      _planning = !_profile.atRest();
+      _moving = !_profile.atRest() || buffered() > 0;
+      // Wake up early for a new command, otherwise top up every tick
+      if (xQueuePeek(_commands, &c, 1) == pdTRUE) continue;
+    }
+  }
+
+  void fill() {
+    while (buffered() < STEPPER_BUF_LEN - 1 && (uint32_t)buffered() * _lastInterval < STEPPER_LOOKAHEAD_US) {
+      int dir;
+      uint32_t us = _profile.next(dir);
+      if (us == 0) {
+        if (_queueLen == 0) return;
+        _profile.setTarget(_queue[_queueHead]);
+        _queueHead = (_queueHead + 1) % STEPPER_MOVE_QUEUE_LEN;
+        _queueLen--;
+        _stats.moves++;
+        continue;
+      }
+      _buf[_head] = us | (dir > 0 ? 0x80000000UL : 0);
+      _head = (_head + 1) & (STEPPER_BUF_LEN - 1);
+      _lastInterval = us;
+    }
+  }
+
+  long lastQueuedTarget() const {
+    if (_queueLen == 0) return _profile.target();
+    return _queue[(_queueHead + _queueLen - 1) % STEPPER_MOVE_QUEUE_LEN];
+  }
+
+  void apply(const Command& c) {
+    switch (c.type) {
+      case CMD_MOVE_TO:
+      case CMD_MOVE_BY:
+        _queueLen = 0;
+        _profile.setTarget(c.type == CMD_MOVE_TO ? c.value : _profile.target() + c.value);
+        _stats.moves++;
+        break;
+      case CMD_QUEUE_TO:
+      case CMD_QUEUE_BY: {
+        long t = c.type == CMD_QUEUE_TO ? c.value : lastQueuedTarget() + c.value;
+        if (_profile.atRest() && _queueLen == 0) {
+          _profile.setTarget(t);
+          _stats.moves++;
+        } else if (_queueLen < STEPPER_MOVE_QUEUE_LEN) {
+          _queue[(_queueHead + _queueLen) % STEPPER_MOVE_QUEUE_LEN] = t;
+          _queueLen++;
+        }
+        break;
+      }
+      case CMD_JOG:
+        _profile.setTarget(_profile.target() + c.value);
+        break;
+      case CMD_STOP:
+        _queueLen = 0;
+        _profile.setTarget(_profile.stoppingTarget());
+        break;
+      case CMD_HALT:
+        _queueLen = 0;
+        _flush = true;
+        while (_flush) vTaskDelay(1);        // ISR drops the buffer on its next tick
+        _profile.resetAt(_position);
+        break;
+      case CMD_LIMITS:
+        _profile.setLimits(_newLimits);
+        _limits = _profile.limits();
+        break;
+    }
+  }
+};
+
+StepperMotion* StepperMotion::s_instance = nullptr;
+#endif
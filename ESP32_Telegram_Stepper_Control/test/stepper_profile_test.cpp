@@ -0,0 +1,158 @@
+// Host-side simulation of StepProfile (stepper_motion.h). No board needed:
+//
+//   cd test && make        (or: g++ -std=c++17 -O2 -I.. stepper_profile_test.cpp -o stepper_profile_test)
+//
+// Runs the planner through plain moves, overrides, queued moves and stops with
+// both profiles, and checks every step against the limits:
+//  - acceleration and deceleration never exceed MotionLimits::accel,
+//  - speed never exceeds maxSpeed,
+//  - the motor only stops or reverses at a speed it could brake from to
+//    startSpeed within one step (StepProfile::canStopNow),
+//  - it ends on the target.
+
+#include "stepper_motion.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+static const float TOL = 1.02f;   // float slack on the limits
+static int failures = 0;
+
+struct Run {
+  uint32_t steps = 0;
+  double seconds = 0;
+  float peakAccel = 0;      // steps/s^2, speeding up
+  float peakDecel = 0;      // steps/s^2, slowing down
+  float peakSpeed = 0;
+  float worstStopSpeed = 0; // speed of the last step before a stop or reversal
+  long finalPos = 0;
+};
+
+// Event: after `atStep` steps of this run, call `fn` on the profile.
+struct Event {
+  uint32_t atStep;
+  void (*fn)(StepProfile&, long);
+  long arg;
+};
+
+static void retarget(StepProfile& p, long t) { p.setTarget(t); }
+static void stopNow(StepProfile& p, long) { p.setTarget(p.stoppingTarget()); }
+
+// Steps the profile until it rests with an empty queue. `queue` holds targets
+// taken one by one whenever the profile reaches its target, like
+// StepperMotion's move queue.
+static Run simulate(StepProfile& p, std::vector<long> queue, const std::vector<Event>& events) {
+  Run r;
+  size_t nextEvent = 0, nextQueued = 0;
+  float lastV = 0;
+  int lastDir = 0;
+  for (;;) {
+    while (nextEvent < events.size() && events[nextEvent].atStep == r.steps) {
+      events[nextEvent].fn(p, events[nextEvent].arg);
+      nextEvent++;
+    }
+    int dir = 0;
+    uint32_t us = p.next(dir);
+    if (us == 0) {
+      if (lastV > r.worstStopSpeed) r.worstStopSpeed = lastV;
+      lastV = 0;
+      lastDir = 0;
+      if (nextQueued < queue.size()) { p.setTarget(queue[nextQueued++]); continue; }
+      if (nextEvent < events.size()) { r.steps = events[nextEvent].atStep; continue; }
+      break;
+    }
+    // Planned speed, not 1e6/us: the integer-us interval alone quantizes the
+    // per-step acceleration by about +-1000 steps/s^2 at 1000 steps/s.
+    float v = p.speed();
+    if (lastDir != 0 && dir != lastDir) {
+      if (lastV > r.worstStopSpeed) r.worstStopSpeed = lastV;
+    } else if (lastDir != 0) {
+      float a = (v * v - lastV * lastV) / 2;       // per step: v^2 = v0^2 + 2a
+      if (a > r.peakAccel) r.peakAccel = a;
+      if (-a > r.peakDecel) r.peakDecel = -a;
+    }
+    if (v > r.peakSpeed) r.peakSpeed = v;
+    r.seconds += us / 1e6;
+    r.steps++;
+    lastV = v;
+    lastDir = dir;
+    if (r.steps > 1000000) { printf("  runaway\n"); failures++; break; }
+  }
+  r.finalPos = p.position();
+  return r;
+}
+
+static void check(const char* name, const StepProfile& p, const Run& r, long expected) {
+  const MotionLimits& lim = p.limits();
+  float maxStopSpeed = sqrtf(lim.startSpeed * lim.startSpeed + 2 * lim.accel);
+  bool ok = r.finalPos == expected && r.peakAccel <= lim.accel * TOL && r.peakDecel <= lim.accel * TOL &&
+            r.peakSpeed <= lim.maxSpeed * TOL && r.worstStopSpeed <= maxStopSpeed * TOL;
+  printf("%-4s %-44s pos %6ld/%-6ld %6u steps %7.3f s  v %6.0f  acc %6.0f  dec %6.0f  stop v %5.0f\n",
+         ok ? "ok" : "FAIL", name, r.finalPos, expected, (unsigned)r.steps, r.seconds, r.peakSpeed, r.peakAccel,
+         r.peakDecel, r.worstStopSpeed);
+  if (!ok) failures++;
+}
+
+static StepProfile profileAt(long pos, float jerk) {
+  StepProfile p;
+  p.setLimits({1000, 2000, jerk, 100});
+  p.resetAt(pos);
+  return p;
+}
+
+int main() {
+  const float jerks[] = {0, 20000};
+  for (float jerk : jerks) {
+    printf("--- %s ---\n", jerk > 0 ? "S-curve (jerk 20000)" : "trapezoidal");
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(2000);
+      check("move 0 -> 2000", p, simulate(p, {}, {}), 2000);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(-50);
+      check("short move 0 -> -50 (no cruise)", p, simulate(p, {}, {}), -50);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(2000);
+      check("override farther at 600 -> 3000", p, simulate(p, {}, {{600, retarget, 3000}}), 3000);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(2000);
+      check("override inside stop distance at 600 -> 620", p, simulate(p, {}, {{600, retarget, 620}}), 620);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(2000);
+      check("override behind at 600 -> 100", p, simulate(p, {}, {{600, retarget, 100}}), 100);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(2000);
+      check("override onto position at 600 -> 600", p, simulate(p, {}, {{600, retarget, 600}}), 600);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(500);
+      check("queue 500, 1500, -200, 0", p, simulate(p, {1500, -200, 0}, {}), 0);
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(5000);
+      Run r = simulate(p, {}, {{800, stopNow, 0}});
+      check("stop at 800", p, r, p.target());
+    }
+    {
+      StepProfile p = profileAt(0, jerk);
+      p.setTarget(5000);
+      Run r = simulate(p, {}, {{50, stopNow, 0}});
+      check("stop at 50 (still accelerating)", p, r, p.target());
+    }
+  }
+  printf("%s\n", failures ? "FAILED" : "all passed");
+  return failures ? 1 : 0;
+}
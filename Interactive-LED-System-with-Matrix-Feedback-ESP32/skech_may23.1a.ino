@@ -3,9 +3,8 @@
 #include <Adafruit_NeoPixel.h>
 #include <ArduinoJson.h>
 #include <ESP32Encoder.h>
-#include <MD_Parola.h>     
-#include <MD_MAX72xx.h>     
-#include <SPI.h>            
+#include <SPI.h>
+#include "matrix_renderer.h"
 // --- Wi-Fi Settings ---
 const char* ssid = "WIFI_NAME";         
 const char* password = "WIFI_PASSWORD";    
@@ -29,14 +28,13 @@ Adafruit_NeoPixel strip(ARGB_LED_COUNT, ARGB_LED_PIN, NEO_GRB + NEO_KHZ800);
 #define ENCODER_SW_PIN  34
 
 // --- MAX7219 Pin Definitions 
-#define HARDWARE_TYPE MD_MAX72XX::FC16_HW // Change if your module type is different (FC16 is common)
 #define MAX_DEVICES 4   // Number of 8x8 modules you have
 #define CLK_PIN     2   // Your D2 pin for CLK
 #define DATA_PIN    12  // Your D12 pin for DIN
 #define CS_PIN      13  // Your D13 pin for CS
 
-// --- MD_Parola & MD_MAX72XX Setup --- // --- ADDED FOR MATRIX DISPLAY ---
-MD_Parola P = MD_Parola(HARDWARE_TYPE, DATA_PIN, CLK_PIN, CS_PIN, MAX_DEVICES);
+// --- Matrix Renderer Setup (FC16 modules, dirty-row SPI updates) ---
+MatrixRenderer matrix(DATA_PIN, CLK_PIN, CS_PIN, MAX_DEVICES);
 
 // --- Global Variables for Matrix Disply State --- //
 enum DisplayState {
@@ -195,11 +193,8 @@ void setup() {
   Serial.begin(115200);
   delay(100);
 
-  // --- Initialize Parola Matrix Display --- 
-  P.begin();
-  P.setIntensity(5); // Set matrix brightness (0-15)
-  P.displayClear();
-  P.setTextAlignment(PA_CENTER); // Center align text
+  // --- Initialize Matrix Display ---
+  matrix.begin(5); // Set matrix brightness (0-15), display starts cleared
 
   // Initialize base colors for ARGB strip (e.g., dim red)
   for (int i = 0; i < ARGB_LED_COUNT; i++) { baseLedColors[i] = strip.Color(20,0,0); }
@@ -233,9 +228,6 @@ void loop() {
   }
   client.loop();
 
-  // --- Handle Parola Matrix Animations --- // --- MODIFIED FOR MATRIX DISPLAY ---
-  P.displayAnimate();
-
   // --- Read Rotary Encoder for ARGB Brightness ---
   long newEncoderPosition = encoder.getCount();
   if (newEncoderPosition < 0)   { newEncoderPosition = 0;   encoder.setCount(0); }
@@ -315,9 +307,10 @@ void loop() {
         break;
     }
     
-    P.displayText(displayText, PA_CENTER, 50, DISPLAY_UPDATE_INTERVAL - 200, PA_PRINT, PA_NO_EFFECT); // Display text statically
-                                                                                              // Effect PA_PRINT, Speed 50ms, Pause until next interval
-    Serial.print("Matrix Display Update: "); Serial.println(displayText);
+    matrix.print(displayText); // Centered; only rows that changed are sent to the modules
+    MatrixStats st = matrix.getStats();
+    Serial.print("Matrix Display Update: "); Serial.print(displayText);
+    Serial.printf(" (%lu SPI bytes, %lu us)\n", (unsigned long)st.lastBytes, (unsigned long)st.lastMicros);
     
     lastDisplayUpdateTime = millis();
     forceMatrixUpdate = false; // Reset the force flag
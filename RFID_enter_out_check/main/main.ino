@@ -13,9 +13,11 @@
 #include <WiFiClientSecure.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <EEPROM.h>
 #include <Update.h>
 #include <UniversalTelegramBot.h>
+#include "config_store.h"
+#include "wifi_link.h"
+#include "sd_download.h"
 
 //=========================================================
 // TASK & SEMAPHORE HANDLES
@@ -33,7 +35,8 @@ SemaphoreHandle_t lcdMutex;
 #define CARD_COOLDOWN_SECONDS 5
 #define EVENT_TIMEOUT_MS 3000
 #define MESSAGE_DISPLAY_MS 2000
-#define RECONNECT_INTERVAL_MS 60000 // Reconnect attempt every 60 seconds
+#define WIFI_PORTAL_AFTER_MS 60000   // Open the AP portal after 60 s offline (STA retries continue)
+#define WIFI_STATS_INTERVAL_MS 600000 // Print WiFi link timings every 10 minutes
 
 #define RST_PIN         22
 #define SS_PIN          15
@@ -56,7 +59,7 @@ const int I2C_SCL_PIN = 14;
 const char* GOOGLE_SCRIPT_ID = "https://script.google.com/macros/s/AKfycby1vGdWeMxtKsf0mf4i98NEv_NmrrHkRSRZ5-IMXtgSmRvFoyPZToPoie28pv-td8SnkQ/exec";
 
 //=========================================================
-// FILE, API & EEPROM SETTINGS
+// FILE & API SETTINGS
 //=========================================================
 #define USER_DATABASE_FILE      "/users.csv"
 #define LOGS_DIRECTORY          "/logs"
@@ -66,24 +69,12 @@ const char* GOOGLE_SCRIPT_ID = "https://script.google.com/macros/s/AKfycby1vGdWe
 #define TEMP_USER_FILE          "/temp_users.csv"
 #define UPLOAD_INTERVAL_MS 60000
 #define USER_SYNC_INTERVAL_MS 3600000 // Sync users every hour
-#define EEPROM_SIZE 512
-
-#define EEPROM_WIFI_SSID_ADDR       0
-#define EEPROM_WIFI_PASS_ADDR       60
-#define EEPROM_ADMIN_USER_ADDR      120
-#define EEPROM_ADMIN_PASS_ADDR      180
-#define EEPROM_ADD_USER_USER_ADDR   240
-#define EEPROM_ADD_USER_PASS_ADDR   300
 
 //=========================================================
 // WIFI & AUTHENTICATION SETTINGS
 //=========================================================
-String wifi_ssid;
-String wifi_pass;
-String admin_user;
-String admin_pass;
-String add_user_user;
-String add_user_pass;
+ConfigStore config; // Loaded once at boot, all reads are served from RAM
+WifiLink wifiLink;   // STA link with cached BSSID/channel, driven from Task_Network
 
 const char* ap_ssid = "RFID-Config-Portal";
 
@@ -325,8 +316,6 @@ Password:<br><input type='password' name='pass' style='width: 100%; box-sizing:
 //=========================================================
 // FUNCTION PROTOTYPES
 //=========================================================
-void writeStringToEEPROM(int addr, const String& str);
-String readStringFromEEPROM(int addr, int maxLen);
 void loadUsersFromSd();
 void playBuzzer(int status);
 String getFormattedTime(time_t timestamp);
@@ -348,6 +337,7 @@ void Task_Network(void *pvParameters);
 void Task_RFID(void *pvParameters);
 void handleRoot();
 void handleData();
+void handleWifiStats();
 void handleAdmin();
 void handleDeleteUser();
 void handleAddUser();
@@ -360,6 +350,7 @@ void handleNotFound();
 void handleFileManager();
 void handleActivityLogs();
 void handleDownload();
+void handleExport();
 void startAPMode();
 void listDownloadableFiles(File dir, String currentPath);
 void sendTelegramNotification(String uid, String name, String action);
@@ -414,108 +405,95 @@ void setup() {
 
 
 //=========================================================
-// NETWORK TASK (CORE 1) - Rewritten for stability
-//=========================================================
-//=========================================================
-// NETWORK TASK (CORE 1) - *** AP MODE BUG FIXED ***
+// NETWORK TASK (CORE 1) - Non-blocking WiFi link handling
 //=========================================================
 void Task_Network(void *pvParameters) {
   Serial.println("[Network Task] Started on Core 1.");
 
   bool sta_mode_initialized = false;
+  bool dashboard_started = false;
   unsigned long lastUploadTime = 0;
   unsigned long lastUserFileSyncTime = 0;
+  unsigned long offlineSince = millis();
+  unsigned long lastWifiStatsTime = 0;
   bool ap_mode_active = false;
+  bool has_credentials = config.get().wifiSsid[0] != '\0';
 
   // Initial Check: If no SSID, go straight to AP mode
-  if (wifi_ssid.length() == 0) {
+  if (!has_credentials) {
     startAPMode();
     ap_mode_active = true;
   } else {
-    // Attempt to connect to saved WiFi
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(wifi_ssid.c_str(), wifi_pass.c_str());
+    // Connect in the background; cached BSSID/channel skip the scan
     Serial.print("[Network Task] Trying to connect to ");
-    Serial.println(wifi_ssid);
-    updateDisplayMessage("Connecting to", wifi_ssid);
-
-    // Wait for 10 seconds for the initial connection
-    int wait_count = 0;
-    while(WiFi.status() != WL_CONNECTED && wait_count < 20) { // 20 * 500ms = 10s
-        vTaskDelay(500 / portTICK_PERIOD_MS);
-        Serial.print(".");
-        wait_count++;
-    }
-
-    if(WiFi.status() != WL_CONNECTED) {
-        Serial.println("\n[Network Task] Initial connection failed. Starting AP mode.");
-        sendSystemAlertToTelegram("❌ *Initial Connection Failed!* ❌\n\n_Starting Access Point for manual configuration._");
-        startAPMode();
-        ap_mode_active = true;
-    }
+    Serial.println(config.get().wifiSsid);
+    updateDisplayMessage("Connecting to", config.get().wifiSsid);
+    wifiLink.begin(config.get().wifiSsid, config.get().wifiPass);
   }
 
   for (;;) {
     server.handleClient();
+    if (has_credentials) wifiLink.loop();
 
     if (ap_mode_active) {
-        // AP mode is active, do nothing else.
-    } else {
-        if (WiFi.status() == WL_CONNECTED) {
-            if (!sta_mode_initialized) {
-                // --- This block runs once on successful connection ---
-                Serial.println("\n[Network Task] WiFi Connected!");
-                Serial.print("[Network Task] IP Address: http://"); Serial.println(WiFi.localIP());
-                updateDisplayMessage("WiFi Connected", WiFi.localIP().toString());
-
-                String alertMessage = "✅ *System Connected to WiFi* ✅\n\n";
-                alertMessage += "*SSID:* " + wifi_ssid + "\n";
-                alertMessage += "*IP Address:* `" + WiFi.localIP().toString() + "`";
-                sendSystemAlertToTelegram(alertMessage);
-
-                server.close(); // Clear old handlers (if any) from AP mode
+        // STA retries keep running behind the portal. Once the saved network
+        // is back, restart into dashboard mode (fast path via the RTC cache).
+        if (wifiLink.isOnline()) {
+            Serial.println("[Network Task] Saved WiFi is reachable again. Leaving AP mode.");
+            vTaskDelay(500 / portTICK_PERIOD_MS);
+            ESP.restart();
+        }
+    } else if (wifiLink.isOnline()) {
+        if (!sta_mode_initialized) {
+            // --- This block runs on every (re)connection ---
+            Serial.println("\n[Network Task] WiFi Connected!");
+            Serial.print("[Network Task] IP Address: http://"); Serial.println(WiFi.localIP());
+            updateDisplayMessage("WiFi Connected", WiFi.localIP().toString());
+
+            String alertMessage = "✅ *System Connected to WiFi* ✅\n\n";
+            alertMessage += "*SSID:* " + String(config.get().wifiSsid) + "\n";
+            alertMessage += "*IP Address:* `" + WiFi.localIP().toString() + "`";
+            sendSystemAlertToTelegram(alertMessage);
+
+            if (!dashboard_started) {
                 setupTime();
                 setupDashboardServer();
                 server.begin();
                 Serial.println("[Network Task] Web Server started with Dashboard pages.");
-                syncUserListToSheets(); // Initial sync on connection
-                sta_mode_initialized = true;
-            }
-
-            // --- Regular operations while connected (STA mode) ---
-            if (millis() - lastUploadTime > UPLOAD_INTERVAL_MS) {
-                sendDataToGoogleSheets();
-                lastUploadTime = millis();
-            }
-            if (millis() - lastUserFileSyncTime > USER_SYNC_INTERVAL_MS) {
-                syncUserListToSheets();
-                lastUserFileSyncTime = millis();
-            }
-        } else {
-            // --- Connection Lost ---
-            Serial.println("\n[Network Task] Connection Lost! Attempting to reconnect...");
-            sendSystemAlertToTelegram("❌ *System WiFi Connection Lost!* ❌\n\n_Attempting to reconnect..._");
-            updateDisplayMessage("Reconnecting...", wifi_ssid);
-            WiFi.reconnect();
-
-            // Wait for 10 seconds for reconnection
-            int wait_count = 0;
-            while(WiFi.status() != WL_CONNECTED && wait_count < 20) { // 20 * 500ms = 10s
-                vTaskDelay(500 / portTICK_PERIOD_MS);
-                Serial.print(".");
-                wait_count++;
+                dashboard_started = true;
             }
+            syncUserListToSheets(); // Sync on every connection
+            lastUserFileSyncTime = millis();
+            sta_mode_initialized = true;
+        }
 
-            if(WiFi.status() != WL_CONNECTED) {
-                Serial.println("\n[Network Task] Reconnect failed. Starting AP mode.");
-                sendSystemAlertToTelegram("❌ *Reconnect Failed!* ❌\n\n_Starting Access Point for manual configuration._");
-                startAPMode();
-                ap_mode_active = true; // Switch to AP mode
-            } else {
-                // Reconnected successfully, let the main loop re-initialize
-                sta_mode_initialized = false;
-            }
+        // --- Regular operations while connected (STA mode) ---
+        if (millis() - lastUploadTime > UPLOAD_INTERVAL_MS) {
+            sendDataToGoogleSheets();
+            lastUploadTime = millis();
+        }
+        if (millis() - lastUserFileSyncTime > USER_SYNC_INTERVAL_MS) {
+            syncUserListToSheets();
+            lastUserFileSyncTime = millis();
+        }
+    } else {
+        if (sta_mode_initialized) {
+            // --- Connection Lost --- WifiLink reconnects with backoff, nothing blocks here
+            Serial.println("\n[Network Task] Connection Lost! Reconnecting in background...");
+            updateDisplayMessage("Reconnecting...", config.get().wifiSsid);
+            sta_mode_initialized = false;
+            offlineSince = millis();
         }
+        if (millis() - offlineSince > WIFI_PORTAL_AFTER_MS) {
+            Serial.println("\n[Network Task] WiFi still unreachable. Opening AP portal, STA retries continue.");
+            startAPMode();
+            ap_mode_active = true;
+        }
+    }
+
+    if (has_credentials && millis() - lastWifiStatsTime > WIFI_STATS_INTERVAL_MS) {
+        wifiLink.printStats();
+        lastWifiStatsTime = millis();
     }
     vTaskDelay(10 / portTICK_PERIOD_MS);
   }
@@ -629,28 +607,21 @@ void loop() {
 // WIFI & WEB SERVER FUNCTIONS
 //=========================================================
 void loadCredentials() {
-  EEPROM.begin(EEPROM_SIZE);
-  Serial.println("[Config] Loading all settings from EEPROM...");
-  wifi_ssid       = readStringFromEEPROM(EEPROM_WIFI_SSID_ADDR, 32);
-  wifi_pass       = readStringFromEEPROM(EEPROM_WIFI_PASS_ADDR, 63);
-  admin_user      = readStringFromEEPROM(EEPROM_ADMIN_USER_ADDR, 60);
-  admin_pass      = readStringFromEEPROM(EEPROM_ADMIN_PASS_ADDR, 60);
-  add_user_user   = readStringFromEEPROM(EEPROM_ADD_USER_USER_ADDR, 60);
-  add_user_pass   = readStringFromEEPROM(EEPROM_ADD_USER_PASS_ADDR, 60);
-
-  if (admin_user.length() == 0) admin_user = "admin";
-  if (add_user_user.length() == 0) add_user_user = "user";
-  
+  Serial.println("[Config] Loading settings from NVS...");
+  unsigned long t0 = micros();
+  ConfigSource src = config.begin();
+
   Serial.println("--- Configuration Loaded ---");
-  Serial.printf("WiFi SSID:  '%s'\n", wifi_ssid.c_str());
-  Serial.printf("Admin User: '%s'\n", admin_user.c_str());
+  Serial.printf("Source:     %s (%lu us)\n", src == CONFIG_FROM_NVS ? "NVS" : (src == CONFIG_FROM_EEPROM ? "legacy EEPROM" : "defaults"), micros() - t0);
+  Serial.printf("WiFi SSID:  '%s'\n", config.get().wifiSsid);
+  Serial.printf("Admin User: '%s'\n", config.get().adminUser);
   Serial.println("--------------------------");
-  EEPROM.end();
 }
 
 void setupDashboardServer() {
   server.on("/", HTTP_GET, handleRoot);
   server.on("/data", HTTP_GET, handleData);
+  server.on("/wifistats", HTTP_GET, handleWifiStats);
   server.on("/admin", HTTP_GET, handleAdmin);
   server.on("/adduserpage", HTTP_GET, handleAddUserPage);
   server.on("/getlastuid", HTTP_GET, handleGetLastUID);
@@ -663,6 +634,8 @@ void setupDashboardServer() {
   server.on("/filemanager", HTTP_GET, handleFileManager); // Corrected sServer typo here
   server.on("/activity", HTTP_GET, handleActivityLogs);
   server.on("/download", HTTP_GET, handleDownload);
+  server.on("/export", HTTP_GET, handleExport);
+  server.collectHeaders(DOWNLOAD_REQUEST_HEADERS, DOWNLOAD_REQUEST_HEADER_COUNT);
 
   server.on("/update", HTTP_GET, handleUpdatePage);
   server.on("/update", HTTP_POST, []() {
@@ -691,15 +664,10 @@ void setupDashboardServer() {
 void setupAPServer() {
     server.on("/", HTTP_GET, [](){ server.send_P(200, "text/html", PAGE_WIFI_SETUP); });
     server.on("/save", HTTP_POST, [](){
-        wifi_ssid = server.arg("ssid");
-        wifi_pass = server.arg("pass");
-        Serial.printf("[AP Mode] New WiFi credentials received: SSID = %s\n", wifi_ssid.c_str());
-
-        EEPROM.begin(EEPROM_SIZE);
-        writeStringToEEPROM(EEPROM_WIFI_SSID_ADDR, wifi_ssid);
-        writeStringToEEPROM(EEPROM_WIFI_PASS_ADDR, wifi_pass);
-        EEPROM.commit();
-        EEPROM.end();
+        config.setWifiSsid(server.arg("ssid"));
+        config.setWifiPass(server.arg("pass"));
+        Serial.printf("[AP Mode] New WiFi credentials received: SSID = %s\n", config.get().wifiSsid);
+        config.commit();
 
         server.send(200, "text/html", "<h2>Settings Saved!</h2><p>Device will restart with new settings in 5 seconds.</p>");
         delay(5000);
@@ -733,7 +701,29 @@ void handleData() {
   doc["uid"] = lastEventUID;
   doc["name"] = lastEventName;
   doc["action"] = lastEventAction;
-  doc["ssid"] = (WiFi.status() == WL_CONNECTED) ? wifi_ssid : "DISCONNECTED";
+  doc["ssid"] = (WiFi.status() == WL_CONNECTED) ? config.get().wifiSsid : "DISCONNECTED";
+
+  String json;
+  serializeJson(doc, json);
+  server.send(200, "application/json", json);
+}
+
+void handleWifiStats() {
+  const WifiLinkStats& st = wifiLink.stats();
+  StaticJsonDocument<384> doc;
+  doc["rssi"] = WiFi.RSSI();
+  doc["channel"] = WiFi.channel();
+  doc["bssid"] = WiFi.BSSIDstr();
+  doc["attempts"] = st.attempts;
+  doc["fastConnects"] = st.fastConnects;
+  doc["fullConnects"] = st.fullConnects;
+  doc["roams"] = st.roams;
+  doc["outages"] = st.outages;
+  doc["bootToOnlineMs"] = st.bootToOnlineMs;
+  doc["lastOutageMs"] = st.lastOutageMs;
+  doc["maxOutageMs"] = st.maxOutageMs;
+  doc["totalOutageMs"] = st.totalOutageMs;
+  doc["lastAttemptMs"] = st.lastAttemptMs;
 
   String json;
   serializeJson(doc, json);
@@ -741,8 +731,8 @@ void handleData() {
 }
 
 void handleAddUserPage() {
-  if (add_user_pass.length() > 0) {
-    if (!server.authenticate(add_user_user.c_str(), add_user_pass.c_str())) {
+  if (config.get().addUserPass[0] != '\0') {
+    if (!server.authenticate(config.get().addUserUser, config.get().addUserPass)) {
       return server.requestAuthentication();
     }
   }
@@ -755,8 +745,8 @@ void handleGetLastUID() {
 }
 
 void handleAdmin() {
-  if (admin_pass.length() > 0) {
-     if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return server.requestAuthentication(); }
+  if (config.get().adminPass[0] != '\0') {
+     if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
   }
 
   // OPTIMIZED: Send response in chunks to avoid large String allocation
@@ -767,9 +757,9 @@ void handleAdmin() {
   head += "<h1>Admin Panel</h1><a href='/' class='home-link'>&larr; Back to Dashboard</a>";
   head += "<h2>Security Settings</h2>";
   head += "<h3>Admin Access</h3>";
-  head += "<form action='/changepass' method='post'>Admin Username: <input type='text' name='admin_user' value='" + admin_user + "'><br>New Admin Password: <input type='password' name='admin_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save Admin Settings'></form>";
+  head += "<form action='/changepass' method='post'>Admin Username: <input type='text' name='admin_user' value='" + String(config.get().adminUser) + "'><br>New Admin Password: <input type='password' name='admin_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save Admin Settings'></form>";
   head += "<h3>'Add User' Page Access</h3>";
-  head += "<form action='/changeadduserpass' method='post'>'Add User' Username: <input type='text' name='add_user_user' value='" + add_user_user + "'><br>New 'Add User' Password: <input type='password' name='add_user_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save User Settings'></form>";
+  head += "<form action='/changeadduserpass' method='post'>'Add User' Username: <input type='text' name='add_user_user' value='" + String(config.get().addUserUser) + "'><br>New 'Add User' Password: <input type='password' name='add_user_pass'><br><small>To remove password, leave blank and save.</small><br><input type='submit' value='Save User Settings'></form>";
   server.send(200, "text/html", head);
 
   String table_header;
@@ -826,8 +816,8 @@ void listDownloadableFiles(File dir, String currentPath) {
 }
 
 void handleFileManager() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return server.requestAuthentication(); }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
   }
   // OPTIMIZED: Stream response
   server.setContentLength(CONTENT_LENGTH_UNKNOWN);
@@ -835,6 +825,9 @@ void handleFileManager() {
   head.reserve(512);
   head = "<html><head><title>File Manager</title><meta charset='UTF-8'><link href='/style.css' rel='stylesheet' type='text/css'></head><body><div class='container'>";
   head += "<h1>File Manager (csv/txt)</h1><a href='/admin' class='home-link'>&larr; Back to Admin Panel</a>";
+  head += "<h2>Export Logs</h2>";
+  head += "<form action='/export' method='get'><input type='month' name='month'> <input type='submit' value='Download .tar.gz'></form>";
+  head += "<p>Leave the month empty to export all logs. Single files below are sent gzip-compressed and support resuming.</p>";
   head += "<h2>Downloadable Files</h2>";
   head += "<table><tr><th>File Path</th><th>Size (Bytes)</th><th>Action</th></tr>";
   server.send(200, "text/html", head);
@@ -853,8 +846,8 @@ void handleFileManager() {
 
 
 void handleActivityLogs() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return server.requestAuthentication(); }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
   }
 
   // OPTIMIZED: Stream response
@@ -911,36 +904,38 @@ void handleActivityLogs() {
 
 
 void handleDownload() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return; }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return; }
   }
   if (server.hasArg("file")) {
-    String filePath = server.arg("file");
-    if (filePath.indexOf("..") != -1) {
-        server.send(400, "text/plain", "Bad Request: Invalid file path.");
-        return;
-    }
-
-    xSemaphoreTake(sdMutex, portMAX_DELAY);
-    File file = SD.open(filePath, FILE_READ);
-    xSemaphoreGive(sdMutex);
-
-    if (file) {
-        String fileName = filePath.substring(filePath.lastIndexOf('/') + 1);
-        server.sendHeader("Content-Disposition", "attachment; filename=" + fileName);
-        server.streamFile(file, "application/octet-stream");
-        file.close();
-    } else {
-        server.send(404, "text/plain", "File Not Found");
-    }
+    // gzip / Range / If-Modified-Since handling lives in sd_download.h
+    serveSdFile(server, server.arg("file"), sdMutex);
   } else {
     server.send(400, "text/plain", "Bad Request: No file specified.");
   }
 }
 
+// /export?month=YYYY-MM -> users, invalid logs and that month's daily logs as one .tar.gz
+// (no month: all logs)
+void handleExport() {
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
+  }
+  String month = server.arg("month");
+  for (size_t i = 0; i < month.length(); i++) {
+    if (!isDigit(month[i]) && month[i] != '-') {
+      server.send(400, "text/plain", "Bad Request: month must look like 2025-06.");
+      return;
+    }
+  }
+  const char* extraFiles[] = { USER_DATABASE_FILE, INVALID_LOGS_FILE };
+  String archiveName = "logs-" + (month.length() ? month : String("all")) + ".tar.gz";
+  serveSdArchive(server, LOGS_DIRECTORY, month, extraFiles, 2, archiveName, sdMutex);
+}
+
 void handleDeleteUser() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   if (server.hasArg("uid")) {
     String uidToDelete = server.arg("uid");
@@ -973,8 +968,8 @@ void handleDeleteUser() {
 
 
 void handleAddUser() {
-  if (add_user_pass.length() > 0) {
-    if (!server.authenticate(add_user_user.c_str(), add_user_pass.c_str())) return;
+  if (config.get().addUserPass[0] != '\0') {
+    if (!server.authenticate(config.get().addUserUser, config.get().addUserPass)) return;
   }
   if (server.hasArg("uid") && server.hasArg("name")) {
     String uid = server.arg("uid"); String name = server.arg("name");
@@ -998,8 +993,8 @@ void handleAddUser() {
 }
 
 void handleReboot() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   server.send(200, "text/plain", "Rebooting in 3 seconds...");
   delay(3000);
@@ -1007,44 +1002,26 @@ void handleReboot() {
 }
 
 void handleChangePassword() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   
-  EEPROM.begin(EEPROM_SIZE);
-  if (server.hasArg("admin_user")) {
-    admin_user = server.arg("admin_user");
-    writeStringToEEPROM(EEPROM_ADMIN_USER_ADDR, admin_user);
-  }
-  if (server.hasArg("admin_pass")) {
-    String newPass = server.arg("admin_pass");
-    writeStringToEEPROM(EEPROM_ADMIN_PASS_ADDR, newPass);
-    admin_pass = newPass;
-  }
-  EEPROM.commit();
-  EEPROM.end();
+  if (server.hasArg("admin_user")) config.setAdminUser(server.arg("admin_user"));
+  if (server.hasArg("admin_pass")) config.setAdminPass(server.arg("admin_pass"));
+  config.commit();
   
   server.sendHeader("Location", "/admin", true);
   server.send(302, "text/plain", "");
 }
 
 void handleChangeAddUserPassword() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) return;
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) return;
   }
   
-  EEPROM.begin(EEPROM_SIZE);
-  if (server.hasArg("add_user_user")) {
-    add_user_user = server.arg("add_user_user");
-    writeStringToEEPROM(EEPROM_ADD_USER_USER_ADDR, add_user_user);
-  }
-  if (server.hasArg("add_user_pass")) {
-    String newPass = server.arg("add_user_pass");
-    writeStringToEEPROM(EEPROM_ADD_USER_PASS_ADDR, newPass);
-    add_user_pass = newPass;
-  }
-  EEPROM.commit();
-  EEPROM.end();
+  if (server.hasArg("add_user_user")) config.setAddUserUser(server.arg("add_user_user"));
+  if (server.hasArg("add_user_pass")) config.setAddUserPass(server.arg("add_user_pass"));
+  config.commit();
 
   server.sendHeader("Location", "/admin", true);
   server.send(302, "text/plain", "");
@@ -1053,32 +1030,27 @@ void handleChangeAddUserPassword() {
 void handleNotFound() { server.send(404, "text/plain", "404: Not Found"); }
 
 void handleUpdatePage() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return server.requestAuthentication(); }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
   }
   server.send_P(200, "text/html", PAGE_OTA_UPDATE);
 }
 
 void handleWifiConfigPage() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return server.requestAuthentication(); }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return server.requestAuthentication(); }
   }
   server.send_P(200, "text/html", PAGE_WIFI_CONFIG);
 }
 
 void handleSaveWifiConfig() {
-  if (admin_pass.length() > 0) {
-    if (!server.authenticate(admin_user.c_str(), admin_pass.c_str())) { return; }
+  if (config.get().adminPass[0] != '\0') {
+    if (!server.authenticate(config.get().adminUser, config.get().adminPass)) { return; }
   }
   if (server.hasArg("ssid") && server.hasArg("pass")) {
-    String new_ssid = server.arg("ssid");
-    String new_pass = server.arg("pass");
-    
-    EEPROM.begin(EEPROM_SIZE);
-    writeStringToEEPROM(EEPROM_WIFI_SSID_ADDR, new_ssid);
-    writeStringToEEPROM(EEPROM_WIFI_PASS_ADDR, new_pass);
-    EEPROM.commit();
-    EEPROM.end();
+    config.setWifiSsid(server.arg("ssid"));
+    config.setWifiPass(server.arg("pass"));
+    config.commit();
     
     server.send(200, "text/html", "<h2>Settings Saved!</h2><p>Device will restart with new settings in 5 seconds.</p>");
     delay(5000);
@@ -1091,27 +1063,6 @@ void handleSaveWifiConfig() {
 //=========================================================
 // HELPER FUNCTIONS
 //=========================================================
-void writeStringToEEPROM(int addr, const String& str) {
-  int len = str.length();
-  for (int i = 0; i < len; i++) {
-    EEPROM.write(addr + i, str[i]);
-  }
-  EEPROM.write(addr + len, '\0');
-}
-
-String readStringFromEEPROM(int addr, int maxLen) {
-  char data[maxLen + 1];
-  int len = 0;
-  byte c = EEPROM.read(addr + len);
-  while (c != '\0' && c != 0xFF && len < maxLen) {
-    data[len] = (char)c;
-    len++;
-    c = EEPROM.read(addr + len);
-  }
-  data[len] = '\0';
-  return String(data);
-}
-
 void sendDataToGoogleSheets() {
   Serial.println("\n[GSheet] Checking for data to upload...");
   xSemaphoreTake(sdMutex, portMAX_DELAY);
@@ -1356,8 +1307,14 @@ String formatDuration(unsigned long totalSeconds) {
 }
 
 void startAPMode() {
-  WiFi.disconnect(true);
-  WiFi.mode(WIFI_AP);
+  if (config.get().wifiSsid[0] != '\0') {
+    // Keep the STA side up so WifiLink can keep retrying behind the portal
+    WiFi.mode(WIFI_AP_STA);
+    wifiLink.setPortalActive(true);
+  } else {
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_AP);
+  }
   WiFi.softAP(ap_ssid);
   IPAddress apIP = WiFi.softAPIP();
 
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""
+Local Telegram Bot API stand-in for telegram_link.h.
+
+Speaks just enough of the Bot API over plain HTTP/1.1 keep-alive for the
+three sketches that use telegram_link.h (esp32_Telegram_Bot,
+ESP32_Telegram_Stepper_Control, Attendance_System ESP32):
+
+  GET  /bot<token>/getUpdates?offset=&limit=&timeout=   long poll, offset confirms
+  POST /bot<token>/sendMessage  {"chat_id", "text", "parse_mode"}
+  GET  /bot<token>/getMe
+
+Every line typed on stdin becomes a message from --chat-id ("@<id> text"
+sends it from another chat, e.g. to test "Unauthorized user"). Scripts can
+also POST {"text": "...", "chat_id": 123} to /inject. Each sendMessage is
+printed together with the time since the command it answers was handed to
+the ESP, which is the command -> reply latency without Telegram's servers in
+the path. --auto sends one command every --interval seconds for soak tests;
+Ctrl-C prints a latency summary.
+
+Point the firmware at it by defining, above #include "telegram_link.h":
+
+  #define TELEGRAM_API_HOST "192.168.1.50"   // this PC, must be a string literal
+  #define TELEGRAM_API_PORT 8081
+  #define TELEGRAM_API_TLS  0
+  #define TELEGRAM_LONG_POLL_S 10           // optional, shorter polls
+
+and use the same chat ID as --chat-id (CHAT_ID / the allowed chat). Only the
+standard library is needed:
+
+  python3 telegram_standin.py --port 8081 --chat-id 123456789
+  python3 telegram_standin.py --auto /strip_status --interval 2
+"""
+
+import argparse
+import json
+import statistics
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+
+class BotState:
+    """Pending updates and the replies that answered them."""
+
+    def __init__(self, token):
+        self.token = token
+        self.cond = threading.Condition()
+        self.updates = []            # not yet confirmed by offset
+        self.next_update_id = 1
+        self.next_message_id = 1
+        self.delivered_at = {}       # chat_id -> time the oldest unanswered command left getUpdates
+        self.latencies_ms = []
+        self.polls = 0
+        self.sent = 0
+
+    def inject(self, chat_id, text, first_name="Tester"):
+        with self.cond:
+            msg_id = self.next_message_id
+            self.next_message_id += 1
+            self.updates.append({
+                "update_id": self.next_update_id,
+                "message": {
+                    "message_id": msg_id,
+                    "from": {"id": chat_id, "is_bot": False, "first_name": first_name},
+                    "chat": {"id": chat_id, "type": "private"},
+                    "date": int(time.time()),
+                    "text": text,
+                },
+            })
+            self.next_update_id += 1
+            self.cond.notify_all()
+
+    def get_updates(self, offset, limit, timeout):
+        deadline = time.monotonic() + timeout
+        with self.cond:
+            self.polls += 1
+            if offset:
+                self.updates = [u for u in self.updates if u["update_id"] >= offset]
+            while not self.updates:
+                left = deadline - time.monotonic()
+                if left <= 0:
+                    return []
+                self.cond.wait(left)
+            batch = self.updates[:limit]
+            now = time.monotonic()
+            for u in batch:
+                self.delivered_at.setdefault(u["message"]["chat"]["id"], []).append(now)
+            return batch
+
+    def send_message(self, chat_id, text):
+        now = time.monotonic()
+        with self.cond:
+            self.sent += 1
+            msg_id = self.next_message_id
+            self.next_message_id += 1
+            pending = self.delivered_at.get(chat_id)
+            latency = None
+            if pending:
+                latency = (now - pending.pop(0)) * 1000
+                self.latencies_ms.append(latency)
+        return msg_id, latency
+
+    def summary(self):
+        lat = sorted(self.latencies_ms)
+        line = f"polls={self.polls} sent={self.sent} replies timed={len(lat)}"
+        if lat:
+            p99 = lat[min(len(lat) - 1, int(len(lat) * 0.99))]
+            line += (f" | reply latency p50={statistics.median(lat):.0f} ms"
+                     f" p99={p99:.0f} ms max={lat[-1]:.0f} ms")
+        return line
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"    # keep-alive, like api.telegram.org
+    state = None                     # BotState, set in main()
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply_json(self, obj, status=200):
+        body = json.dumps(obj).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def read_body(self):
+        n = int(self.headers.get("Content-Length") or 0)
+        raw = self.rfile.read(n) if n else b""
+        if not raw:
+            return {}
+        if "json" in (self.headers.get("Content-Type") or ""):
+            return json.loads(raw)
+        return {k: v[0] for k, v in parse_qs(raw.decode()).items()}
+
+    def do_GET(self):
+        self.dispatch({})
+
+    def do_POST(self):
+        try:
+            body = self.read_body()
+        except ValueError:
+            return self.reply_json({"ok": False, "error_code": 400, "description": "Bad Request: bad JSON"}, 400)
+        self.dispatch(body)
+
+    def dispatch(self, body):
+        url = urlsplit(self.path)
+        params = {k: v[0] for k, v in parse_qs(url.query).items()}
+        params.update(body)
+
+        if url.path == "/inject":
+            self.state.inject(int(params.get("chat_id", ARGS.chat_id)), str(params.get("text", "")))
+            return self.reply_json({"ok": True})
+
+        parts = url.path.split("/")
+        if len(parts) != 3 or not parts[1].startswith("bot"):
+            return self.reply_json({"ok": False, "error_code": 404, "description": "Not Found"}, 404)
+        if self.state.token and parts[1][3:] != self.state.token:
+            return self.reply_json({"ok": False, "error_code": 401, "description": "Unauthorized"}, 401)
+
+        method = parts[2]
+        if method == "getMe":
+            return self.reply_json({"ok": True, "result": {"id": 1, "is_bot": True, "first_name": "standin",
+                                                           "username": "standin_bot"}})
+        if method == "getUpdates":
+            updates = self.state.get_updates(int(params.get("offset", 0)), int(params.get("limit", 100)),
+                                             float(params.get("timeout", 0)))
+            for u in updates:
+                print(f"-> update {u['update_id']} to ESP: {u['message']['text']}", flush=True)
+            return self.reply_json({"ok": True, "result": updates})
+        if method == "sendMessage":
+            try:
+                chat_id = int(params["chat_id"])
+            except (KeyError, ValueError):
+                return self.reply_json({"ok": False, "error_code": 400, "description": "Bad Request: chat_id"}, 400)
+            text = str(params.get("text", ""))
+            msg_id, latency = self.state.send_message(chat_id, text)
+            took = f" ({latency:.0f} ms after its command)" if latency is not None else ""
+            mode = f" [{params['parse_mode']}]" if params.get("parse_mode") else ""
+            print(f"<- reply to {chat_id}{mode}{took}:\n   " + text.replace("\n", "\n   "), flush=True)
+            return self.reply_json({"ok": True, "result": {"message_id": msg_id, "chat": {"id": chat_id, "type": "private"},
+                                                           "date": int(time.time()), "text": text}})
+        return self.reply_json({"ok": False, "error_code": 404, "description": "Not Found: method not found"}, 404)
+
+
+def read_stdin(state, chat_id):
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        sender = chat_id
+        if line.startswith("@") and " " in line:
+            head, line = line.split(" ", 1)
+            sender = int(head[1:])
+        state.inject(sender, line)
+
+
+def auto_send(state, chat_id, text, interval):
+    while True:
+        state.inject(chat_id, text)
+        time.sleep(interval)
+
+
+def main():
+    global ARGS
+    ap = argparse.ArgumentParser(description=__doc__.strip().split("\n\n")[0])
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=8081)
+    ap.add_argument("--token", default="", help="reject other bot tokens with 401 (default: accept any)")
+    ap.add_argument("--chat-id", type=int, default=123456789, help="chat the typed commands come from")
+    ap.add_argument("--auto", help="send this command every --interval seconds")
+    ap.add_argument("--interval", type=float, default=5.0)
+    ARGS = ap.parse_args()
+
+    state = BotState(ARGS.token)
+    Handler.state = state
+    server = ThreadingHTTPServer((ARGS.bind, ARGS.port), Handler)
+    server.daemon_threads = True
+    print(f"Bot API stand-in on http://{ARGS.bind}:{ARGS.port} (chat {ARGS.chat_id}). Type a command, Ctrl-C to stop.",
+          flush=True)
+    threading.Thread(target=read_stdin, args=(state, ARGS.chat_id), daemon=True).start()
+    if ARGS.auto:
+        threading.Thread(target=auto_send, args=(state, ARGS.chat_id, ARGS.auto, ARGS.interval), daemon=True).start()
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(state.summary())
+
+
+ARGS = None
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,8 @@
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <UniversalTelegramBot.h>
+#include <TelegramCertificate.h>
 #include <FastLED.h>
 #include <stdio.h>
+#include "telegram_link.h"
 
 const char* WIFI_SSID = "Your_WiFi_SSID";
 const char* WIFI_PASSWORD = "Your_WiFi_Password";
@@ -22,11 +22,7 @@ uint8_t currentB = 255;
 uint8_t currentBrightness = 128;
 bool stripActive = false;
 
-const unsigned long BOT_MTBS = 1000; 
-
-WiFiClientSecure secured_client;
-UniversalTelegramBot bot(BOT_TOKEN, secured_client);
-unsigned long bot_lasttime; 
+TelegramLink telegram;
 
 void setStripColor(uint8_t r, uint8_t g, uint8_t b) {
   currentR = r;
@@ -65,73 +61,63 @@ void turnStripOff() {
   FastLED.show();
 }
 
-void handleNewMessages(int numNewMessages) {
-  Serial.print("handleNewMessages ");
-  Serial.println(numNewMessages);
-
-  for (int i = 0; i < numNewMessages; i++) {
-    String chat_id_from_message = bot.messages[i].chat_id;
-    String text = bot.messages[i].text;
-    Serial.println(text);
-    String from_name = bot.messages[i].from_name;
-    if (from_name == "")
-      from_name = "Guest";
-
-    if (chat_id_from_message != CHAT_ID){
-      bot.sendMessage(chat_id_from_message, "Unauthorized user", "");
-      continue;
+// Commands arrive already filtered to CHAT_ID; unauthorized chats are answered by TelegramLink.
+void handleCommand(const TelegramCommand& cmd) {
+  String text = cmd.text;
+  Serial.println(text);
+  String from_name = cmd.fromName;
+  if (from_name == "")
+    from_name = "Guest";
+
+  String lowerText = text;
+  lowerText.toLowerCase();
+
+  if (lowerText == "/start") {
+    String welcome = "Welcome, " + from_name + ".\n";
+    welcome += "ARGB LED Strip commands:\n\n";
+    welcome += "ledon (or /strip_on) -> Turns the strip ON\n"; 
+    welcome += "ledoff (or /strip_off) -> Turns the strip OFF\n"; 
+    welcome += "/rgb R G B -> Sets color (e.g., /rgb 255 0 100)\n";
+    welcome += "/brightness VAL -> Sets brightness (0-255)\n";
+    welcome += "ledstatus (or /strip_status) -> Shows current status\n"; 
+    telegram.reply(cmd, welcome, "Markdown");
+  } else if (lowerText == "ledon" || lowerText == "/strip_on") { 
+    turnStripOn();
+    telegram.reply(cmd, "LED Strip is ON.", "");
+    Serial.println("LED Strip ON");
+  } else if (lowerText == "ledoff" || lowerText == "/strip_off") { 
+    turnStripOff();
+    telegram.reply(cmd, "LED Strip is OFF.", "");
+    Serial.println("LED Strip OFF");
+  } else if (lowerText.startsWith("/rgb ")) { 
+    int r_val, g_val, b_val;
+    int num_parsed = sscanf(text.c_str() + 5, "%d %d %d", &r_val, &g_val, &b_val);
+    if (num_parsed == 3 && r_val >= 0 && r_val <= 255 && g_val >= 0 && g_val <= 255 && b_val >= 0 && b_val <= 255) {
+      setStripColor(r_val, g_val, b_val);
+      if (!stripActive) turnStripOn();
+      String msg = "LED color set: R=" + String(r_val) + " G=" + String(g_val) + " B=" + String(b_val);
+      telegram.reply(cmd, msg, "");
+      Serial.println(msg);
+    } else {
+      telegram.reply(cmd, "Invalid format. Use: /rgb R G B (0-255)", "");
     }
-
-    String lowerText = text;
-    lowerText.toLowerCase();
-
-    if (lowerText == "/start") {
-      String welcome = "Welcome, " + from_name + ".\n";
-      welcome += "ARGB LED Strip commands:\n\n";
-      welcome += "ledon (or /strip_on) -> Turns the strip ON\n"; 
-      welcome += "ledoff (or /strip_off) -> Turns the strip OFF\n"; 
-      welcome += "/rgb R G B -> Sets color (e.g., /rgb 255 0 100)\n";
-      welcome += "/brightness VAL -> Sets brightness (0-255)\n";
-      welcome += "ledstatus (or /strip_status) -> Shows current status\n"; 
-      bot.sendMessage(chat_id_from_message, welcome, "Markdown");
-    } else if (lowerText == "ledon" || lowerText == "/strip_on") { 
-      turnStripOn();
-      bot.sendMessage(chat_id_from_message, "LED Strip is ON.", "");
-      Serial.println("LED Strip ON");
-    } else if (lowerText == "ledoff" || lowerText == "/strip_off") { 
-      turnStripOff();
-      bot.sendMessage(chat_id_from_message, "LED Strip is OFF.", "");
-      Serial.println("LED Strip OFF");
-    } else if (lowerText.startsWith("/rgb ")) { 
-      int r_val, g_val, b_val;
-      int num_parsed = sscanf(text.c_str() + 5, "%d %d %d", &r_val, &g_val, &b_val);
-      if (num_parsed == 3 && r_val >= 0 && r_val <= 255 && g_val >= 0 && g_val <= 255 && b_val >= 0 && b_val <= 255) {
-        setStripColor(r_val, g_val, b_val);
-        if (!stripActive) turnStripOn();
-        String msg = "LED color set: R=" + String(r_val) + " G=" + String(g_val) + " B=" + String(b_val);
-        bot.sendMessage(chat_id_from_message, msg, "");
-        Serial.println(msg);
-      } else {
-        bot.sendMessage(chat_id_from_message, "Invalid format. Use: /rgb R G B (0-255)", "");
-      }
-    } else if (lowerText.startsWith("/brightness ")) { 
-      int brightness_val;
-      int num_parsed = sscanf(text.c_str() + 12, "%d", &brightness_val);
-      if (num_parsed == 1 && brightness_val >= 0 && brightness_val <= 255) {
-        setStripBrightness(brightness_val);
-        String msg = "LED brightness set: " + String(brightness_val);
-        bot.sendMessage(chat_id_from_message, msg, "");
-        Serial.println(msg);
-      } else {
-        bot.sendMessage(chat_id_from_message, "Invalid format. Use: /brightness VAL (0-255)", "");
-      }
-    } else if (lowerText == "ledstatus" || lowerText == "/strip_status") { 
-      String status_msg = "LED Strip Status:\n";
-      status_msg += stripActive ? "State: ON\n" : "State: OFF\n";
-      status_msg += "Color: R=" + String(currentR) + " G=" + String(currentG) + " B=" + String(currentB) + "\n";
-      status_msg += "Brightness: " + String(currentBrightness);
-      bot.sendMessage(chat_id_from_message, status_msg, "");
+  } else if (lowerText.startsWith("/brightness ")) { 
+    int brightness_val;
+    int num_parsed = sscanf(text.c_str() + 12, "%d", &brightness_val);
+    if (num_parsed == 1 && brightness_val >= 0 && brightness_val <= 255) {
+      setStripBrightness(brightness_val);
+      String msg = "LED brightness set: " + String(brightness_val);
+      telegram.reply(cmd, msg, "");
+      Serial.println(msg);
+    } else {
+      telegram.reply(cmd, "Invalid format. Use: /brightness VAL (0-255)", "");
     }
+  } else if (lowerText == "ledstatus" || lowerText == "/strip_status") { 
+    String status_msg = "LED Strip Status:\n";
+    status_msg += stripActive ? "State: ON\n" : "State: OFF\n";
+    status_msg += "Color: R=" + String(currentR) + " G=" + String(currentG) + " B=" + String(currentB) + "\n";
+    status_msg += "Brightness: " + String(currentBrightness);
+    telegram.reply(cmd, status_msg, "");
   }
 }
 
@@ -147,24 +133,20 @@ void setup() {
   Serial.print("Connecting to Wifi SSID ");
   Serial.print(WIFI_SSID);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  secured_client.setCACert(TELEGRAM_CERTIFICATE_ROOT); 
   while (WiFi.status() != WL_CONNECTED) {
     Serial.print(".");
     delay(500);
   }
   Serial.print("\nWiFi connected. IP address: ");
   Serial.println(WiFi.localIP());
+
+  telegram.begin(BOT_TOKEN, CHAT_ID, TELEGRAM_CERTIFICATE_ROOT);
 }
 
 void loop() {
-  if (millis() - bot_lasttime > BOT_MTBS) {
-    int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-
-    while (numNewMessages) {
-      Serial.println("got response");
-      handleNewMessages(numNewMessages);
-      numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    }
-    bot_lasttime = millis();
+  TelegramCommand cmd;
+  // Blocks until the Telegram task hands over a command; no polling interval.
+  if (telegram.nextCommand(cmd, pdMS_TO_TICKS(1000))) {
+    handleCommand(cmd);
   }
 }
\ No newline at end of file
@@ -1,21 +1,43 @@
 #include <WiFi.h>
 #include <WebServer.h>
+#include <Preferences.h>
 #include <EEPROM.h>
+#include "wifi_link.h"
 
-// EEPROM'da verileri saklamak için ayıracağımız alan
-#define EEPROM_SIZE 128
+// Eski sürümün EEPROM düzeni (sadece ilk açılıştaki taşıma için okunur)
+#define LEGACY_EEPROM_SIZE 128
+#define LEGACY_EEPROM_SSID_ADDR 0
+#define LEGACY_EEPROM_PASS_ADDR 64
+
+// NVS'te tek blob olarak saklanan ayarlar
+#define CONFIG_NVS_NAMESPACE  "wificfg"
+#define CONFIG_NVS_KEY        "cfg"
+#define CONFIG_SCHEMA_VERSION 1
 
 //======================================================================
-// GLOBAL VARIABLES FOR WIFI CREDENTIALS
-// These variables act as the single source of truth for the application.
-// They are loaded from EEPROM at boot.
-char ssid[33];
-char password[64];
+// WIFI CONFIGURATION (RAM CACHE)
+// This struct is the single source of truth for the application.
+// It is loaded from NVS once at boot; every read after that is served
+// from RAM. Changes are written back as one blob with a schema version
+// and CRC, so a half-written or stale record is detected on the next boot.
+struct WifiConfig {
+  uint16_t schema;
+  uint16_t size;
+  char ssid[33];
+  char password[64];
+  uint32_t crc;  // CRC32 over everything above
+};
+WifiConfig config;
+const char* ssid = config.ssid;
+const char* password = config.password;
 //======================================================================
 
 // Web Server on port 80
 WebServer server(80);
 
+// Non-blocking STA link: cached BSSID/channel, backoff, background roaming
+WifiLink wifiLink;
+
 // Constants for the Access Point (Hotspot) mode
 const char* ap_ssid = "ESP-Setup-Device";
 
@@ -24,49 +46,100 @@ bool is_in_ap_mode = false;
 const unsigned long reconnect_timeout = 30000; // 30 seconds
 unsigned long last_disconnect_time = 0;
 
+uint32_t configCrc(const WifiConfig& cfg) {
+  const uint8_t* data = (const uint8_t*)&cfg;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < offsetof(WifiConfig, crc); i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+/**
+ * @brief Writes the RAM config to NVS as a single blob.
+ * NVS keeps the previous record until the new one is complete, so a power
+ * loss during the write leaves the old credentials usable.
+ */
+bool commitConfig() {
+  config.schema = CONFIG_SCHEMA_VERSION;
+  config.size = sizeof(WifiConfig);
+  config.crc = configCrc(config);
+
+  Preferences prefs;
+  if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+    Serial.println("ERROR: NVS could not be opened!");
+    return false;
+  }
+  bool ok = prefs.putBytes(CONFIG_NVS_KEY, &config, sizeof(config)) == sizeof(config);
+  prefs.end();
+  Serial.println(ok ? "Config committed to NVS." : "ERROR: NVS commit failed!");
+  return ok;
+}
+
 /**
- * @brief Saves the new WiFi credentials to the permanent EEPROM storage.
+ * @brief Saves the new WiFi credentials to the permanent NVS storage.
+ * Nothing is written if the credentials did not change.
  * @param new_ssid The new network SSID to save.
  * @param new_password The new network password to save.
  */
 void saveCredentials(const String& new_ssid, const String& new_password) {
-  Serial.println("Saving new credentials to EEPROM...");
-  EEPROM.begin(EEPROM_SIZE);
-  EEPROM.writeString(0, new_ssid);
-  EEPROM.writeString(64, new_password);
-  if (EEPROM.commit()) {
-    Serial.println("EEPROM successfully committed.");
-  } else {
-    Serial.println("ERROR: EEPROM commit failed!");
+  if (new_ssid == config.ssid && new_password == config.password) {
+    Serial.println("Credentials unchanged, skipping flash write.");
+    return;
   }
-  EEPROM.end();
+  Serial.println("Saving new credentials to NVS...");
+  memset(config.ssid, 0, sizeof(config.ssid));
+  memset(config.password, 0, sizeof(config.password));
+  strncpy(config.ssid, new_ssid.c_str(), sizeof(config.ssid) - 1);
+  strncpy(config.password, new_password.c_str(), sizeof(config.password) - 1);
+  commitConfig();
+}
 
-  // Also update the global variables immediately
-  strncpy(ssid, new_ssid.c_str(), sizeof(ssid));
-  strncpy(password, new_password.c_str(), sizeof(password));
+/**
+ * @brief Tries to read a valid config blob from NVS.
+ * @return true if a record with the current schema and a good CRC was found.
+ */
+bool loadConfigFromNvs() {
+  Preferences prefs;
+  if (!prefs.begin(CONFIG_NVS_NAMESPACE, true)) return false; // first boot, no namespace yet
+  bool ok = false;
+  if (prefs.getBytesLength(CONFIG_NVS_KEY) == sizeof(WifiConfig)) {
+    prefs.getBytes(CONFIG_NVS_KEY, &config, sizeof(config));
+    ok = config.schema == CONFIG_SCHEMA_VERSION && config.size == sizeof(WifiConfig) &&
+         config.crc == configCrc(config);
+    if (!ok) Serial.println("NVS config is invalid (schema/CRC), ignoring.");
+  }
+  prefs.end();
+  return ok;
 }
 
 /**
- * @brief Loads WiFi credentials from EEPROM into the global variables at boot.
- * If EEPROM is empty, it loads hard-coded default values.
+ * @brief Loads WiFi credentials into the RAM config at boot.
+ * Order: NVS record -> old EEPROM layout (one-time migration) -> defaults.
  */
 void loadCredentials() {
-  EEPROM.begin(EEPROM_SIZE);
-  String esid = EEPROM.readString(0);
+  if (loadConfigFromNvs()) {
+    Serial.println("Loaded credentials from NVS.");
+    return;
+  }
+
+  memset(&config, 0, sizeof(config));
+  EEPROM.begin(LEGACY_EEPROM_SIZE);
+  String esid = EEPROM.readString(LEGACY_EEPROM_SSID_ADDR);
+  String epass = EEPROM.readString(LEGACY_EEPROM_PASS_ADDR);
   EEPROM.end();
-  
-  if (esid.length() > 0 && esid.length() < 33) {
-    EEPROM.begin(EEPROM_SIZE);
-    String epass = EEPROM.readString(64);
-    EEPROM.end();
-    strncpy(ssid, esid.c_str(), sizeof(ssid));
-    strncpy(password, epass.c_str(), sizeof(password));
-    Serial.println("Loaded credentials from EEPROM.");
+
+  if (esid.length() > 0 && esid.length() < sizeof(config.ssid)) {
+    strncpy(config.ssid, esid.c_str(), sizeof(config.ssid) - 1);
+    strncpy(config.password, epass.c_str(), sizeof(config.password) - 1);
+    Serial.println("Migrated credentials from old EEPROM layout.");
   } else {
-    strcpy(ssid, "default_ssid");
-    strcpy(password, "default_pass");
-    Serial.println("EEPROM is empty. Loaded default credentials.");
+    strcpy(config.ssid, "default_ssid");
+    strcpy(config.password, "default_pass");
+    Serial.println("No stored config. Loaded default credentials.");
   }
+  commitConfig();
 }
 
 /**
@@ -184,7 +257,9 @@ void startAPMode() {
   is_in_ap_mode = true;
   Serial.println("Starting AP mode...");
   
-  WiFi.mode(WIFI_AP);
+  // AP+STA: the portal is served while WifiLink keeps retrying the saved network
+  WiFi.mode(WIFI_AP_STA);
+  wifiLink.setPortalActive(true);
   WiFi.softAP(ap_ssid);
 
   Serial.print("AP IP address: ");
@@ -207,30 +282,16 @@ void startAPMode() {
 }
 
 /**
- * @brief Connects to WiFi using the credentials from the global variables.
+ * @brief Starts connecting to WiFi using the credentials from the RAM config.
+ * Does not block: wifiLink.loop() finishes the connection in the background,
+ * using the cached BSSID/channel to skip the scan when possible.
  */
 void connectToWiFi() {
   is_in_ap_mode = false;
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
   Serial.print("Connecting to WiFi: ");
   Serial.println(ssid);
-
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
-  }
-
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.print("IP Address: ");
-    Serial.println(WiFi.localIP());
-  } else {
-    Serial.println("\nFailed to connect to WiFi.");
-    if (last_disconnect_time == 0) last_disconnect_time = millis();
-  }
+  last_disconnect_time = millis();
+  wifiLink.begin(ssid, password);
 }
 
 void setup() {
@@ -241,7 +302,9 @@ void setup() {
 }
 
 void loop() {
-  if (WiFi.status() != WL_CONNECTED) {
+  wifiLink.loop();
+
+  if (!wifiLink.isOnline()) {
     if (!is_in_ap_mode) {
       if (last_disconnect_time == 0) {
         Serial.println("WiFi connection lost!");
@@ -252,6 +315,8 @@ void loop() {
       }
     }
   } else {
+    // Saved network is reachable again: restart to leave the portal.
+    // The RTC cache makes the next connect skip the scan.
     if (is_in_ap_mode) ESP.restart();
     last_disconnect_time = 0;
     // This part only runs when connected to WiFi.
@@ -260,4 +325,4 @@ void loop() {
   if (is_in_ap_mode) {
     server.handleClient();
   }
-}
\ No newline at end of file
+}